@@ -0,0 +1,214 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file eeprom24c.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "eeprom24c.h"
+
+// LOCAL CONST
+#define EEPROM24C_WRITE_TIMEOUT     CONFIG_EEPROM24C_WRITE_TIMEOUT
+#define EEPROM24C_READ_CHUNK        CONFIG_EEPROM24C_READ_CHUNK
+
+static const char *TAG = "eeprom24c";
+
+static const struct {
+    size_t size;
+    size_t page_size;
+} eeprom24c_geometry[EEPROM_24C_MAX] = {
+    [EEPROM_24C32] = {4096, 32},
+    [EEPROM_24C64] = {8192, 32},
+    [EEPROM_24C128] = {16384, 64},
+    [EEPROM_24C256] = {32768, 64},
+    [EEPROM_24C512] = {65536, 128},
+};
+
+static esp_err_t _eeprom24c_ready(eeprom24c_t *eep, TickType_t deadline)
+{
+    if (!eep->busy)
+        return ESP_OK;
+
+    // poll address until device answers, port is free for others in between.
+    while (true) {
+        esp_err_t res = i2cbus_ping_until(&eep->bus, deadline);
+        if (res == ESP_OK) {
+            eep->busy = false;
+            return ESP_OK;
+        }
+        if (res != ESP_FAIL)
+            return res;
+
+        eep->polls++;
+        if ((esp_timer_get_time() - eep->cycle_us) > (EEPROM24C_WRITE_TIMEOUT * 1000)) {
+            ESP_LOGE(TAG, "write cycle of 0x%02x at %d not over", eep->bus.addr, eep->bus.port);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+static esp_err_t _eeprom24c_write(eeprom24c_t *eep, uint32_t offset, const uint8_t *data, size_t size, 
+                                  TickType_t deadline, bool renew)
+{
+    esp_err_t res = ESP_OK;
+
+    while (size && (res == ESP_OK)) {
+        if (renew)
+            deadline = i2cbus_deadline(eep->bus.time_out);
+
+        // a burst never crosses a page, the device would roll over within it.
+        size_t chunk = eep->page_size - (offset % eep->page_size);
+        if (chunk > size)
+            chunk = size;
+
+        uint8_t addr[2] = {offset >> 8, offset & 0xFF};
+        res = _eeprom24c_ready(eep, deadline);
+        if (res == ESP_OK)
+            res = i2cbus_write_reg_until(&eep->bus, addr, sizeof(addr), (uint8_t *)data, chunk, deadline);
+        if (res == ESP_OK) {
+            eep->busy = true;
+            eep->cycle_us = esp_timer_get_time();
+            eep->pages++;
+        }
+
+        offset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+
+    // data is in the array once the last cycle is over.
+    if (res == ESP_OK)
+        res = _eeprom24c_ready(eep, renew ? i2cbus_deadline(eep->bus.time_out) : deadline);
+
+    return res;
+}
+
+static esp_err_t _eeprom24c_read(eeprom24c_t *eep, uint32_t offset, uint8_t *data, size_t size, 
+                                 TickType_t deadline, bool renew)
+{
+    esp_err_t res = ESP_OK;
+
+    while (size && (res == ESP_OK)) {
+        if (renew)
+            deadline = i2cbus_deadline(eep->bus.time_out);
+
+        size_t chunk = (size > EEPROM24C_READ_CHUNK) ? EEPROM24C_READ_CHUNK : size;
+        uint8_t addr[2] = {offset >> 8, offset & 0xFF};
+
+        res = _eeprom24c_ready(eep, deadline);
+        if (res == ESP_OK)
+            res = i2cbus_read_reg_until(&eep->bus, addr, sizeof(addr), data, chunk, deadline);
+
+        offset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+
+    return res;
+}
+
+esp_err_t eeprom24c_init(eeprom24c_t *eep, i2c_port_t port, uint8_t addr, eeprom24c_type_t type)
+{
+    if ((eep == NULL) || (type >= EEPROM_24C_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(eep, 0, sizeof(eeprom24c_t));
+    eep->size = eeprom24c_geometry[type].size;
+    eep->page_size = eeprom24c_geometry[type].page_size;
+
+    return i2cbus_create(&eep->bus, port, addr);
+}
+
+esp_err_t eeprom24c_delete(eeprom24c_t *eep)
+{
+    if (eep == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return i2cbus_delete(&eep->bus);
+}
+
+esp_err_t eeprom24c_write_until(eeprom24c_t *eep, uint32_t offset, const void *data, size_t size, 
+                                TickType_t deadline)
+{
+    if ((eep == NULL) || (data == NULL) || ((offset + size) > eep->size))
+        return ESP_ERR_INVALID_ARG;
+
+    return _eeprom24c_write(eep, offset, data, size, deadline, false);
+}
+
+esp_err_t eeprom24c_write(eeprom24c_t *eep, uint32_t offset, const void *data, size_t size)
+{
+    if ((eep == NULL) || (data == NULL) || ((offset + size) > eep->size))
+        return ESP_ERR_INVALID_ARG;
+
+    return _eeprom24c_write(eep, offset, data, size, 0, true);
+}
+
+esp_err_t eeprom24c_read_until(eeprom24c_t *eep, uint32_t offset, void *data, size_t size, TickType_t deadline)
+{
+    if ((eep == NULL) || (data == NULL) || ((offset + size) > eep->size))
+        return ESP_ERR_INVALID_ARG;
+
+    return _eeprom24c_read(eep, offset, data, size, deadline, false);
+}
+
+esp_err_t eeprom24c_read(eeprom24c_t *eep, uint32_t offset, void *data, size_t size)
+{
+    if ((eep == NULL) || (data == NULL) || ((offset + size) > eep->size))
+        return ESP_ERR_INVALID_ARG;
+
+    return _eeprom24c_read(eep, offset, data, size, 0, true);
+}
+
+esp_err_t eeprom24c_read_stream(eeprom24c_t *eep, uint32_t offset, size_t size, uint8_t *buf, size_t buf_size, 
+                                eeprom24c_read_cb_t cb, void *arg)
+{
+    if ((eep == NULL) || (buf == NULL) || !buf_size || (cb == NULL) || ((offset + size) > eep->size))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = ESP_OK;
+
+    while (size && (res == ESP_OK)) {
+        size_t chunk = (size > buf_size) ? buf_size : size;
+        uint8_t addr[2] = {offset >> 8, offset & 0xFF};
+        TickType_t deadline = i2cbus_deadline(eep->bus.time_out);
+
+        // whole buffer in one sequential read.
+        res = _eeprom24c_ready(eep, deadline);
+        if (res == ESP_OK)
+            res = i2cbus_read_reg_until(&eep->bus, addr, sizeof(addr), buf, chunk, deadline);
+        if (res == ESP_OK)
+            res = cb(offset, buf, chunk, arg);
+
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return res;
+}
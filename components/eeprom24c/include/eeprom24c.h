@@ -0,0 +1,196 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file eeprom24c.h
+ * @defgroup eeprom24c eeprom24c
+ * @{
+ *
+ * @brief 24C32 to 24C512 serial EEPROM.
+ * 
+ * Writes are split into page aligned bursts, one transaction and one internal 
+ * write cycle per page instead of per byte. Write cycle completion is found 
+ * by ACK polling: the device NACKs its address until the cycle is over, so no 
+ * fixed delay is spent. Reads are sequential, in chunks of 
+ * CONFIG_EEPROM24C_READ_CHUNK bytes with the port released between them.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EEPROM24C_ADDR(a2a1a0)  (0x50 | ((a2a1a0) & 0x07))  /*!< Device address from A2..A0 pins */
+
+typedef enum {
+    EEPROM_24C32 = 0,   /*!< 4 KiB, 32 byte pages */
+    EEPROM_24C64,       /*!< 8 KiB, 32 byte pages */
+    EEPROM_24C128,      /*!< 16 KiB, 64 byte pages */
+    EEPROM_24C256,      /*!< 32 KiB, 64 byte pages */
+    EEPROM_24C512,      /*!< 64 KiB, 128 byte pages */
+    EEPROM_24C_MAX
+} eeprom24c_type_t;
+
+/**
+ * @brief Receives each chunk of a streamed read, other than ESP_OK stops it.
+ */
+typedef esp_err_t (*eeprom24c_read_cb_t)(uint32_t offset, const uint8_t *data, size_t size, void *arg);
+
+typedef struct
+{
+    i2cbus_t bus;           /*!< Device on bus */
+    size_t size;            /*!< Memory size */
+    size_t page_size;       /*!< Page size */
+    bool busy;              /*!< A write cycle may be running */
+    int64_t cycle_us;       /*!< Start of last write cycle */
+    uint32_t pages;         /*!< Pages written */
+    uint32_t polls;         /*!< Address polls NACKed by a running write cycle */
+} eeprom24c_t;
+
+
+/**
+ * @brief Create a new EEPROM on bus.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param addr device address, see EEPROM24C_ADDR().
+ * @param type device type.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NOT_FOUND: a scan of port did not find device.
+ *     - ESP_FAIL: fail to start.
+ */
+esp_err_t eeprom24c_init(eeprom24c_t *eep, i2c_port_t port, uint8_t addr, eeprom24c_type_t type);
+
+
+/**
+ * @brief Delete an EEPROM.
+ * 
+ * @param eep pointer to EEPROM.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: device is busy.
+ */
+esp_err_t eeprom24c_delete(eeprom24c_t *eep);
+
+
+/**
+ * @brief Write data before a deadline.
+ * 
+ * @note It returns once the last write cycle is over, data is in the array.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param offset first byte address.
+ * @param data data to write.
+ * @param size number of bytes, up to memory end.
+ * @param deadline absolute deadline for whole write.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument or range out of memory.
+ *     - ESP_ERR_TIMEOUT: deadline expired or write cycle too long.
+ *     - ESP_FAIL: fail to write, device not found.
+ */
+esp_err_t eeprom24c_write_until(eeprom24c_t *eep, uint32_t offset, const void *data, size_t size, 
+                                TickType_t deadline);
+
+
+/**
+ * @brief Write data, each page gets the device timeout.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param offset first byte address.
+ * @param data data to write.
+ * @param size number of bytes, up to memory end.
+ *
+ * @return see eeprom24c_write_until().
+ */
+esp_err_t eeprom24c_write(eeprom24c_t *eep, uint32_t offset, const void *data, size_t size);
+
+
+/**
+ * @brief Read data before a deadline.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param offset first byte address.
+ * @param data receives data.
+ * @param size number of bytes, up to memory end.
+ * @param deadline absolute deadline for whole read.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument or range out of memory.
+ *     - ESP_ERR_TIMEOUT: deadline expired or write cycle too long.
+ *     - ESP_FAIL: fail to read, device not found.
+ */
+esp_err_t eeprom24c_read_until(eeprom24c_t *eep, uint32_t offset, void *data, size_t size, TickType_t deadline);
+
+
+/**
+ * @brief Read data, each chunk gets the device timeout.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param offset first byte address.
+ * @param data receives data.
+ * @param size number of bytes, up to memory end.
+ *
+ * @return see eeprom24c_read_until().
+ */
+esp_err_t eeprom24c_read(eeprom24c_t *eep, uint32_t offset, void *data, size_t size);
+
+
+/**
+ * @brief Stream a range through a caller buffer.
+ * 
+ * @note The buffer is filled by one sequential read at a time, whatever its 
+ *       size, and handed to the callback. A large buffer means fewer 
+ *       transactions.
+ * 
+ * @param eep pointer to EEPROM.
+ * @param offset first byte address.
+ * @param size number of bytes, up to memory end.
+ * @param buf chunk buffer.
+ * @param buf_size chunk buffer size.
+ * @param cb called with each chunk.
+ * @param arg callback argument.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - other: see eeprom24c_read(), or the callback result that stopped it.
+ */
+esp_err_t eeprom24c_read_stream(eeprom24c_t *eep, uint32_t offset, size_t size, uint8_t *buf, size_t buf_size, 
+                                eeprom24c_read_cb_t cb, void *arg);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,7 @@
 /* 
  * MIT License
  * 
- * Copyright (c) [year] [fullname]
+ * Copyright (c) 2022 https://github.com/MuriloAM
  * 
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -27,14 +27,406 @@
  * 
  */
 #include <stdio.h>
+#include <string.h>
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_component.h"
+#include "esp_component_wheel.h"
+
+// LOCAL CONST
+#define ESP_COMPONENT_ENC_MAX       CONFIG_ESP_COMPONENT_MAX
+#define ESP_COMPONENT_WINDOW_US     CONFIG_ESP_COMPONENT_INTERVAL_US
+#define ESP_COMPONENT_DETENT        CONFIG_ESP_COMPONENT_STEPS_PER_DETENT
+#define ESP_COMPONENT_QUEUE_SIZE    CONFIG_ESP_COMPONENT_QUEUE_SIZE
+#define ESP_COMPONENT_QUEUE_MASK    (ESP_COMPONENT_QUEUE_SIZE - 1)
+#define ESP_COMPONENT_TASK_PRIORITY CONFIG_ESP_COMPONENT_TASK_PRIORITY
+#define ESP_COMPONENT_TASK_STACK    CONFIG_ESP_COMPONENT_TASK_STACK
+#define ESP_COMPONENT_DEAD_US       CONFIG_ESP_COMPONENT_BTN_DEAD_TIME_US
+#define ESP_COMPONENT_LONG_US       CONFIG_ESP_COMPONENT_BTN_LONG_PRESS_TIME_US
+#define ESP_COMPONENT_REPEAT_US     CONFIG_ESP_COMPONENT_BTN_REPEAT_TIME_US
+#define ESP_COMPONENT_TICK_US       CONFIG_ESP_COMPONENT_WHEEL_TICK_US
+
+#ifdef CONFIG_ESP_COMPONENT_BTN_PRESSED_LEVEL_1
+#define ESP_COMPONENT_PRESSED       1
+#else
+#define ESP_COMPONENT_PRESSED       0
+#endif
+
+_Static_assert((ESP_COMPONENT_QUEUE_SIZE & ESP_COMPONENT_QUEUE_MASK) == 0, 
+               "ESP_COMPONENT_QUEUE_SIZE must be a power of two");
 
 static const char *TAG = "esp_component";
 
-esp_err_t esp_component_init()
+// quadrature steps indexed by previous and current AB levels, 0 for no move
+// or for a transition that skipped a state.
+static const DRAM_ATTR int8_t quad_table[16] = {
+     0, -1,  1,  0, 
+     1,  0,  0, -1, 
+    -1,  0,  0,  1, 
+     0,  1, -1,  0
+};
+
+typedef struct {
+    esp_component_event_t event;    /*!< Queued event */
+    volatile uint32_t seq;          /*!< Ring lap the cell is ready for */
+} esp_component_cell_t;
+
+typedef struct {
+    gpio_num_t pin_a;               /*!< Encoder A line */
+    gpio_num_t pin_b;               /*!< Encoder B line */
+    gpio_num_t pin_btn;             /*!< Button line */
+    uint8_t ab;                     /*!< Last AB levels */
+    int8_t acc;                     /*!< Quadrature steps toward next detent */
+    volatile int32_t position;      /*!< Detents since added */
+    bool pressed;                   /*!< Debounced button state */
+    bool long_sent;                 /*!< Long press reported for current press */
+    int64_t quiet_until;            /*!< Button edges ignored until */
+    esp_component_wheel_timer_t debounce;   /*!< Samples button again after dead time */
+    esp_component_wheel_timer_t hold;       /*!< Long press and auto-repeat */
+} esp_component_enc_t;
+
+typedef struct {
+    esp_component_cell_t cell[ESP_COMPONENT_QUEUE_SIZE];
+    volatile uint32_t enqueue;      /*!< Next position claimed by interrupt handlers */
+    uint32_t dequeue;               /*!< Next position drained by task */
+    esp_component_enc_t enc[ESP_COMPONENT_ENC_MAX];
+    volatile uint32_t count;        /*!< Encoders added */
+    esp_component_cb_t cb;          /*!< Event batch callback */
+    void *arg;                      /*!< Callback argument */
+    TaskHandle_t task;              /*!< Event task */
+    esp_component_stats_t stats;    /*!< Statistics */
+    esp_component_wheel_t wheel;    /*!< Button timers */
+    portMUX_TYPE lock;              /*!< Guards button state and encoder table */
+} esp_component_t;
+
+static DRAM_ATTR esp_component_t esp_component = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static IRAM_ATTR void _esp_component_push(uint8_t id, esp_component_event_type_t type, int16_t steps, int64_t now)
+{
+    uint32_t pos = __atomic_load_n(&esp_component.enqueue, __ATOMIC_RELAXED);
+    esp_component_cell_t *cell;
+
+    // claim a position with a compare and swap, handlers of both cores may
+    // queue at the same time.
+    while (true) {
+        cell = &esp_component.cell[pos & ESP_COMPONENT_QUEUE_MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&esp_component.enqueue, &pos, pos + 1, true, __ATOMIC_RELAXED, 
+                                            __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            __atomic_fetch_add(&esp_component.stats.overruns, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&esp_component.enqueue, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->event.timestamp = now;
+    cell->event.type = type;
+    cell->event.id = id;
+    cell->event.steps = steps;
+    // hand cell to task.
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&esp_component.stats.events, 1, __ATOMIC_RELAXED);
+}
+
+static bool _esp_component_pop(esp_component_event_t *event)
+{
+    esp_component_cell_t *cell = &esp_component.cell[esp_component.dequeue & ESP_COMPONENT_QUEUE_MASK];
+
+    // cell not published yet, a handler may still be filling it.
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != (esp_component.dequeue + 1))
+        return false;
+
+    *event = cell->event;
+    // release cell to handlers of next lap.
+    __atomic_store_n(&cell->seq, esp_component.dequeue + ESP_COMPONENT_QUEUE_SIZE, __ATOMIC_RELEASE);
+    esp_component.dequeue++;
+
+    return true;
+}
+
+static IRAM_ATTR void _esp_component_wake(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(esp_component.task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static IRAM_ATTR void _esp_component_quad_isr(void *arg)
+{
+    esp_component_enc_t *enc = (esp_component_enc_t *)arg;
+    uint8_t id = enc - esp_component.enc;
+    uint8_t ab = (gpio_get_level(enc->pin_a) << 1) | gpio_get_level(enc->pin_b);
+    int8_t step = quad_table[(enc->ab << 2) | ab];
+
+    // both lines changed between two interrupts, direction is lost.
+    if ((ab != enc->ab) && !step)
+        __atomic_fetch_add(&esp_component.stats.invalid, 1, __ATOMIC_RELAXED);
+    enc->ab = ab;
+    enc->acc += step;
+
+    if ((enc->acc >= ESP_COMPONENT_DETENT) || (enc->acc <= -ESP_COMPONENT_DETENT)) {
+        int16_t steps = (enc->acc > 0) ? 1 : -1;
+        enc->acc -= steps * ESP_COMPONENT_DETENT;
+        enc->position += steps;
+        _esp_component_push(id, ESP_COMPONENT_EVENT_ROTATE, steps, esp_timer_get_time());
+        _esp_component_wake();
+    }
+}
+
+static IRAM_ATTR void _esp_component_btn_isr(void *arg)
+{
+    esp_component_enc_t *enc = (esp_component_enc_t *)arg;
+    uint8_t id = enc - esp_component.enc;
+    int64_t now = esp_timer_get_time();
+    bool queued = false;
+
+    portENTER_CRITICAL_ISR(&esp_component.lock);
+    // edges within dead time are bounces, the debounce timer samples the line
+    // again once it is over.
+    if (now >= enc->quiet_until) {
+        bool pressed = (gpio_get_level(enc->pin_btn) == ESP_COMPONENT_PRESSED);
+        if (pressed != enc->pressed) {
+            enc->pressed = pressed;
+            enc->quiet_until = now + ESP_COMPONENT_DEAD_US;
+            if (pressed)
+                enc->long_sent = false;
+            _esp_component_push(id, pressed ? ESP_COMPONENT_EVENT_PRESS : ESP_COMPONENT_EVENT_RELEASE, 0, now);
+            queued = true;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&esp_component.lock);
+
+    if (queued)
+        _esp_component_wake();
+}
+
+static void _esp_component_deliver(esp_component_event_t *batch, size_t *count, const esp_component_event_t *event)
+{
+    // consecutive rotations of one encoder are merged.
+    if (*count && (event->type == ESP_COMPONENT_EVENT_ROTATE)) {
+        esp_component_event_t *last = &batch[*count - 1];
+        if ((last->type == ESP_COMPONENT_EVENT_ROTATE) && (last->id == event->id)) {
+            last->steps += event->steps;
+            return;
+        }
+    }
+
+    if (*count == ESP_COMPONENT_BATCH_MAX) {
+        esp_component.cb(batch, *count, esp_component.arg);
+        esp_component.stats.batches++;
+        *count = 0;
+    }
+    batch[(*count)++] = *event;
+}
+
+// wheel timers run on esp_timer task, events they raise go through the queue
+// like the ones of interrupt handlers.
+static void _esp_component_debounce(esp_component_wheel_timer_t *timer, void *arg)
+{
+    esp_component_enc_t *enc = (esp_component_enc_t *)arg;
+    uint8_t id = enc - esp_component.enc;
+    int64_t now = esp_timer_get_time();
+    bool queued = false;
+
+    portENTER_CRITICAL(&esp_component.lock);
+    // an edge swallowed by dead time left the state behind the line.
+    bool pressed = (gpio_get_level(enc->pin_btn) == ESP_COMPONENT_PRESSED);
+    if (pressed != enc->pressed) {
+        enc->pressed = pressed;
+        enc->quiet_until = now + ESP_COMPONENT_DEAD_US;
+        if (pressed)
+            enc->long_sent = false;
+        _esp_component_push(id, pressed ? ESP_COMPONENT_EVENT_PRESS : ESP_COMPONENT_EVENT_RELEASE, 0, now);
+        queued = true;
+    }
+    portEXIT_CRITICAL(&esp_component.lock);
+
+    if (queued)
+        xTaskNotifyGive(esp_component.task);
+}
+
+static void _esp_component_hold(esp_component_wheel_timer_t *timer, void *arg)
+{
+    esp_component_enc_t *enc = (esp_component_enc_t *)arg;
+    uint8_t id = enc - esp_component.enc;
+    int64_t now = esp_timer_get_time();
+    bool queued = false;
+
+    portENTER_CRITICAL(&esp_component.lock);
+    // release raced with expiry, the task cancels the timer after this.
+    if (enc->pressed) {
+        _esp_component_push(id, enc->long_sent ? ESP_COMPONENT_EVENT_REPEAT : ESP_COMPONENT_EVENT_LONG_PRESS, 0, 
+                            now);
+        enc->long_sent = true;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&esp_component.lock);
+
+    if (queued) {
+        if (ESP_COMPONENT_REPEAT_US)
+            esp_component_wheel_arm(&esp_component.wheel, timer, now + ESP_COMPONENT_REPEAT_US);
+        xTaskNotifyGive(esp_component.task);
+    }
+}
+
+// button timers are armed by the event task from the edges it drains, the 
+// event timestamp keeps them on time whatever the queue latency.
+static void _esp_component_arm(const esp_component_event_t *event)
+{
+    esp_component_enc_t *enc = &esp_component.enc[event->id];
+
+    if (event->type == ESP_COMPONENT_EVENT_PRESS) {
+        esp_component_wheel_arm(&esp_component.wheel, &enc->debounce, event->timestamp + ESP_COMPONENT_DEAD_US);
+        esp_component_wheel_arm(&esp_component.wheel, &enc->hold, event->timestamp + ESP_COMPONENT_LONG_US);
+    }
+    else if (event->type == ESP_COMPONENT_EVENT_RELEASE) {
+        esp_component_wheel_arm(&esp_component.wheel, &enc->debounce, event->timestamp + ESP_COMPONENT_DEAD_US);
+        esp_component_wheel_cancel(&esp_component.wheel, &enc->hold);
+    }
+}
+
+static void _esp_component_task(void *arg)
+{
+    esp_component_event_t batch[ESP_COMPONENT_BATCH_MAX];
+    TickType_t window = pdMS_TO_TICKS(ESP_COMPONENT_WINDOW_US / 1000);
+
+    while (true) {
+        // sleep until an edge or a button timer, inputs are never polled.
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (window)
+            vTaskDelay(window);
+
+        size_t count = 0;
+        esp_component_event_t event;
+        while (_esp_component_pop(&event)) {
+            _esp_component_arm(&event);
+            _esp_component_deliver(batch, &count, &event);
+        }
+
+        if (count) {
+            esp_component.cb(batch, count, esp_component.arg);
+            esp_component.stats.batches++;
+        }
+    }
+}
+
+static esp_err_t _esp_component_gpio(gpio_num_t pin, bool pull_down, gpio_isr_t isr, void *arg)
+{
+    gpio_config_t conf = {
+        .pin_bit_mask = 1ULL << pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = pull_down ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+        .pull_down_en = pull_down ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+
+    if ((gpio_config(&conf) != ESP_OK) || (gpio_isr_handler_add(pin, isr, arg) != ESP_OK))
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_component_init(esp_component_cb_t cb, void *arg)
 {
+    if (cb == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if (esp_component.task != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    // application may have installed the service for its own pins.
+    esp_err_t res = gpio_install_isr_service(0);
+    if ((res != ESP_OK) && (res != ESP_ERR_INVALID_STATE))
+        return ESP_FAIL;
+
+    for (uint32_t i = 0; i < ESP_COMPONENT_QUEUE_SIZE; i++)
+        esp_component.cell[i].seq = i;
+    esp_component.cb = cb;
+    esp_component.arg = arg;
+
+    if (esp_component_wheel_init(&esp_component.wheel, ESP_COMPONENT_TICK_US) != ESP_OK)
+        return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(_esp_component_task, "esp_component", ESP_COMPONENT_TASK_STACK, NULL, 
+                    ESP_COMPONENT_TASK_PRIORITY, &esp_component.task) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
     ESP_LOGI(TAG, "init");
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t esp_component_add(gpio_num_t pin_a, gpio_num_t pin_b, gpio_num_t pin_btn, uint8_t *id)
+{
+    bool encoder = (pin_a != GPIO_NUM_NC) && (pin_b != GPIO_NUM_NC);
+
+    if ((id == NULL) || (!encoder && (pin_btn == GPIO_NUM_NC)) || ((pin_a == GPIO_NUM_NC) != (pin_b == GPIO_NUM_NC)))
+        return ESP_ERR_INVALID_ARG;
+
+    if (esp_component.task == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if (esp_component.count >= ESP_COMPONENT_ENC_MAX)
+        return ESP_ERR_NO_MEM;
+
+    esp_component_enc_t *enc = &esp_component.enc[esp_component.count];
+    memset(enc, 0, sizeof(esp_component_enc_t));
+    enc->pin_a = pin_a;
+    enc->pin_b = pin_b;
+    enc->pin_btn = pin_btn;
+    esp_component_wheel_timer_init(&enc->debounce, _esp_component_debounce, enc);
+    esp_component_wheel_timer_init(&enc->hold, _esp_component_hold, enc);
+
+    if (encoder) {
+        if ((_esp_component_gpio(pin_a, false, _esp_component_quad_isr, enc) != ESP_OK) || 
+            (_esp_component_gpio(pin_b, false, _esp_component_quad_isr, enc) != ESP_OK))
+            return ESP_FAIL;
+        enc->ab = (gpio_get_level(pin_a) << 1) | gpio_get_level(pin_b);
+    }
+
+    if (pin_btn != GPIO_NUM_NC) {
+        if (_esp_component_gpio(pin_btn, ESP_COMPONENT_PRESSED, _esp_component_btn_isr, enc) != ESP_OK)
+            return ESP_FAIL;
+        enc->pressed = (gpio_get_level(pin_btn) == ESP_COMPONENT_PRESSED);
+    }
+
+    // publish encoder to the event task once it is set.
+    portENTER_CRITICAL(&esp_component.lock);
+    *id = esp_component.count++;
+    portEXIT_CRITICAL(&esp_component.lock);
+
+    return ESP_OK;
+}
+
+int32_t esp_component_get_position(uint8_t id)
+{
+    if (id >= esp_component.count)
+        return 0;
+
+    return esp_component.enc[id].position;
+}
+
+esp_err_t esp_component_get_stats(esp_component_stats_t *stats, bool reset)
+{
+    if (stats == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&esp_component.lock);
+    *stats = esp_component.stats;
+    if (reset)
+        memset(&esp_component.stats, 0, sizeof(esp_component_stats_t));
+    portEXIT_CRITICAL(&esp_component.lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,211 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file esp_component_wheel.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_component_wheel.h"
+
+static const char *TAG = "esp_component_wheel";
+
+static void _wheel_unlink(esp_component_wheel_timer_t *timer)
+{
+    timer->prev->next = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+static void _wheel_link(esp_component_wheel_timer_t *head, esp_component_wheel_timer_t *timer)
+{
+    timer->prev = head;
+    timer->next = head->next;
+    if (head->next)
+        head->next->prev = timer;
+    head->next = timer;
+}
+
+// caller holds wheel lock.
+static void _wheel_insert(esp_component_wheel_t *wheel, esp_component_wheel_timer_t *timer)
+{
+    int32_t delta = (int32_t)(timer->expires - wheel->now);
+    esp_component_wheel_timer_t *head;
+
+    if (delta < ESP_COMPONENT_WHEEL_SLOTS) {
+        head = &wheel->slot[0][timer->expires & ESP_COMPONENT_WHEEL_MASK];
+    }
+    else {
+        // beyond second level, park in its last lap and place again on cascade.
+        uint32_t lap = timer->expires >> ESP_COMPONENT_WHEEL_BITS;
+        if (delta >= (ESP_COMPONENT_WHEEL_SLOTS * ESP_COMPONENT_WHEEL_SLOTS))
+            lap = (wheel->now >> ESP_COMPONENT_WHEEL_BITS) + ESP_COMPONENT_WHEEL_MASK;
+        head = &wheel->slot[1][lap & ESP_COMPONENT_WHEEL_MASK];
+    }
+
+    _wheel_link(head, timer);
+}
+
+// caller holds wheel lock, esp_timer calls nest in it.
+static void _wheel_run(esp_component_wheel_t *wheel, bool run)
+{
+    if (run == wheel->running)
+        return;
+
+    if (run) {
+        // tick count restarts from the time the wheel wakes up.
+        wheel->base_us = esp_timer_get_time() - ((int64_t)wheel->now * wheel->tick_us);
+        esp_timer_start_periodic(wheel->timer, wheel->tick_us);
+    }
+    else {
+        esp_timer_stop(wheel->timer);
+    }
+    wheel->running = run;
+}
+
+static void _wheel_tick(void *arg)
+{
+    esp_component_wheel_t *wheel = (esp_component_wheel_t *)arg;
+    // expired timers stay linked and pending until their callback runs, one 
+    // armed again or cancelled meanwhile simply leaves this list.
+    esp_component_wheel_timer_t due = {0};
+    esp_component_wheel_timer_t *tail = &due;
+
+    portENTER_CRITICAL(&wheel->lock);
+    // catch up with ticks the esp_timer task was late for.
+    uint32_t target = (uint32_t)((esp_timer_get_time() - wheel->base_us) / wheel->tick_us);
+
+    while ((int32_t)(target - wheel->now) > 0) {
+        wheel->now++;
+
+        // a new lap begins, second level timers due in it come down.
+        if (!(wheel->now & ESP_COMPONENT_WHEEL_MASK)) {
+            esp_component_wheel_timer_t *head = &wheel->slot[1][(wheel->now >> ESP_COMPONENT_WHEEL_BITS) & 
+                                                                 ESP_COMPONENT_WHEEL_MASK];
+            esp_component_wheel_timer_t *timer = head->next;
+            head->next = NULL;
+            while (timer) {
+                esp_component_wheel_timer_t *next = timer->next;
+                _wheel_insert(wheel, timer);
+                timer = next;
+            }
+        }
+
+        // appended, the due list keeps expiry order.
+        esp_component_wheel_timer_t *head = &wheel->slot[0][wheel->now & ESP_COMPONENT_WHEEL_MASK];
+        while (head->next) {
+            esp_component_wheel_timer_t *timer = head->next;
+            _wheel_unlink(timer);
+            _wheel_link(tail, timer);
+            tail = timer;
+        }
+    }
+    portEXIT_CRITICAL(&wheel->lock);
+
+    // callbacks run unlocked, they may arm timers again. Each timer is taken off 
+    // under the lock right before its callback.
+    while (true) {
+        portENTER_CRITICAL(&wheel->lock);
+        esp_component_wheel_timer_t *timer = due.next;
+        if (timer != NULL) {
+            _wheel_unlink(timer);
+            wheel->pending--;
+        }
+        else if (!wheel->pending) {
+            _wheel_run(wheel, false);
+        }
+        portEXIT_CRITICAL(&wheel->lock);
+
+        if (timer == NULL)
+            break;
+        timer->cb(timer, timer->arg);
+    }
+}
+
+esp_err_t esp_component_wheel_init(esp_component_wheel_t *wheel, uint32_t tick_us)
+{
+    if ((wheel == NULL) || !tick_us)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(wheel, 0, sizeof(esp_component_wheel_t));
+    portMUX_INITIALIZE(&wheel->lock);
+    wheel->tick_us = tick_us;
+
+    esp_timer_create_args_t args = {
+        .callback = _wheel_tick,
+        .arg = wheel,
+        .name = "esp_component_wheel",
+    };
+
+    if (esp_timer_create(&args, &wheel->timer) != ESP_OK) {
+        ESP_LOGE(TAG, "fail to create wheel timer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void esp_component_wheel_timer_init(esp_component_wheel_timer_t *timer, esp_component_wheel_cb_t cb, void *arg)
+{
+    memset(timer, 0, sizeof(esp_component_wheel_timer_t));
+    timer->cb = cb;
+    timer->arg = arg;
+}
+
+void esp_component_wheel_arm(esp_component_wheel_t *wheel, esp_component_wheel_timer_t *timer, int64_t at_us)
+{
+    portENTER_CRITICAL(&wheel->lock);
+    if (timer->prev)
+        _wheel_unlink(timer);
+    else
+        wheel->pending++;
+
+    _wheel_run(wheel, true);
+
+    // round up to a tick, a time already gone expires on next tick.
+    int64_t ticks = (at_us - wheel->base_us + wheel->tick_us - 1) / wheel->tick_us;
+    if (ticks <= (int64_t)wheel->now)
+        ticks = (int64_t)wheel->now + 1;
+    timer->expires = (uint32_t)ticks;
+
+    _wheel_insert(wheel, timer);
+    portEXIT_CRITICAL(&wheel->lock);
+}
+
+void esp_component_wheel_cancel(esp_component_wheel_t *wheel, esp_component_wheel_timer_t *timer)
+{
+    portENTER_CRITICAL(&wheel->lock);
+    if (timer->prev) {
+        _wheel_unlink(timer);
+        if (!--wheel->pending)
+            _wheel_run(wheel, false);
+    }
+    portEXIT_CRITICAL(&wheel->lock);
+}
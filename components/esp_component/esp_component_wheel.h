@@ -0,0 +1,120 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file esp_component_wheel.h
+ * 
+ * @brief Hierarchical timer wheel of esp_component, private to the component.
+ * 
+ * Two levels of ESP_COMPONENT_WHEEL_SLOTS slots: the first holds timers due 
+ * within one lap of ticks, one slot per tick, the second one slot per lap. 
+ * Second level slots cascade into the first as their lap comes. Arming and 
+ * cancelling are O(1), a tick costs only the timers due. One esp_timer drives 
+ * the wheel and only runs while timers are armed.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define ESP_COMPONENT_WHEEL_BITS    6
+#define ESP_COMPONENT_WHEEL_SLOTS   (1 << ESP_COMPONENT_WHEEL_BITS)
+#define ESP_COMPONENT_WHEEL_MASK    (ESP_COMPONENT_WHEEL_SLOTS - 1)
+
+typedef struct esp_component_wheel_timer esp_component_wheel_timer_t;
+
+/**
+ * @brief Called from esp_timer task when a timer expires, it may arm timers.
+ */
+typedef void (*esp_component_wheel_cb_t)(esp_component_wheel_timer_t *timer, void *arg);
+
+struct esp_component_wheel_timer
+{
+    esp_component_wheel_timer_t *next;  /*!< Next timer in slot */
+    esp_component_wheel_timer_t *prev;  /*!< Previous timer in slot, or slot head */
+    uint32_t expires;                   /*!< Wheel tick of expiry */
+    esp_component_wheel_cb_t cb;        /*!< Expiry callback */
+    void *arg;                          /*!< Callback argument */
+};
+
+typedef struct
+{
+    esp_component_wheel_timer_t slot[2][ESP_COMPONENT_WHEEL_SLOTS];    /*!< Slot list heads */
+    uint32_t tick_us;                   /*!< Tick period */
+    uint32_t now;                       /*!< Ticks run */
+    int64_t base_us;                    /*!< esp_timer time of tick 0 */
+    uint32_t pending;                   /*!< Timers armed */
+    bool running;                       /*!< Driving esp_timer started */
+    esp_timer_handle_t timer;           /*!< Driving esp_timer */
+    portMUX_TYPE lock;                  /*!< Guards wheel */
+} esp_component_wheel_t;
+
+
+/**
+ * @brief Set-up a wheel, it stays idle until a timer is armed.
+ * 
+ * @param wheel pointer to wheel.
+ * @param tick_us tick period.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to create esp_timer.
+ */
+esp_err_t esp_component_wheel_init(esp_component_wheel_t *wheel, uint32_t tick_us);
+
+
+/**
+ * @brief Set-up a timer, it is not armed.
+ * 
+ * @param timer pointer to timer.
+ * @param cb expiry callback.
+ * @param arg callback argument.
+ */
+void esp_component_wheel_timer_init(esp_component_wheel_timer_t *timer, esp_component_wheel_cb_t cb, void *arg);
+
+
+/**
+ * @brief Arm a timer, or move it if already armed.
+ * 
+ * @note Expiry is rounded up to the next tick, a past time expires on it.
+ * 
+ * @param wheel pointer to wheel.
+ * @param timer pointer to timer.
+ * @param at_us esp_timer time of expiry.
+ */
+void esp_component_wheel_arm(esp_component_wheel_t *wheel, esp_component_wheel_timer_t *timer, int64_t at_us);
+
+
+/**
+ * @brief Cancel a timer, nothing is done if it is not armed.
+ * 
+ * A timer that expired on the tick being handled is still armed until its 
+ * callback runs, another callback of that tick can cancel or move it.
+ * 
+ * @param wheel pointer to wheel.
+ * @param timer pointer to timer.
+ */
+void esp_component_wheel_cancel(esp_component_wheel_t *wheel, esp_component_wheel_timer_t *timer);
@@ -1,7 +1,7 @@
 /* 
  * MIT License
  * 
- * Copyright (c) [year] [fullname]
+ * Copyright (c) 2022 https://github.com/MuriloAM
  * 
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -27,29 +27,116 @@
  * @defgroup esp_component esp_component
  * @{
  *
- * @brief 
+ * @brief Rotary encoders and push buttons driven by GPIO edge interrupts.
+ * 
+ * Encoder A and B edges run a table based quadrature decoder in the interrupt 
+ * handler, which queues one event per detent on a lock-free ring. Buttons are 
+ * debounced with a dead time after each accepted edge. An event task wakes on 
+ * the first queued event, drains the ring and hands the events to the 
+ * application callback in batches, rotations of one encoder merged. Nothing 
+ * is polled, an idle panel costs no CPU time.
  */
 #pragma once
 
 #include "esp_err.h"
+#include "driver/gpio.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define ESP_COMPONENT_BATCH_MAX     16      /*!< Events handed to callback at a time */
+
+typedef enum {
+    ESP_COMPONENT_EVENT_ROTATE = 0,     /*!< Encoder turned, steps tells how far */
+    ESP_COMPONENT_EVENT_PRESS,          /*!< Button pressed */
+    ESP_COMPONENT_EVENT_RELEASE,        /*!< Button released */
+    ESP_COMPONENT_EVENT_LONG_PRESS,     /*!< Button held for CONFIG_ESP_COMPONENT_BTN_LONG_PRESS_TIME_US */
+    ESP_COMPONENT_EVENT_REPEAT          /*!< Button still held, every CONFIG_ESP_COMPONENT_BTN_REPEAT_TIME_US */
+} esp_component_event_type_t;
+
+typedef struct
+{
+    int64_t timestamp;                  /*!< esp_timer time of event, first detent of merged rotations */
+    esp_component_event_type_t type;    /*!< Event type */
+    uint8_t id;                         /*!< Encoder id given by esp_component_add() */
+    int16_t steps;                      /*!< Detents turned, positive clockwise */
+} esp_component_event_t;
+
+typedef struct
+{
+    uint32_t events;                    /*!< Events queued by interrupt handlers and button timers */
+    uint32_t batches;                   /*!< Callback calls */
+    uint32_t overruns;                  /*!< Events lost on a full queue */
+    uint32_t invalid;                   /*!< Quadrature transitions skipping a state */
+} esp_component_stats_t;
+
+/**
+ * @brief Called from the event task with a batch of events.
+ */
+typedef void (*esp_component_cb_t)(const esp_component_event_t *events, size_t count, void *arg);
+
 
 /**
- * @brief 
+ * @brief Start event task and GPIO interrupt service.
  *
- * @note 
+ * @note The GPIO ISR service is installed if the application did not.
+ *
+ * @param cb event batch callback.
+ * @param arg callback argument.
  *
  * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: already started.
+ *     - ESP_ERR_NO_MEM: fail to create event task.
+ *     - ESP_FAIL: fail to install GPIO ISR service.
  */
-esp_err_t esp_component_init(void);
+esp_err_t esp_component_init(esp_component_cb_t cb, void *arg);
+
 
+/**
+ * @brief Add an encoder, its push button or both.
+ *
+ * @param pin_a GPIO of encoder A line, GPIO_NUM_NC for a button alone.
+ * @param pin_b GPIO of encoder B line, GPIO_NUM_NC for a button alone.
+ * @param pin_btn GPIO of push button, GPIO_NUM_NC if none.
+ * @param id receives id reported in events.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: not started.
+ *     - ESP_ERR_NO_MEM: CONFIG_ESP_COMPONENT_MAX encoders already added.
+ *     - ESP_FAIL: fail to set GPIO or its interrupt.
+ */
+esp_err_t esp_component_add(gpio_num_t pin_a, gpio_num_t pin_b, gpio_num_t pin_btn, uint8_t *id);
+
+
+/**
+ * @brief Get encoder position, detents since it was added.
+ *
+ * @param id encoder id.
+ *
+ * @return position, 0 for an unknown id.
+ */
+int32_t esp_component_get_position(uint8_t id);
+
+
+/**
+ * @brief Get driver statistics.
+ *
+ * @param stats receives statistics.
+ * @param reset clear statistics after reading them.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t esp_component_get_stats(esp_component_stats_t *stats, bool reset);
 
 /**@}*/
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,107 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file driver/i2c.h
+ * 
+ * @brief Host stand-in of the ESP-IDF legacy I2C driver.
+ * 
+ * Only the part of the driver used by i2cbus is declared, with the same 
+ * names and semantics. Transactions run on the simulated bus of i2c_sim.h.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int i2c_port_t;
+
+#define I2C_NUM_0   0           /*!< I2C port 0 */
+#define I2C_NUM_1   1           /*!< I2C port 1 */
+#define I2C_NUM_MAX 2           /*!< I2C port max */
+
+typedef enum {
+    I2C_MODE_SLAVE = 0,         /*!< I2C slave mode */
+    I2C_MODE_MASTER,            /*!< I2C master mode */
+    I2C_MODE_MAX,
+} i2c_mode_t;
+
+typedef enum {
+    I2C_MASTER_WRITE = 0,       /*!< I2C write data */
+    I2C_MASTER_READ,            /*!< I2C read data */
+} i2c_rw_t;
+
+typedef enum {
+    I2C_MASTER_ACK = 0x0,       /*!< I2C ack for each byte read */
+    I2C_MASTER_NACK = 0x1,      /*!< I2C nack for each byte read */
+    I2C_MASTER_LAST_NACK = 0x2, /*!< I2C nack for the last byte */
+    I2C_MASTER_ACK_MAX,
+} i2c_ack_type_t;
+
+typedef struct {
+    i2c_mode_t mode;            /*!< I2C mode */
+    int sda_io_num;             /*!< GPIO number for I2C sda signal */
+    int scl_io_num;             /*!< GPIO number for I2C scl signal */
+    bool sda_pullup_en;         /*!< Internal GPIO pull mode for I2C sda signal */
+    bool scl_pullup_en;         /*!< Internal GPIO pull mode for I2C scl signal */
+    union {
+        struct {
+            uint32_t clk_speed;         /*!< I2C clock frequency for master mode */
+        } master;
+        struct {
+            uint8_t addr_10bit_en;      /*!< I2C 10bit address mode enable for slave mode */
+            uint16_t slave_addr;        /*!< I2C address for slave mode */
+            uint32_t maximum_speed;     /*!< I2C expected clock speed from SCL */
+        } slave;
+    };
+    uint32_t clk_flags;         /*!< Bitwise of I2C_SCLK_SRC_FLAG_**FOR_DFS** */
+} i2c_config_t;
+
+typedef void *i2c_cmd_handle_t;
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf);
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, 
+                             int intr_alloc_flags);
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num);
+
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack);
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
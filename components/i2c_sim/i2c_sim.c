@@ -0,0 +1,447 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim.c
+ * 
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include "esp32/rom/ets_sys.h"
+#include "i2c_sim.h"
+
+// LOCAL CONST
+#ifdef CONFIG_I2C_MASTER_FREQ
+#define I2C_SIM_DEFAULT_FREQ    CONFIG_I2C_MASTER_FREQ  /*!< Clock of a port configured without speed */
+#else
+#define I2C_SIM_DEFAULT_FREQ    100000
+#endif
+#define I2C_SIM_BYTE_BITS       9                       /*!< Data bits and ACK bit */
+#define I2C_SIM_COND_BITS       1                       /*!< Start, repeated start or stop condition */
+
+#ifdef CONFIG_I2C_SIM_REALTIME
+#define I2C_SIM_REALTIME        true
+#else
+#define I2C_SIM_REALTIME        false
+#endif
+
+static const char *TAG = "i2c_sim";
+
+typedef enum {
+    I2C_SIM_CMD_START = 0,
+    I2C_SIM_CMD_WRITE,
+    I2C_SIM_CMD_READ,
+    I2C_SIM_CMD_STOP
+} i2c_sim_cmd_type_t;
+
+typedef struct i2c_sim_cmd {
+    i2c_sim_cmd_type_t type;    /*!< Command */
+    uint8_t byte;               /*!< Storage of i2c_master_write_byte() */
+    const uint8_t *wr;          /*!< Bytes to write, owned by caller as on target */
+    uint8_t *rd;                /*!< Buffer of bytes read */
+    size_t size;                /*!< Bytes to write or read */
+    bool ack_en;                /*!< Check slave ACK on write */
+    i2c_ack_type_t ack;         /*!< Master ACK on read */
+    struct i2c_sim_cmd *next;
+} i2c_sim_cmd_t;
+
+typedef struct {
+    i2c_sim_cmd_t *first;
+    i2c_sim_cmd_t *last;
+} i2c_sim_link_t;
+
+typedef struct {
+    i2c_config_t conf;          /*!< Port configuration */
+    bool installed;             /*!< Driver installed */
+    SemaphoreHandle_t mutex;    /*!< Stands for the driver command lock */
+    i2c_sim_device_t *devices;  /*!< Attached device models */
+    TaskHandle_t last_task;     /*!< Task of previous transaction */
+    bool held;                  /*!< Previous link ended without stop, bus still owned */
+    i2c_sim_device_t *held_dev; /*!< Device addressed by the held transaction */
+    bool held_reading;          /*!< Held transaction direction */
+    uint32_t max_freq;          /*!< Fastest clock the wiring carries, 0 for any */
+    i2c_sim_stats_t stats;      /*!< Bus statistics */
+} i2c_sim_port_t;
+
+static i2c_sim_port_t sim_port[I2C_NUM_MAX];
+static int64_t sim_time_ns;
+static bool sim_realtime = I2C_SIM_REALTIME;
+
+static int64_t _sim_host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static void _sim_wait(int64_t ns)
+{
+    // on target the bus or the delay keeps the caller for this long.
+    int64_t until = _sim_host_ns() + ns;
+    while (_sim_host_ns() < until)
+        ;
+}
+
+static void _sim_bits(i2c_sim_port_t *sp, uint32_t bits)
+{
+    uint32_t freq = sp->conf.master.clk_speed ? sp->conf.master.clk_speed : I2C_SIM_DEFAULT_FREQ;
+    int64_t ns = ((int64_t)bits * 1000000000) / freq;
+
+    sp->stats.bits += bits;
+    sp->stats.wire_time_ns += ns;
+    __atomic_add_fetch(&sim_time_ns, ns, __ATOMIC_RELAXED);
+}
+
+static i2c_sim_device_t *_sim_find(i2c_sim_port_t *sp, uint8_t addr)
+{
+    for (i2c_sim_device_t *dev = sp->devices; dev; dev = dev->next) {
+        if (dev->addr == addr)
+            return dev;
+    }
+    return NULL;
+}
+
+static esp_err_t _sim_append(i2c_cmd_handle_t cmd_handle, i2c_sim_cmd_t *cmd)
+{
+    i2c_sim_link_t *link = (i2c_sim_link_t *)cmd_handle;
+
+    if (link == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_cmd_t *item = malloc(sizeof(i2c_sim_cmd_t));
+    if (item == NULL)
+        return ESP_ERR_NO_MEM;
+
+    *item = *cmd;
+    item->next = NULL;
+    if (link->last)
+        link->last->next = item;
+    else
+        link->first = item;
+    link->last = item;
+
+    return ESP_OK;
+}
+
+static esp_err_t _sim_run(i2c_sim_port_t *sp, i2c_sim_link_t *link)
+{
+    // a link may go on with a transaction the previous one left open.
+    i2c_sim_device_t *dev = sp->held ? sp->held_dev : NULL;
+    // edges too slow for the clock, no device recognizes its address.
+    bool garbled = sp->max_freq && sp->conf.master.clk_speed && (sp->conf.master.clk_speed > sp->max_freq);
+    bool addressing = false;
+    bool reading = sp->held && sp->held_reading;
+    bool active = sp->held;
+    bool stopped = false;
+
+    sp->held = false;
+
+    for (i2c_sim_cmd_t *cmd = link->first; cmd; cmd = cmd->next) {
+        switch (cmd->type) {
+            case I2C_SIM_CMD_START:
+                _sim_bits(sp, I2C_SIM_COND_BITS);
+                sp->stats.starts++;
+                addressing = true;
+                active = true;
+                stopped = false;
+            break;
+            case I2C_SIM_CMD_WRITE:
+                for (size_t i = 0; i < cmd->size; i++) {
+                    uint8_t data = cmd->wr ? cmd->wr[i] : cmd->byte;
+                    bool ack;
+
+                    _sim_bits(sp, I2C_SIM_BYTE_BITS);
+                    sp->stats.bytes_written++;
+
+                    // first byte after a start selects device and direction.
+                    if (addressing) {
+                        addressing = false;
+                        reading = data & 1;
+                        dev = garbled ? NULL : _sim_find(sp, data >> 1);
+                        ack = dev && dev->ops->start(dev->ctx, reading);
+                    } else {
+                        ack = dev && !reading && dev->ops->write(dev->ctx, data);
+                    }
+
+                    // controller gives up and sends a stop on an unexpected NACK.
+                    if (!ack && cmd->ack_en) {
+                        sp->stats.nacks++;
+                        _sim_bits(sp, I2C_SIM_COND_BITS);
+                        if (dev && dev->ops->stop)
+                            dev->ops->stop(dev->ctx);
+                        return ESP_FAIL;
+                    }
+                }
+            break;
+            case I2C_SIM_CMD_READ:
+                for (size_t i = 0; i < cmd->size; i++) {
+                    bool ack = (cmd->ack == I2C_MASTER_ACK) || 
+                               ((cmd->ack == I2C_MASTER_LAST_NACK) && ((i + 1) < cmd->size));
+
+                    _sim_bits(sp, I2C_SIM_BYTE_BITS);
+                    sp->stats.bytes_read++;
+                    // nobody drives SDA, pull-ups read as ones.
+                    cmd->rd[i] = (dev && reading) ? dev->ops->read(dev->ctx, ack) : 0xFF;
+                }
+            break;
+            case I2C_SIM_CMD_STOP:
+                _sim_bits(sp, I2C_SIM_COND_BITS);
+                if (dev && dev->ops->stop)
+                    dev->ops->stop(dev->ctx);
+                dev = NULL;
+                active = false;
+                stopped = true;
+            break;
+        }
+    }
+
+    // no stop, controller keeps SCL low and the next link continues.
+    if (active) {
+        sp->held = true;
+        sp->held_dev = dev;
+        sp->held_reading = reading;
+        return ESP_OK;
+    }
+
+    return stopped ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    if ((i2c_num >= I2C_NUM_MAX) || (i2c_conf == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    sim_port[i2c_num].conf = *i2c_conf;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, 
+                             int intr_alloc_flags)
+{
+    if ((i2c_num >= I2C_NUM_MAX) || (mode >= I2C_MODE_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_port_t *sp = &sim_port[i2c_num];
+    if (sp->installed)
+        return ESP_FAIL;
+
+    sp->mutex = xSemaphoreCreateMutex();
+    if (sp->mutex == NULL)
+        return ESP_ERR_NO_MEM;
+
+    memset(&sp->stats, 0, sizeof(i2c_sim_stats_t));
+    sp->installed = true;
+
+    ESP_LOGI(TAG, "port %d installed at %u Hz", i2c_num, (unsigned)sp->conf.master.clk_speed);
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    if ((i2c_num >= I2C_NUM_MAX) || !sim_port[i2c_num].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    vSemaphoreDelete(sim_port[i2c_num].mutex);
+    sim_port[i2c_num].mutex = NULL;
+    sim_port[i2c_num].installed = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    return calloc(1, sizeof(i2c_sim_link_t));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_sim_link_t *link = (i2c_sim_link_t *)cmd_handle;
+
+    if (link == NULL)
+        return;
+
+    while (link->first) {
+        i2c_sim_cmd_t *cmd = link->first;
+        link->first = cmd->next;
+        free(cmd);
+    }
+    free(link);
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_sim_cmd_t cmd = { .type = I2C_SIM_CMD_START };
+    return _sim_append(cmd_handle, &cmd);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    i2c_sim_cmd_t cmd = { .type = I2C_SIM_CMD_WRITE, .byte = data, .size = 1, .ack_en = ack_en };
+    return _sim_append(cmd_handle, &cmd);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+    if ((data == NULL) && data_len)
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_cmd_t cmd = { .type = I2C_SIM_CMD_WRITE, .wr = data, .size = data_len, .ack_en = ack_en };
+    return _sim_append(cmd_handle, &cmd);
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack)
+{
+    return i2c_master_read(cmd_handle, data, 1, (ack == I2C_MASTER_LAST_NACK) ? I2C_MASTER_NACK : ack);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+    if ((data == NULL) || !data_len || (ack >= I2C_MASTER_ACK_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_cmd_t cmd = { .type = I2C_SIM_CMD_READ, .rd = data, .size = data_len, .ack = ack };
+    return _sim_append(cmd_handle, &cmd);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_sim_cmd_t cmd = { .type = I2C_SIM_CMD_STOP };
+    return _sim_append(cmd_handle, &cmd);
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+    if ((i2c_num >= I2C_NUM_MAX) || (cmd_handle == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_port_t *sp = &sim_port[i2c_num];
+    if (!sp->installed)
+        return ESP_ERR_INVALID_STATE;
+
+    // port already in use means callers are not serialized above the driver.
+    if (xSemaphoreTake(sp->mutex, 0) != pdTRUE) {
+        __atomic_add_fetch(&sp->stats.overlaps, 1, __ATOMIC_RELAXED);
+        if (xSemaphoreTake(sp->mutex, ticks_to_wait) != pdTRUE)
+            return ESP_ERR_TIMEOUT;
+    }
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (sp->last_task && (sp->last_task != task))
+        sp->stats.handoffs++;
+    sp->last_task = task;
+
+    int64_t start = i2c_sim_time_ns();
+    sp->stats.transactions++;
+    esp_err_t res = _sim_run(sp, (i2c_sim_link_t *)cmd_handle);
+    int64_t wire_ns = i2c_sim_time_ns() - start;
+
+    xSemaphoreGive(sp->mutex);
+
+    // wire time was already added to the simulated clock bit by bit.
+    if (sim_realtime)
+        _sim_wait(wire_ns);
+
+    return res;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    __atomic_add_fetch(&sim_time_ns, (int64_t)us * 1000, __ATOMIC_RELAXED);
+
+    if (sim_realtime)
+        _sim_wait((int64_t)us * 1000);
+}
+
+esp_err_t i2c_sim_attach(i2c_port_t port, i2c_sim_device_t *dev, uint8_t addr, const i2c_sim_ops_t *ops, void *ctx)
+{
+    if ((port >= I2C_NUM_MAX) || (dev == NULL) || (addr > 0x7F) || (ops == NULL) || 
+        (ops->start == NULL) || (ops->write == NULL) || (ops->read == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    i2c_sim_port_t *sp = &sim_port[port];
+    if (_sim_find(sp, addr))
+        return ESP_ERR_INVALID_STATE;
+
+    dev->addr = addr;
+    dev->ops = ops;
+    dev->ctx = ctx;
+    dev->next = sp->devices;
+    sp->devices = dev;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_sim_detach(i2c_port_t port, i2c_sim_device_t *dev)
+{
+    if ((port >= I2C_NUM_MAX) || (dev == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    for (i2c_sim_device_t **it = &sim_port[port].devices; *it; it = &(*it)->next) {
+        if (*it == dev) {
+            *it = dev->next;
+            dev->next = NULL;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+void i2c_sim_get_stats(i2c_port_t port, i2c_sim_stats_t *stats)
+{
+    if ((port >= I2C_NUM_MAX) || (stats == NULL))
+        return;
+
+    *stats = sim_port[port].stats;
+}
+
+void i2c_sim_reset_stats(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    memset(&sim_port[port].stats, 0, sizeof(i2c_sim_stats_t));
+}
+
+int64_t i2c_sim_time_ns(void)
+{
+    return __atomic_load_n(&sim_time_ns, __ATOMIC_RELAXED);
+}
+
+void i2c_sim_set_realtime(bool realtime)
+{
+    sim_realtime = realtime;
+}
+
+void i2c_sim_set_max_freq(i2c_port_t port, uint32_t max_freq)
+{
+    if (port >= I2C_NUM_MAX)
+        return;
+
+    sim_port[port].max_freq = max_freq;
+}
@@ -0,0 +1,129 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_eeprom.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "i2c_sim_eeprom.h"
+
+static bool _eeprom_start(void *ctx, bool read)
+{
+    i2c_sim_eeprom_t *eep = (i2c_sim_eeprom_t *)ctx;
+
+    // no answer while programming, masters poll the address for completion.
+    if (i2c_sim_time_ns() < eep->busy_until_ns) {
+        eep->busy_nacks++;
+        return false;
+    }
+
+    // a repeated start instead of a stop drops a page write.
+    eep->pending = false;
+    memset(eep->dirty, 0, sizeof(eep->dirty));
+
+    if (!read)
+        eep->addr_count = 0;
+    return true;
+}
+
+static bool _eeprom_write(void *ctx, uint8_t data)
+{
+    i2c_sim_eeprom_t *eep = (i2c_sim_eeprom_t *)ctx;
+
+    if (eep->addr_count < eep->addr_size) {
+        if (!eep->addr_count)
+            eep->ptr = 0;
+        eep->ptr = (eep->ptr << 8) | data;
+        if (++eep->addr_count == eep->addr_size)
+            eep->ptr %= eep->size;
+        return true;
+    }
+
+    // the pointer rolls over within the page, bytes past its end overwrite
+    // its beginning.
+    size_t col = eep->ptr % eep->page_size;
+    eep->page[col] = data;
+    eep->dirty[col / 8] |= 1 << (col % 8);
+    eep->ptr = (eep->ptr - col) + ((col + 1) % eep->page_size);
+    eep->pending = true;
+    eep->writes++;
+    return true;
+}
+
+static uint8_t _eeprom_read(void *ctx, bool ack)
+{
+    i2c_sim_eeprom_t *eep = (i2c_sim_eeprom_t *)ctx;
+    uint8_t data = eep->mem[eep->ptr];
+
+    eep->ptr = (eep->ptr + 1) % eep->size;
+    eep->reads++;
+    return data;
+}
+
+static void _eeprom_stop(void *ctx)
+{
+    i2c_sim_eeprom_t *eep = (i2c_sim_eeprom_t *)ctx;
+
+    if (!eep->pending)
+        return;
+
+    // program the page the pointer is in, only bytes written.
+    size_t base = eep->ptr - (eep->ptr % eep->page_size);
+    for (size_t col = 0; col < eep->page_size; col++) {
+        if (eep->dirty[col / 8] & (1 << (col % 8)))
+            eep->mem[base + col] = eep->page[col];
+    }
+
+    eep->pending = false;
+    memset(eep->dirty, 0, sizeof(eep->dirty));
+    eep->busy_until_ns = i2c_sim_time_ns() + ((int64_t)eep->write_cycle_us * 1000);
+    eep->write_cycles++;
+}
+
+static const i2c_sim_ops_t eeprom_ops = {
+    .start = _eeprom_start,
+    .write = _eeprom_write,
+    .read = _eeprom_read,
+    .stop = _eeprom_stop,
+};
+
+esp_err_t i2c_sim_eeprom_attach(i2c_port_t port, i2c_sim_eeprom_t *eep, uint8_t addr, uint8_t *mem, size_t size, 
+                                size_t page_size, uint8_t addr_size)
+{
+    if ((eep == NULL) || (mem == NULL) || !size || !page_size || (page_size > I2C_SIM_EEPROM_PAGE_MAX) || 
+        (page_size & (page_size - 1)) || (size % page_size) || (addr_size < 1) || (addr_size > 2))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(eep, 0, sizeof(i2c_sim_eeprom_t));
+    eep->mem = mem;
+    eep->size = size;
+    eep->page_size = page_size;
+    eep->addr_size = addr_size;
+    eep->write_cycle_us = I2C_SIM_EEPROM_WRITE_CYCLE_US;
+
+    return i2c_sim_attach(port, &eep->dev, addr, &eeprom_ops, eep);
+}
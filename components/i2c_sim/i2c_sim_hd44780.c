@@ -0,0 +1,255 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_hd44780.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "i2c_sim_hd44780.h"
+
+// LOCAL CONST
+#define HD44780_PIN_RS          0x01
+#define HD44780_PIN_RW          0x02
+#define HD44780_PIN_EN          0x04
+#define HD44780_PIN_BKL         0x08
+
+#define HD44780_LINE_SIZE       40          /*!< DDRAM columns of a line in 2-line mode */
+#define HD44780_LINE2_ADDR      0x40        /*!< DDRAM address of second line */
+#define HD44780_1LINE_SIZE      80          /*!< DDRAM size in 1-line mode */
+
+// execution times at fosc 270 kHz, nanoseconds.
+#define HD44780_POWER_ON_NS     15000000
+#define HD44780_RESET1_NS       4100000
+#define HD44780_RESET2_NS       100000
+#define HD44780_HOME_NS         1520000
+#define HD44780_EXEC_NS         37000
+
+static uint8_t _hd44780_ddram_next(const i2c_sim_hd44780_t *lcd, uint8_t ac, bool increment)
+{
+    if (!lcd->two_line)
+        return increment ? (ac + 1) % HD44780_1LINE_SIZE : (ac + HD44780_1LINE_SIZE - 1) % HD44780_1LINE_SIZE;
+
+    // end of a line continues on the other one.
+    uint8_t line = ac & HD44780_LINE2_ADDR;
+    uint8_t col = (ac & ~HD44780_LINE2_ADDR) % HD44780_LINE_SIZE;
+    if (increment) {
+        if (++col == HD44780_LINE_SIZE) {
+            col = 0;
+            line ^= HD44780_LINE2_ADDR;
+        }
+    } else {
+        if (col-- == 0) {
+            col = HD44780_LINE_SIZE - 1;
+            line ^= HD44780_LINE2_ADDR;
+        }
+    }
+    return line | col;
+}
+
+static void _hd44780_shift(i2c_sim_hd44780_t *lcd, bool left)
+{
+    uint8_t size = lcd->two_line ? HD44780_LINE_SIZE : HD44780_1LINE_SIZE;
+
+    // shifting the display left moves the window right over DDRAM.
+    lcd->origin = left ? (lcd->origin + 1) % size : (lcd->origin + size - 1) % size;
+}
+
+static int64_t _hd44780_instruction(i2c_sim_hd44780_t *lcd, uint8_t cmd)
+{
+    lcd->stats.instructions++;
+
+    if (cmd & 0x80) {
+        // set DDRAM address.
+        lcd->ac = cmd & 0x7F;
+        lcd->ac_cgram = false;
+    } else if (cmd & 0x40) {
+        // set CGRAM address.
+        lcd->ac = cmd & 0x3F;
+        lcd->ac_cgram = true;
+    } else if (cmd & 0x20) {
+        // function set, DL N F.
+        lcd->two_line = cmd & 0x08;
+        if (!(cmd & 0x10)) {
+            lcd->four_bit = true;
+            lcd->resets = 0;
+        } else if (lcd->four_bit) {
+            lcd->four_bit = false;
+            lcd->nibble_pending = false;
+        } else {
+            // reset by instruction needs longer waits after first two.
+            switch (lcd->resets++) {
+                case 0: return HD44780_RESET1_NS;
+                case 1: return HD44780_RESET2_NS;
+                default: break;
+            }
+        }
+    } else if (cmd & 0x10) {
+        // cursor or display shift, S/C R/L.
+        if (cmd & 0x08)
+            _hd44780_shift(lcd, !(cmd & 0x04));
+        else if (!lcd->ac_cgram)
+            lcd->ac = _hd44780_ddram_next(lcd, lcd->ac, cmd & 0x04);
+    } else if (cmd & 0x08) {
+        // display on/off control, D C B.
+        lcd->display_on = cmd & 0x04;
+        lcd->cursor_on = cmd & 0x02;
+        lcd->blink_on = cmd & 0x01;
+    } else if (cmd & 0x04) {
+        // entry mode set, I/D S.
+        lcd->increment = cmd & 0x02;
+        lcd->shift_on_write = cmd & 0x01;
+    } else if (cmd & 0x02) {
+        // return home.
+        lcd->ac = 0;
+        lcd->ac_cgram = false;
+        lcd->origin = 0;
+        return HD44780_HOME_NS;
+    } else if (cmd & 0x01) {
+        // clear display.
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->ac = 0;
+        lcd->ac_cgram = false;
+        lcd->origin = 0;
+        lcd->increment = true;
+        return HD44780_HOME_NS;
+    }
+
+    return HD44780_EXEC_NS;
+}
+
+static int64_t _hd44780_data(i2c_sim_hd44780_t *lcd, uint8_t data)
+{
+    lcd->stats.chars++;
+
+    if (lcd->ac_cgram) {
+        lcd->cgram[lcd->ac] = data;
+        lcd->ac = (lcd->ac + (lcd->increment ? 1 : -1)) & (I2C_SIM_HD44780_CGRAM_SIZE - 1);
+    } else {
+        lcd->ddram[lcd->ac & 0x7F] = data;
+        lcd->ac = _hd44780_ddram_next(lcd, lcd->ac, lcd->increment);
+        if (lcd->shift_on_write)
+            _hd44780_shift(lcd, lcd->increment);
+    }
+
+    return HD44780_EXEC_NS;
+}
+
+static void _hd44780_exec(i2c_sim_hd44780_t *lcd, bool rs, uint8_t op, bool busy, int64_t now)
+{
+    if (busy) {
+        lcd->stats.violations++;
+        lcd->stats.last_violation_ns = now;
+        lcd->stats.last_violation_op = op;
+    }
+
+    int64_t exec_ns = rs ? _hd44780_data(lcd, op) : _hd44780_instruction(lcd, op);
+    lcd->busy_until_ns = now + exec_ns;
+}
+
+static void _hd44780_on_write(i2c_sim_pcf8574_t *pcf, uint8_t prev, uint8_t latch, void *arg)
+{
+    i2c_sim_hd44780_t *lcd = (i2c_sim_hd44780_t *)arg;
+
+    lcd->backlight = latch & HD44780_PIN_BKL;
+
+    // controller latches DB4-DB7 on EN falling edge.
+    if (!(prev & HD44780_PIN_EN) || (latch & HD44780_PIN_EN))
+        return;
+
+    lcd->stats.nibbles++;
+    if (prev & HD44780_PIN_RW) {
+        lcd->stats.reads++;
+        return;
+    }
+
+    int64_t now = i2c_sim_time_ns();
+    bool busy = now < lcd->busy_until_ns;
+    bool rs = prev & HD44780_PIN_RS;
+    uint8_t nibble = prev & 0xF0;
+
+    // 8-bit interface, DB0-DB3 are not wired and read as low.
+    if (!lcd->four_bit) {
+        _hd44780_exec(lcd, rs, nibble, busy, now);
+        return;
+    }
+
+    if (!lcd->nibble_pending) {
+        lcd->nibble_pending = true;
+        lcd->nibble = nibble;
+        lcd->nibble_rs = rs;
+        lcd->nibble_busy = busy;
+        return;
+    }
+
+    lcd->nibble_pending = false;
+    _hd44780_exec(lcd, lcd->nibble_rs, lcd->nibble | (nibble >> 4), lcd->nibble_busy || busy, now);
+}
+
+esp_err_t i2c_sim_hd44780_attach(i2c_port_t port, i2c_sim_hd44780_t *lcd, uint8_t addr, uint8_t cols, uint8_t rows)
+{
+    if ((lcd == NULL) || ((cols != 16) && (cols != 20)) || ((rows != 2) && (rows != 4)))
+        return ESP_ERR_INVALID_ARG;
+
+    // power-on state, 8-bit interface, 1-line, display off, increment.
+    memset(lcd, 0, sizeof(i2c_sim_hd44780_t));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->cols = cols;
+    lcd->rows = rows;
+    lcd->increment = true;
+    lcd->busy_until_ns = i2c_sim_time_ns() + HD44780_POWER_ON_NS;
+
+    return i2c_sim_pcf8574_attach(port, &lcd->io, addr, _hd44780_on_write, lcd);
+}
+
+esp_err_t i2c_sim_hd44780_render(const i2c_sim_hd44780_t *lcd, char *buf, size_t size)
+{
+    if ((lcd == NULL) || (buf == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    if (size < ((lcd->rows * (lcd->cols + 1)) + 1))
+        return ESP_ERR_INVALID_SIZE;
+
+    for (int row = 0; row < lcd->rows; row++) {
+        for (int col = 0; col < lcd->cols; col++) {
+            uint8_t data = ' ';
+
+            // 4-row modules continue each DDRAM line on rows 2 and 3.
+            if (lcd->two_line) {
+                uint8_t line = (row & 1) ? HD44780_LINE2_ADDR : 0;
+                data = lcd->ddram[line + ((lcd->origin + ((row >> 1) * lcd->cols) + col) % HD44780_LINE_SIZE)];
+            } else if (row == 0) {
+                data = lcd->ddram[(lcd->origin + col) % HD44780_1LINE_SIZE];
+            }
+
+            *buf++ = (data < 0x08) ? (data + 0x08) : data;
+        }
+        *buf++ = '\n';
+    }
+    *buf = '\0';
+
+    return ESP_OK;
+}
@@ -0,0 +1,80 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_pcf8574.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "i2c_sim_pcf8574.h"
+
+static bool _pcf8574_start(void *ctx, bool read)
+{
+    return true;
+}
+
+static bool _pcf8574_write(void *ctx, uint8_t data)
+{
+    i2c_sim_pcf8574_t *pcf = (i2c_sim_pcf8574_t *)ctx;
+    uint8_t prev = pcf->latch;
+
+    pcf->latch = data;
+    pcf->writes++;
+    if (pcf->on_write)
+        pcf->on_write(pcf, prev, data, pcf->arg);
+
+    return true;
+}
+
+static uint8_t _pcf8574_read(void *ctx, bool ack)
+{
+    i2c_sim_pcf8574_t *pcf = (i2c_sim_pcf8574_t *)ctx;
+
+    pcf->reads++;
+    return pcf->latch & pcf->input;
+}
+
+static const i2c_sim_ops_t pcf8574_ops = {
+    .start = _pcf8574_start,
+    .write = _pcf8574_write,
+    .read = _pcf8574_read,
+    .stop = NULL,
+};
+
+esp_err_t i2c_sim_pcf8574_attach(i2c_port_t port, i2c_sim_pcf8574_t *pcf, uint8_t addr, 
+                                 i2c_sim_pcf8574_cb_t on_write, void *arg)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(pcf, 0, sizeof(i2c_sim_pcf8574_t));
+    pcf->latch = 0xFF;
+    pcf->input = 0xFF;
+    pcf->on_write = on_write;
+    pcf->arg = arg;
+
+    return i2c_sim_attach(port, &pcf->dev, addr, &pcf8574_ops, pcf);
+}
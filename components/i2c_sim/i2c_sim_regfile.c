@@ -0,0 +1,92 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_regfile.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "i2c_sim_regfile.h"
+
+static bool _regfile_start(void *ctx, bool read)
+{
+    i2c_sim_regfile_t *rf = (i2c_sim_regfile_t *)ctx;
+
+    // a write transaction always begins with the register address.
+    if (!read) {
+        rf->addr_count = 0;
+        rf->ptr = 0;
+    }
+    return true;
+}
+
+static bool _regfile_write(void *ctx, uint8_t data)
+{
+    i2c_sim_regfile_t *rf = (i2c_sim_regfile_t *)ctx;
+
+    if (rf->addr_count < rf->addr_size) {
+        rf->ptr = (rf->ptr << 8) | data;
+        if (++rf->addr_count == rf->addr_size)
+            rf->ptr %= rf->size;
+        return true;
+    }
+
+    rf->mem[rf->ptr] = data;
+    rf->ptr = (rf->ptr + 1) % rf->size;
+    rf->writes++;
+    return true;
+}
+
+static uint8_t _regfile_read(void *ctx, bool ack)
+{
+    i2c_sim_regfile_t *rf = (i2c_sim_regfile_t *)ctx;
+    uint8_t data = rf->mem[rf->ptr];
+
+    rf->ptr = (rf->ptr + 1) % rf->size;
+    rf->reads++;
+    return data;
+}
+
+static const i2c_sim_ops_t regfile_ops = {
+    .start = _regfile_start,
+    .write = _regfile_write,
+    .read = _regfile_read,
+    .stop = NULL,
+};
+
+esp_err_t i2c_sim_regfile_attach(i2c_port_t port, i2c_sim_regfile_t *rf, uint8_t addr, uint8_t *mem, size_t size, 
+                                 uint8_t addr_size)
+{
+    if ((rf == NULL) || (mem == NULL) || !size || (addr_size < 1) || (addr_size > 2))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(rf, 0, sizeof(i2c_sim_regfile_t));
+    rf->mem = mem;
+    rf->size = size;
+    rf->addr_size = addr_size;
+
+    return i2c_sim_attach(port, &rf->dev, addr, &regfile_ops, rf);
+}
@@ -0,0 +1,160 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim.h
+ * @defgroup i2c_sim i2c_sim
+ * @{
+ *
+ * @brief Simulated I2C bus for host builds.
+ * 
+ * It backs the host stand-in of driver/i2c.h, so i2cbus and every driver on 
+ * top of it run unchanged on a developer machine. Each transaction is played 
+ * against the device models attached to its port, and its wire time is 
+ * accounted from the port clock speed: one bit for each start, repeated start 
+ * and stop condition, and nine bits for each byte with its ACK. A simulated 
+ * clock advances by that time and by ets_delay_us(), so device models and 
+ * measurements see target timing whatever the host speed.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "driver/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bool (*start)(void *ctx, bool read);        /*!< Device addressed, return false to NACK */
+    bool (*write)(void *ctx, uint8_t data);     /*!< Byte from master, return false to NACK */
+    uint8_t (*read)(void *ctx, bool ack);       /*!< Byte to master, ack tells if master acknowledges it */
+    void (*stop)(void *ctx);                    /*!< Transaction ended, may be NULL */
+} i2c_sim_ops_t;
+
+typedef struct i2c_sim_device
+{
+    uint8_t addr;                   /*!< 7-bit device address */
+    const i2c_sim_ops_t *ops;       /*!< Device model */
+    void *ctx;                      /*!< Model state */
+    struct i2c_sim_device *next;    /*!< Next device on port */
+} i2c_sim_device_t;
+
+typedef struct
+{
+    uint32_t transactions;      /*!< i2c_master_cmd_begin() calls */
+    uint32_t starts;            /*!< Start and repeated start conditions */
+    uint32_t nacks;             /*!< Transactions aborted by a NACK */
+    uint32_t overlaps;          /*!< Transactions that found port in use */
+    uint32_t handoffs;          /*!< Transactions issued by another task than the previous one */
+    uint64_t bytes_written;     /*!< Bytes sent by master, address included */
+    uint64_t bytes_read;        /*!< Bytes received by master */
+    uint64_t bits;              /*!< Bits on the wire */
+    uint64_t wire_time_ns;      /*!< Time on the wire */
+} i2c_sim_stats_t;
+
+
+/**
+ * @brief Attach a device model to a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param dev device storage, it must live until detached.
+ * @param addr 7-bit device address.
+ * @param ops device model callbacks.
+ * @param ctx model state passed to callbacks.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: address already in use.
+ *
+ * @note attach and detach devices while the port is idle.
+ */
+esp_err_t i2c_sim_attach(i2c_port_t port, i2c_sim_device_t *dev, uint8_t addr, const i2c_sim_ops_t *ops, void *ctx);
+
+
+/**
+ * @brief Detach a device model from a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param dev device storage given to i2c_sim_attach().
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NOT_FOUND: device not attached to port.
+ */
+esp_err_t i2c_sim_detach(i2c_port_t port, i2c_sim_device_t *dev);
+
+
+/**
+ * @brief Get bus statistics of a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param stats receives statistics since port install or last reset.
+ */
+void i2c_sim_get_stats(i2c_port_t port, i2c_sim_stats_t *stats);
+
+
+/**
+ * @brief Clear bus statistics of a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ */
+void i2c_sim_reset_stats(i2c_port_t port);
+
+
+/**
+ * @brief Get the simulated clock.
+ * 
+ * @note Inside a device callback it is the time of the bit being handled.
+ *
+ * @return simulated time in nanoseconds.
+ */
+int64_t i2c_sim_time_ns(void);
+
+
+/**
+ * @brief Choose if bus time and delays are also spent in real time.
+ * 
+ * @param realtime true to busy wait for every simulated transaction and delay.
+ */
+void i2c_sim_set_realtime(bool realtime);
+
+
+/**
+ * @brief Model the wiring of a port, cable capacitance and pull-ups.
+ * 
+ * @note Above max_freq every address is nacked, as garbled edges are.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param max_freq fastest clock the wiring carries, 0 for any.
+ */
+void i2c_sim_set_max_freq(i2c_port_t port, uint32_t max_freq);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,96 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_eeprom.h
+ * @defgroup i2c_sim_eeprom i2c_sim_eeprom
+ * @ingroup i2c_sim
+ * @{
+ *
+ * @brief 24Cxx serial EEPROM model.
+ * 
+ * The first addr_size bytes of a write transaction set the address pointer, 
+ * most significant byte first. Data bytes that follow go to a page buffer, 
+ * rolling over within the page like the real device, and reach the memory 
+ * array on stop. The internal write cycle then runs for write_cycle_us, the 
+ * device NACKs its address meanwhile. Reads return bytes from the pointer 
+ * across page boundaries and wrap at the end of memory.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2c_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_SIM_EEPROM_PAGE_MAX         256     /*!< Largest page size */
+#define I2C_SIM_EEPROM_WRITE_CYCLE_US   5000    /*!< Default write cycle, datasheet maximum of 24Cxx parts */
+
+typedef struct
+{
+    uint8_t *mem;                               /*!< Memory array, owned by caller */
+    size_t size;                                /*!< Memory size */
+    size_t page_size;                           /*!< Page size, a power of two */
+    uint8_t addr_size;                          /*!< Address bytes, 1 or 2 */
+    uint32_t write_cycle_us;                    /*!< Internal write cycle time */
+    uint8_t addr_count;                         /*!< Address bytes received in current write */
+    size_t ptr;                                 /*!< Address pointer */
+    uint8_t page[I2C_SIM_EEPROM_PAGE_MAX];      /*!< Page buffer */
+    uint8_t dirty[I2C_SIM_EEPROM_PAGE_MAX / 8]; /*!< Page buffer bytes written */
+    bool pending;                               /*!< Page buffer holds data to program */
+    int64_t busy_until_ns;                      /*!< End of running write cycle */
+    uint32_t write_cycles;                      /*!< Write cycles run */
+    uint32_t busy_nacks;                        /*!< Addressing refused during write cycles */
+    uint32_t writes;                            /*!< Data bytes written */
+    uint32_t reads;                             /*!< Data bytes read */
+    i2c_sim_device_t dev;                       /*!< Bus attachment */
+} i2c_sim_eeprom_t;
+
+
+/**
+ * @brief Attach an EEPROM model to a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param eep model storage, it must live until detached.
+ * @param addr 7-bit device address.
+ * @param mem memory array, it must live until detached.
+ * @param size memory size.
+ * @param page_size page size, a power of two up to I2C_SIM_EEPROM_PAGE_MAX.
+ * @param addr_size address bytes, 1 or 2.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: address already in use.
+ */
+esp_err_t i2c_sim_eeprom_attach(i2c_port_t port, i2c_sim_eeprom_t *eep, uint8_t addr, uint8_t *mem, size_t size, 
+                                size_t page_size, uint8_t addr_size);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_hd44780.h
+ * @defgroup i2c_sim_hd44780 i2c_sim_hd44780
+ * @ingroup i2c_sim
+ * @{
+ *
+ * @brief HD44780 character LCD model behind a PCF8574 backpack.
+ * 
+ * It decodes the expander pins as wired on the common backpacks (RS P0, RW P1, 
+ * EN P2, backlight P3, DB4-DB7 P4-P7): each EN falling edge latches a nibble, 
+ * as a whole 8-bit instruction until the interface is set to 4 bits and as 
+ * high then low half of a byte afterwards. Instructions and data run on an 
+ * HD44780 state machine with DDRAM, CGRAM, entry mode and display shift, and 
+ * the visible window can be rendered as text.
+ * 
+ * Each instruction keeps the controller busy for its datasheet execution 
+ * time at 270 kHz, and anything latched before that, or before the power-on 
+ * time, is counted as a timing violation.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2c_sim_pcf8574.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_SIM_HD44780_DDRAM_SIZE  0x80    /*!< DDRAM address space */
+#define I2C_SIM_HD44780_CGRAM_SIZE  0x40    /*!< CGRAM size, 8 characters of 8 rows */
+
+typedef struct
+{
+    uint32_t nibbles;           /*!< EN falling edges */
+    uint32_t instructions;      /*!< Instructions executed */
+    uint32_t chars;             /*!< Data bytes written to DDRAM or CGRAM */
+    uint32_t reads;             /*!< EN falling edges with RW set, ignored */
+    uint32_t violations;        /*!< Nibbles latched while busy */
+    int64_t last_violation_ns;  /*!< Simulated time of last violation */
+    uint8_t last_violation_op;  /*!< Instruction or data the last violation interrupted */
+} i2c_sim_hd44780_stats_t;
+
+typedef struct
+{
+    uint8_t cols;                                   /*!< Visible columns, 16 or 20 */
+    uint8_t rows;                                   /*!< Visible rows, 2 or 4 */
+    uint8_t ddram[I2C_SIM_HD44780_DDRAM_SIZE];      /*!< Display data RAM, by address */
+    uint8_t cgram[I2C_SIM_HD44780_CGRAM_SIZE];      /*!< Character generator RAM */
+    uint8_t ac;                                     /*!< Address counter */
+    bool ac_cgram;                                  /*!< Address counter points to CGRAM */
+    bool increment;                                 /*!< Entry mode I/D */
+    bool shift_on_write;                            /*!< Entry mode S */
+    uint8_t origin;                                 /*!< Display shift, DDRAM column on first visible column */
+    bool display_on;                                /*!< Display control D */
+    bool cursor_on;                                 /*!< Display control C */
+    bool blink_on;                                  /*!< Display control B */
+    bool two_line;                                  /*!< Function set N */
+    bool four_bit;                                  /*!< Function set DL cleared */
+    bool backlight;                                 /*!< Backlight pin */
+    bool nibble_pending;                            /*!< High nibble latched, waiting for low one */
+    uint8_t nibble;                                 /*!< Pending high nibble */
+    bool nibble_rs;                                 /*!< Pending nibble register select */
+    bool nibble_busy;                               /*!< Pending nibble latched while busy */
+    uint8_t resets;                                 /*!< 8-bit function sets of reset procedure */
+    int64_t busy_until_ns;                          /*!< Simulated time current instruction completes */
+    i2c_sim_hd44780_stats_t stats;                  /*!< Decoder statistics */
+    i2c_sim_pcf8574_t io;                           /*!< I/O expander driving the controller */
+} i2c_sim_hd44780_t;
+
+
+/**
+ * @brief Power up an HD44780 model and attach its PCF8574 to a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param lcd model storage, it must live until detached.
+ * @param addr 7-bit PCF8574 address.
+ * @param cols visible columns, 16 or 20.
+ * @param rows visible rows, 2 or 4.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: address already in use.
+ */
+esp_err_t i2c_sim_hd44780_attach(i2c_port_t port, i2c_sim_hd44780_t *lcd, uint8_t addr, uint8_t cols, uint8_t rows);
+
+
+/**
+ * @brief Render the visible window as text.
+ * 
+ * Each row ends with a new line. Codes 0x00 to 0x07, the CGRAM characters, 
+ * are rendered as their 0x08 to 0x0F aliases so the text has no embedded NUL.
+ * 
+ * @param lcd model.
+ * @param buf text output, at least rows * (cols + 1) + 1 bytes.
+ * @param size buf size.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_SIZE: buf too small.
+ */
+esp_err_t i2c_sim_hd44780_render(const i2c_sim_hd44780_t *lcd, char *buf, size_t size);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
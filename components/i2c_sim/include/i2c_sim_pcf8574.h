@@ -0,0 +1,86 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_pcf8574.h
+ * @defgroup i2c_sim_pcf8574 i2c_sim_pcf8574
+ * @ingroup i2c_sim
+ * @{
+ *
+ * @brief PCF8574 8-bit I/O expander model.
+ * 
+ * Each byte written updates the output latch, each byte read returns the pin 
+ * levels. Pins are quasi-bidirectional, so a pin reads low if either its latch 
+ * or the external input pulls it low.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2c_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct i2c_sim_pcf8574 i2c_sim_pcf8574_t;
+
+/**
+ * @brief Called after each byte written, with simulated clock at its ACK.
+ */
+typedef void (*i2c_sim_pcf8574_cb_t)(i2c_sim_pcf8574_t *pcf, uint8_t prev, uint8_t latch, void *arg);
+
+struct i2c_sim_pcf8574
+{
+    uint8_t latch;                  /*!< Output latch, 0xFF at power-up */
+    uint8_t input;                  /*!< Levels driven on pins from outside, 0xFF if floating */
+    uint32_t writes;                /*!< Bytes written */
+    uint32_t reads;                 /*!< Bytes read */
+    i2c_sim_pcf8574_cb_t on_write;  /*!< Optional write hook, e.g. a model wired to the pins */
+    void *arg;                      /*!< Write hook argument */
+    i2c_sim_device_t dev;           /*!< Bus attachment */
+};
+
+
+/**
+ * @brief Reset a PCF8574 model to power-up state and attach it to a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param pcf model storage, it must live until detached.
+ * @param addr 7-bit device address.
+ * @param on_write optional write hook, NULL if not used.
+ * @param arg write hook argument.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: address already in use.
+ */
+esp_err_t i2c_sim_pcf8574_attach(i2c_port_t port, i2c_sim_pcf8574_t *pcf, uint8_t addr, 
+                                 i2c_sim_pcf8574_cb_t on_write, void *arg);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
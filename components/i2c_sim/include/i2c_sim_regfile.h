@@ -0,0 +1,82 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2c_sim_regfile.h
+ * @defgroup i2c_sim_regfile i2c_sim_regfile
+ * @ingroup i2c_sim
+ * @{
+ *
+ * @brief Register file model, the usual sensor and memory device layout.
+ * 
+ * The first addr_size bytes of a write transaction set the register pointer, 
+ * most significant byte first; following bytes are stored from it. Reads 
+ * return bytes from the pointer. The pointer increments after each byte and 
+ * wraps around at the end of the register file.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2c_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint8_t *mem;           /*!< Register contents, owned by caller */
+    size_t size;            /*!< Register file size */
+    uint8_t addr_size;      /*!< Register address bytes, 1 or 2 */
+    uint8_t addr_count;     /*!< Register address bytes received in current write */
+    size_t ptr;             /*!< Register pointer */
+    uint32_t writes;        /*!< Register bytes written */
+    uint32_t reads;         /*!< Register bytes read */
+    i2c_sim_device_t dev;   /*!< Bus attachment */
+} i2c_sim_regfile_t;
+
+
+/**
+ * @brief Attach a register file model to a port.
+ * 
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param rf model storage, it must live until detached.
+ * @param addr 7-bit device address.
+ * @param mem register contents, it must live until detached.
+ * @param size register file size.
+ * @param addr_size register address bytes, 1 or 2.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: address already in use.
+ */
+esp_err_t i2c_sim_regfile_attach(i2c_port_t port, i2c_sim_regfile_t *rf, uint8_t addr, uint8_t *mem, size_t size, 
+                                 uint8_t addr_size);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -27,16 +27,35 @@
  * 
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "driver/i2c.h"
 #include "i2cbus.h"
+#include "i2cbus_priv.h"
+#ifdef CONFIG_I2CBUS_AUTOTUNE_NVS
+#include "nvs.h"
+#endif
 
 // LOCAL CONST
 #define I2C_MASTER_TX_BUF_DISABLE   0                           /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE   0                           /*!< I2C master doesn't need buffer */
 #define I2C_MASTER_INT_FLAG_DISABLE 0                           /*!< I2C master doesn't need buffer */
+#define I2CBUS_SCAN_TIMEOUT         CONFIG_I2CBUS_SCAN_TIMEOUT  /*!< Per address probe timeout */
+#define I2CBUS_SCAN_FIRST           0x08                        /*!< Addresses below are reserved */
+#define I2CBUS_SCAN_LAST            0x77                        /*!< Addresses above are reserved */
+#define I2CBUS_SCAN_TASK_STACK      2048                        /*!< Parallel scan helper stack */
+#define I2CBUS_AUTOTUNE_MAX         CONFIG_I2CBUS_AUTOTUNE_MAX
+#define I2CBUS_AUTOTUNE_STEP        CONFIG_I2CBUS_AUTOTUNE_STEP
+#define I2CBUS_AUTOTUNE_ROUNDS      CONFIG_I2CBUS_AUTOTUNE_ROUNDS
+#define I2CBUS_AUTOTUNE_MARGIN      CONFIG_I2CBUS_AUTOTUNE_MARGIN
+#define I2CBUS_AUTOTUNE_READ        4                           /*!< Bytes read back from each device per round */
+#define I2CBUS_NVS_NAMESPACE        "i2cbus"                    /*!< NVS namespace of tuned frequencies */
+#define I2CBUS_POST_TASK_PRIORITY   CONFIG_I2CBUS_POST_TASK_PRIORITY
+#define I2CBUS_POST_TASK_STACK      CONFIG_I2CBUS_POST_TASK_STACK
+#define I2CBUS_POST_QUEUE_SIZE      8                           /*!< Timed flushes waiting per port */
 
 // LOCAL MACROS
 #define I2C_WRITE(addr)     (addr << 1)
@@ -48,9 +67,62 @@ typedef struct {
     SemaphoreHandle_t mutex;
     i2c_config_t conf;
     bool installed;
+    bool scanned;
+    uint32_t present[4];
+    QueueHandle_t post_queue;   /*!< Staging due for a timed flush */
 } i2cbus_port_t;
 
 static i2cbus_port_t i2cbus_port[I2C_NUM_MAX];
+static portMUX_TYPE i2cbus_scan_lock = portMUX_INITIALIZER_UNLOCKED;
+#ifdef CONFIG_I2CBUS_TRACE
+static i2cbus_trace_cb_t i2cbus_trace_cb;
+static void *i2cbus_trace_arg;
+static portMUX_TYPE i2cbus_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+static esp_err_t _i2cbus_flush_until(i2cbus_t *dev, TickType_t deadline);
+
+static uint32_t _i2cbus_load_freq(i2c_port_t i2c_port)
+{
+    uint32_t freq = I2C_MASTER_FREQ;
+#ifdef CONFIG_I2CBUS_AUTOTUNE_NVS
+    nvs_handle_t nvs;
+    char key[8];
+
+    // nothing stored yet, or application has not initiated NVS.
+    snprintf(key, sizeof(key), "freq%d", i2c_port);
+    if (nvs_open(I2CBUS_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        uint32_t stored;
+        if ((nvs_get_u32(nvs, key, &stored) == ESP_OK) && (stored >= I2C_MASTER_FREQ) && 
+            (stored <= I2CBUS_AUTOTUNE_MAX))
+            freq = stored;
+        nvs_close(nvs);
+    }
+#endif
+    return freq;
+}
+
+static esp_err_t _i2cbus_store_freq(i2c_port_t i2c_port, uint32_t freq)
+{
+#ifdef CONFIG_I2CBUS_AUTOTUNE_NVS
+    nvs_handle_t nvs;
+    char key[8];
+
+    snprintf(key, sizeof(key), "freq%d", i2c_port);
+    esp_err_t res = nvs_open(I2CBUS_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (res != ESP_OK)
+        return res;
+
+    res = nvs_set_u32(nvs, key, freq);
+    if (res == ESP_OK)
+        res = nvs_commit(nvs);
+    nvs_close(nvs);
+
+    return res;
+#else
+    return ESP_OK;
+#endif
+}
 
 esp_err_t i2cbus_init(i2c_port_t i2c_port, i2c_mode_t i2c_mode, gpio_num_t i2c_sda, gpio_num_t i2c_scl)
 {
@@ -61,11 +133,16 @@ esp_err_t i2cbus_init(i2c_port_t i2c_port, i2c_mode_t i2c_mode, gpio_num_t i2c_s
     // check if i2c_port is valid.
     if (i2c_port >= I2C_NUM_MAX)
         return ESP_ERR_INVALID_ARG;
+
+    // slave ports need driver buffers and an engine, see i2cbus_slave_init().
+    if (i2c_mode != I2C_MODE_MASTER)
+        return ESP_ERR_NOT_SUPPORTED;
     
     // clear entire variable.
     memset(&i2cbus_port[i2c_port], 0, sizeof(i2cbus_port_t));
-    // create a port mutex semaphore handle.
-    i2cbus_port[i2c_port].mutex = xSemaphoreCreateMutex();
+    // create a port mutex semaphore handle, it is recursive so a task holding
+    // the port with i2cbus_lock() can keep calling the transfer functions.
+    i2cbus_port[i2c_port].mutex = xSemaphoreCreateRecursiveMutex();
 
     // Check if semaphore was created.
     if (i2cbus_port[i2c_port].mutex != NULL) {
@@ -86,11 +163,13 @@ esp_err_t i2cbus_init(i2c_port_t i2c_port, i2c_mode_t i2c_mode, gpio_num_t i2c_s
         .scl_io_num = i2c_scl,
         .sda_pullup_en = GPIO_PULLUP_DISABLE,
         .scl_pullup_en = GPIO_PULLUP_DISABLE,
-        .master.clk_speed = I2C_MASTER_FREQ,
+        // a frequency tuned on a previous boot replaces the configured one.
+        .master.clk_speed = _i2cbus_load_freq(i2c_port),
     };
 
     esp_err_t res = ESP_FAIL;
     res = i2c_param_config(i2c_port, &conf);
+    i2cbus_port[i2c_port].conf = conf;
 
     res = i2c_driver_install(i2c_port, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 
                               I2C_MASTER_INT_FLAG_DISABLE);
@@ -101,6 +180,10 @@ esp_err_t i2cbus_create(i2cbus_t *dev, i2c_port_t i2c_port, uint8_t addr)
 {
     if (!dev) 
         return ESP_ERR_INVALID_ARG;
+
+    // a device a scan did not find would only burn its timeout on every access.
+    if (!i2cbus_present(i2c_port, addr))
+        return ESP_ERR_NOT_FOUND;
     
     // Create a new semaphore handler for this device.
     dev->mutex = xSemaphoreCreateMutex();
@@ -111,6 +194,8 @@ esp_err_t i2cbus_create(i2cbus_t *dev, i2c_port_t i2c_port, uint8_t addr)
     dev->port = i2c_port;
     dev->addr = addr;
     dev->time_out = I2C_TIMEOUT;
+    dev->quota = NULL;
+    dev->post = NULL;
 
     ESP_LOGI(TAG, "new device has been created");
     return ESP_OK;
@@ -118,15 +203,21 @@ esp_err_t i2cbus_create(i2cbus_t *dev, i2c_port_t i2c_port, uint8_t addr)
 
 esp_err_t i2cbus_delete(i2cbus_t *dev)
 {
+    // staged writes go out before device goes away.
+    if (dev->post != NULL) {
+        esp_err_t res = i2cbus_set_post(dev, NULL, NULL, 0, 0);
+        if (res != ESP_OK)
+            return res;
+    }
+
     if (dev->mutex != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
         // wait 10 ticks to see if it becomes free.
         if (xSemaphoreTake(dev->mutex, pdMS_TO_TICKS(dev->time_out)) == pdTRUE) {
-            // Delete semaphore.
+            // Delete semaphore, nobody else holds it so there is nothing to
+            // give back.
             vSemaphoreDelete(dev->mutex);
-            // We have finished accessing the shared resource.  Release the
-            // semaphore.
-            xSemaphoreGive(dev->mutex);
+            dev->mutex = NULL;
         }
         else {
             // We could not obtain the semaphore and can therefore not access
@@ -139,14 +230,642 @@ esp_err_t i2cbus_delete(i2cbus_t *dev)
     return ESP_OK;
 }
 
-esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size)
+static void _i2cbus_quota_refill(i2cbus_quota_t *quota, int64_t now)
+{
+    int64_t elapsed = now - quota->refill_us;
+    int64_t full = (int64_t)quota->budget * quota->window_us;
+
+    // a bucket idle for a whole window is full anyway, clamp before scaling.
+    if (elapsed > quota->window_us)
+        elapsed = quota->window_us;
+
+    quota->tokens += elapsed * quota->budget;
+    if (quota->tokens > full)
+        quota->tokens = full;
+    quota->refill_us = now;
+}
+
+// a transfer uses what its caller paid ahead first, a prepayment adds to it.
+static esp_err_t _i2cbus_quota_take(i2cbus_t *dev, size_t wr_size, size_t rd_size, bool prepay, 
+                                    TickType_t deadline)
+{
+    i2cbus_quota_t *quota = dev->quota;
+
+    if (quota == NULL)
+        return ESP_OK;
+
+    int64_t cost = (quota->unit == I2CBUS_QUOTA_BUS_US) ? i2cbus_wire_time_us(dev->port, wr_size, rd_size) 
+                                                        : (int64_t)(wr_size + rd_size);
+    // nothing to transfer, only wait for the bucket to get out of debt.
+    if (!wr_size && !rd_size)
+        cost = 0;
+    // sleeping on a held port would stall every other device of it, such a 
+    // transfer goes into debt that the next ones wait out.
+    bool held = (xSemaphoreGetMutexHolder(i2cbus_port[dev->port].mutex) == xTaskGetCurrentTaskHandle());
+    int64_t start = esp_timer_get_time();
+    bool deferred = false;
+
+    while (true) {
+        portENTER_CRITICAL(&quota->lock);
+        int64_t now = esp_timer_get_time();
+        _i2cbus_quota_refill(quota, now);
+
+        if (!prepay && quota->credit) {
+            int64_t paid = (quota->credit < cost) ? quota->credit : cost;
+            quota->credit -= paid;
+            cost -= paid;
+            if (!cost) {
+                portEXIT_CRITICAL(&quota->lock);
+                return ESP_OK;
+            }
+        }
+
+        // bucket is not in debt, transfer goes and pays its full cost.
+        if ((quota->tokens >= 0) || held) {
+            quota->tokens -= cost * quota->window_us;
+            quota->used += cost;
+            if (prepay)
+                quota->credit += cost;
+            if (deferred) {
+                quota->deferred++;
+                quota->deferred_us += now - start;
+            }
+            portEXIT_CRITICAL(&quota->lock);
+            return ESP_OK;
+        }
+
+        // time until bucket refills out of debt.
+        int64_t wait_us = (-quota->tokens + quota->budget - 1) / quota->budget;
+        portEXIT_CRITICAL(&quota->lock);
+
+        TickType_t ticks = pdMS_TO_TICKS((wait_us + 999) / 1000);
+        if (!ticks)
+            ticks = 1;
+
+        // defer transfer, unless its deadline expires first.
+        if (ticks > i2cbus_remaining(deadline))
+            return ESP_ERR_TIMEOUT;
+
+        deferred = true;
+        vTaskDelay(ticks);
+    }
+}
+
+esp_err_t i2cbus_prepay_quota_until(i2cbus_t *dev, size_t wr_size, size_t rd_size, TickType_t deadline)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return _i2cbus_quota_take(dev, wr_size, rd_size, true, deadline);
+}
+
+esp_err_t i2cbus_set_quota(i2cbus_t *dev, i2cbus_quota_t *quota, i2cbus_quota_unit_t unit, uint32_t budget, 
+                           uint32_t window_us)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    if (quota == NULL) {
+        dev->quota = NULL;
+        return ESP_OK;
+    }
+
+    if (!budget || !window_us || (unit > I2CBUS_QUOTA_BUS_US))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(quota, 0, sizeof(i2cbus_quota_t));
+    portMUX_INITIALIZE(&quota->lock);
+    quota->unit = unit;
+    quota->budget = budget;
+    quota->window_us = window_us;
+    // start with a full bucket.
+    quota->tokens = (int64_t)budget * window_us;
+    quota->refill_us = esp_timer_get_time();
+    quota->since_us = quota->refill_us;
+
+    dev->quota = quota;
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_get_quota_stats(i2cbus_t *dev, i2cbus_quota_stats_t *stats, bool reset)
+{
+    if ((dev == NULL) || (stats == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    i2cbus_quota_t *quota = dev->quota;
+    if (quota == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&quota->lock);
+    int64_t now = esp_timer_get_time();
+    stats->elapsed_us = now - quota->since_us;
+    stats->used = quota->used;
+    stats->budgeted = ((uint64_t)quota->budget * stats->elapsed_us) / quota->window_us;
+    stats->deferred = quota->deferred;
+    stats->deferred_us = quota->deferred_us;
+    if (reset) {
+        quota->since_us = now;
+        quota->used = 0;
+        quota->deferred = 0;
+        quota->deferred_us = 0;
+    }
+    portEXIT_CRITICAL(&quota->lock);
+
+    stats->utilization = stats->budgeted ? (uint32_t)((stats->used * 100) / stats->budgeted) : 0;
+    return ESP_OK;
+}
+
+TickType_t i2cbus_deadline(uint32_t time_out)
+{
+    TickType_t ticks = pdMS_TO_TICKS(time_out);
+
+    // a non zero timeout shorter than one tick still gets a tick to run.
+    if (time_out && !ticks)
+        ticks = 1;
+
+    return xTaskGetTickCount() + ticks;
+}
+
+TickType_t i2cbus_remaining(TickType_t deadline)
+{
+    // signed difference keeps the comparison valid across tick overflow.
+    int32_t ticks = (int32_t)(deadline - xTaskGetTickCount());
+
+    return (ticks > 0) ? (TickType_t)ticks : 0;
+}
+
+esp_err_t i2cbus_lock(i2c_port_t i2c_port, TickType_t deadline)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, i2cbus_remaining(deadline)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_unlock(i2c_port_t i2c_port)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex) != pdTRUE)
+        return ESP_ERR_INVALID_STATE;
+
+    return ESP_OK;
+}
+
+uint32_t i2cbus_wire_time_us(i2c_port_t i2c_port, size_t wr_size, size_t rd_size)
+{
+    uint32_t freq = I2C_MASTER_FREQ;
+    uint32_t bits = 1;  // stop condition.
+
+    if ((i2c_port < I2C_NUM_MAX) && i2cbus_port[i2c_port].conf.master.clk_speed)
+        freq = i2cbus_port[i2c_port].conf.master.clk_speed;
+
+    // each phase is a (re)start, the address byte and its data bytes, every
+    // byte followed by an ACK bit.
+    if (wr_size || !rd_size)
+        bits += 1 + 9 + (9 * wr_size);
+    if (rd_size)
+        bits += 1 + 9 + (9 * rd_size);
+
+    return (uint32_t)(((uint64_t)bits * 1000000 + freq - 1) / freq);
+}
+
+esp_err_t i2cbus_set_trace(i2cbus_trace_cb_t cb, void *arg)
+{
+#ifdef CONFIG_I2CBUS_TRACE
+    portENTER_CRITICAL(&i2cbus_trace_lock);
+    i2cbus_trace_cb = cb;
+    i2cbus_trace_arg = arg;
+    portEXIT_CRITICAL(&i2cbus_trace_lock);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static inline int64_t _i2cbus_trace_start(void)
+{
+#ifdef CONFIG_I2CBUS_TRACE
+    return esp_timer_get_time();
+#else
+    return 0;
+#endif
+}
+
+static void _i2cbus_trace(i2cbus_t *dev, i2cbus_trace_op_t op, uint8_t *reg, size_t reg_size, size_t data_size, 
+                          int64_t start_us, esp_err_t res)
+{
+#ifdef CONFIG_I2CBUS_TRACE
+    portENTER_CRITICAL(&i2cbus_trace_lock);
+    i2cbus_trace_cb_t cb = i2cbus_trace_cb;
+    void *arg = i2cbus_trace_arg;
+    portEXIT_CRITICAL(&i2cbus_trace_lock);
+
+    if ((cb == NULL) || (dev == NULL))
+        return;
+
+    i2cbus_trace_t event = {
+        .start_us = start_us,
+        .end_us = esp_timer_get_time(),
+        .task = xTaskGetCurrentTaskHandle(),
+        .port = dev->port,
+        .addr = dev->addr,
+        .op = op,
+        .reg_size = reg ? reg_size : 0,
+        .data_size = data_size,
+        .res = res,
+    };
+    // wider registers keep their size, replay only needs the wire length.
+    for (size_t i = 0; i < event.reg_size; i++)
+        event.reg = (event.reg << 8) | reg[i];
+
+    cb(&event, arg);
+#endif
+}
+
+static esp_err_t _i2cbus_address(i2c_port_t i2c_port, uint8_t addr, TickType_t ticks)
+{
+    // address only write, a present device acks its address and nothing else
+    // goes on the wire.
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, I2C_WRITE(addr), true);
+    i2c_master_stop(cmd);
+    esp_err_t res = i2c_master_cmd_begin(i2c_port, cmd, ticks);
+    i2c_cmd_link_delete(cmd);
+
+    return res;
+}
+
+static esp_err_t _i2cbus_probe(i2c_port_t i2c_port, uint8_t addr, TickType_t ticks)
+{
+    esp_err_t res = _i2cbus_address(i2c_port, addr, ticks);
+
+    portENTER_CRITICAL(&i2cbus_scan_lock);
+    if (res == ESP_OK)
+        i2cbus_port[i2c_port].present[addr / 32] |= (1UL << (addr % 32));
+    else if (res == ESP_FAIL)
+        i2cbus_port[i2c_port].present[addr / 32] &= ~(1UL << (addr % 32));
+    portEXIT_CRITICAL(&i2cbus_scan_lock);
+
+    return res;
+}
+
+static TickType_t _i2cbus_probe_ticks(void)
+{
+    TickType_t ticks = pdMS_TO_TICKS(I2CBUS_SCAN_TIMEOUT);
+
+    return ticks ? ticks : 1;
+}
+
+esp_err_t i2cbus_probe(i2c_port_t i2c_port, uint8_t addr)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed || (addr > 0x7F))
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, pdMS_TO_TICKS(I2C_TIMEOUT)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    esp_err_t res = _i2cbus_probe(i2c_port, addr, _i2cbus_probe_ticks());
+    xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+
+    if (res == ESP_FAIL)
+        return ESP_ERR_NOT_FOUND;
+    return res;
+}
+
+esp_err_t i2cbus_scan(i2c_port_t i2c_port)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    // hold port for whole scan, probes are short and back to back.
+    if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, pdMS_TO_TICKS(I2C_TIMEOUT)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    TickType_t ticks = _i2cbus_probe_ticks();
+    esp_err_t res = ESP_OK;
+    int found = 0;
+
+    for (uint8_t addr = I2CBUS_SCAN_FIRST; addr <= I2CBUS_SCAN_LAST; addr++) {
+        esp_err_t probe = _i2cbus_probe(i2c_port, addr, ticks);
+        if (probe == ESP_OK) {
+            found++;
+        }
+        else if (probe != ESP_FAIL) {
+            // timeout or bus error, bus is stuck and every other probe would
+            // only wait for it too.
+            res = probe;
+            break;
+        }
+    }
+
+    xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+
+    if (res != ESP_OK) {
+        ESP_LOGE(TAG, "scan of port %d failed: %d (%s)", i2c_port, res, esp_err_to_name(res));
+        return res;
+    }
+
+    portENTER_CRITICAL(&i2cbus_scan_lock);
+    i2cbus_port[i2c_port].scanned = true;
+    portEXIT_CRITICAL(&i2cbus_scan_lock);
+
+    ESP_LOGI(TAG, "port %d scanned, %d devices found", i2c_port, found);
+    return ESP_OK;
+}
+
+// caller holds port lock.
+static esp_err_t _i2cbus_set_freq(i2c_port_t i2c_port, uint32_t freq)
+{
+    i2cbus_port[i2c_port].conf.master.clk_speed = freq;
+
+    return i2c_param_config(i2c_port, &i2cbus_port[i2c_port].conf);
+}
+
+static bool _i2cbus_found(i2c_port_t i2c_port)
+{
+    for (uint8_t addr = I2CBUS_SCAN_FIRST; addr <= I2CBUS_SCAN_LAST; addr++) {
+        if (i2cbus_present(i2c_port, addr))
+            return true;
+    }
+
+    return false;
+}
+
+// reference read back of present devices at the configured clock.
+typedef struct {
+    uint32_t stable[4];                                         /*!< Devices reading the same bytes twice */
+    uint8_t data[I2CBUS_SCAN_LAST + 1][I2CBUS_AUTOTUNE_READ];  /*!< Bytes each device read */
+} i2cbus_autotune_ref_t;
+
+static esp_err_t _i2cbus_read_back(i2c_port_t i2c_port, uint8_t addr, uint8_t *data, TickType_t ticks)
+{
+    // read from wherever the device points, nothing is written to it.
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, I2C_READ(addr), true);
+    i2c_master_read(cmd, data, I2CBUS_AUTOTUNE_READ, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t res = i2c_master_cmd_begin(i2c_port, cmd, ticks);
+    i2c_cmd_link_delete(cmd);
+
+    return res;
+}
+
+// caller holds port lock and runs port at the configured clock. A device that 
+// reads different bytes twice, an auto-incrementing register pointer or live 
+// data, is read back later without a comparison.
+static bool _i2cbus_reference(i2c_port_t i2c_port, i2cbus_autotune_ref_t *ref)
+{
+    TickType_t ticks = _i2cbus_probe_ticks();
+    uint8_t data[I2CBUS_AUTOTUNE_READ];
+
+    for (uint8_t addr = I2CBUS_SCAN_FIRST; addr <= I2CBUS_SCAN_LAST; addr++) {
+        if (!i2cbus_present(i2c_port, addr))
+            continue;
+        if ((_i2cbus_read_back(i2c_port, addr, ref->data[addr], ticks) != ESP_OK) || 
+            (_i2cbus_read_back(i2c_port, addr, data, ticks) != ESP_OK))
+            return false;
+        if (!memcmp(data, ref->data[addr], I2CBUS_AUTOTUNE_READ))
+            ref->stable[addr / 32] |= (1UL << (addr % 32));
+    }
+
+    return true;
+}
+
+// caller holds port lock. Every address of the scan range reads back the
+// presence map of the port, and every present device the reference data, 
+// round after round.
+static bool _i2cbus_verify(i2c_port_t i2c_port, const i2cbus_autotune_ref_t *ref)
+{
+    TickType_t ticks = _i2cbus_probe_ticks();
+    uint8_t data[I2CBUS_AUTOTUNE_READ];
+
+    for (int round = 0; round < I2CBUS_AUTOTUNE_ROUNDS; round++) {
+        for (uint8_t addr = I2CBUS_SCAN_FIRST; addr <= I2CBUS_SCAN_LAST; addr++) {
+            esp_err_t res = _i2cbus_address(i2c_port, addr, ticks);
+            // a lost ack, a phantom ack or a stuck bus fail the step alike.
+            if ((res != ESP_OK) && (res != ESP_FAIL))
+                return false;
+            if ((res == ESP_OK) != i2cbus_present(i2c_port, addr))
+                return false;
+            if (res != ESP_OK)
+                continue;
+
+            // a bit sampled wrong shows in data, the address alone may pass.
+            if (_i2cbus_read_back(i2c_port, addr, data, ticks) != ESP_OK)
+                return false;
+            if ((ref->stable[addr / 32] & (1UL << (addr % 32))) && 
+                memcmp(data, ref->data[addr], I2CBUS_AUTOTUNE_READ))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+esp_err_t i2cbus_autotune(i2c_port_t i2c_port)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, pdMS_TO_TICKS(I2C_TIMEOUT)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    i2cbus_autotune_ref_t *ref = calloc(1, sizeof(i2cbus_autotune_ref_t));
+    if (ref == NULL) {
+        xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // reference presence map and data are taken at the configured, 
+    // conservative clock.
+    uint32_t base = I2C_MASTER_FREQ;
+    esp_err_t res = _i2cbus_set_freq(i2c_port, base);
+    if (res == ESP_OK)
+        res = i2cbus_scan(i2c_port);
+    // a silent bus would verify at any clock.
+    if ((res == ESP_OK) && !_i2cbus_found(i2c_port))
+        res = ESP_ERR_NOT_FOUND;
+    if ((res == ESP_OK) && (!_i2cbus_reference(i2c_port, ref) || !_i2cbus_verify(i2c_port, ref)))
+        res = ESP_FAIL;
+    if (res != ESP_OK) {
+        xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+        free(ref);
+        ESP_LOGE(TAG, "port %d not tuned at %u Hz: %s", i2c_port, (unsigned)base, esp_err_to_name(res));
+        return res;
+    }
+
+    uint32_t best = base;
+    for (uint32_t freq = base + I2CBUS_AUTOTUNE_STEP; freq <= I2CBUS_AUTOTUNE_MAX; freq += I2CBUS_AUTOTUNE_STEP) {
+        if ((_i2cbus_set_freq(i2c_port, freq) != ESP_OK) || !_i2cbus_verify(i2c_port, ref))
+            break;
+        best = freq;
+    }
+
+    // back off from the edge, what barely passed now fails on a warm day.
+    uint32_t tuned = best - ((uint64_t)best * I2CBUS_AUTOTUNE_MARGIN) / 100;
+    if (tuned < base)
+        tuned = base;
+    if ((_i2cbus_set_freq(i2c_port, tuned) != ESP_OK) || !_i2cbus_verify(i2c_port, ref)) {
+        tuned = base;
+        _i2cbus_set_freq(i2c_port, tuned);
+    }
+    xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+    free(ref);
+
+    ESP_LOGI(TAG, "port %d tuned to %u Hz, verified up to %u Hz", i2c_port, (unsigned)tuned, (unsigned)best);
+
+    res = _i2cbus_store_freq(i2c_port, tuned);
+    if (res != ESP_OK)
+        ESP_LOGW(TAG, "tuned frequency of port %d not stored: %s", i2c_port, esp_err_to_name(res));
+
+    return res;
+}
+
+uint32_t i2cbus_get_freq(i2c_port_t i2c_port)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed)
+        return 0;
+
+    return i2cbus_port[i2c_port].conf.master.clk_speed;
+}
+
+esp_err_t i2cbus_set_freq(i2c_port_t i2c_port, uint32_t freq)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || !i2cbus_port[i2c_port].installed || !freq)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, pdMS_TO_TICKS(I2C_TIMEOUT)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    esp_err_t res = _i2cbus_set_freq(i2c_port, freq);
+    xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+
+    if (res != ESP_OK)
+        return ESP_FAIL;
+
+    ESP_LOGI(TAG, "port %d set to %u Hz", i2c_port, (unsigned)freq);
+    return ESP_OK;
+}
+
+typedef struct {
+    i2c_port_t port;
+    esp_err_t res;
+    TaskHandle_t caller;
+} i2cbus_scan_job_t;
+
+static void _i2cbus_scan_task(void *arg)
+{
+    i2cbus_scan_job_t *job = (i2cbus_scan_job_t *)arg;
+
+    job->res = i2cbus_scan(job->port);
+    xTaskNotifyGive(job->caller);
+    vTaskDelete(NULL);
+}
+
+esp_err_t i2cbus_scan_all(void)
+{
+    i2cbus_scan_job_t job[I2C_NUM_MAX];
+    esp_err_t res = ESP_OK;
+    int helpers = 0;
+    int last = -1;
+
+    // every installed port but the last is scanned by a helper task, the
+    // controllers run their probes at the same time.
+    for (int port = 0; port < I2C_NUM_MAX; port++) {
+        if (!i2cbus_port[port].installed)
+            continue;
+        if (last >= 0) {
+            job[helpers].port = last;
+            job[helpers].res = ESP_FAIL;
+            job[helpers].caller = xTaskGetCurrentTaskHandle();
+            if (xTaskCreate(_i2cbus_scan_task, "i2cbus_scan", I2CBUS_SCAN_TASK_STACK, &job[helpers], uxTaskPriorityGet(NULL), 
+                            NULL) == pdPASS) {
+                helpers++;
+            }
+            else {
+                esp_err_t err = i2cbus_scan(last);
+                if (err != ESP_OK)
+                    res = err;
+            }
+        }
+        last = port;
+    }
+
+    if (last < 0)
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = i2cbus_scan(last);
+    if (err != ESP_OK)
+        res = err;
+
+    for (int i = 0; i < helpers; i++)
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    for (int i = 0; i < helpers; i++) {
+        if (job[i].res != ESP_OK)
+            res = job[i].res;
+    }
+
+    return res;
+}
+
+bool i2cbus_present(i2c_port_t i2c_port, uint8_t addr)
+{
+    if ((i2c_port >= I2C_NUM_MAX) || (addr > 0x7F))
+        return false;
+
+    portENTER_CRITICAL(&i2cbus_scan_lock);
+    bool present = !i2cbus_port[i2c_port].scanned || (i2cbus_port[i2c_port].present[addr / 32] & (1UL << (addr % 32)));
+    portEXIT_CRITICAL(&i2cbus_scan_lock);
+
+    return present;
+}
+
+static esp_err_t _i2cbus_ping_until(i2cbus_t *dev, TickType_t deadline)
+{
+    if ((dev == NULL) || (dev->port >= I2C_NUM_MAX) || !i2cbus_port[dev->port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTakeRecursive(i2cbus_port[dev->port].mutex, i2cbus_remaining(deadline)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    // posted writes the device is busy with go out first.
+    esp_err_t res = _i2cbus_flush_until(dev, deadline);
+    if (res == ESP_OK) {
+        // a NACK is an answer here, busy devices are polled with it.
+        TickType_t ticks = i2cbus_remaining(deadline);
+        res = ticks ? _i2cbus_address(dev->port, dev->addr, ticks) : ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
+
+    return res;
+}
+
+esp_err_t i2cbus_ping_until(i2cbus_t *dev, TickType_t deadline)
+{
+    int64_t start_us = _i2cbus_trace_start();
+    esp_err_t res = _i2cbus_ping_until(dev, deadline);
+    _i2cbus_trace(dev, I2CBUS_TRACE_PING, NULL, 0, 0, start_us, res);
+
+    return res;
+}
+
+static esp_err_t _i2cbus_write_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, 
+                                         size_t data_size, TickType_t deadline)
 {
     esp_err_t res = ESP_ERR_INVALID_ARG;
 
     if (dev != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(i2cbus_port[dev->port].mutex, pdMS_TO_TICKS(dev->time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTakeRecursive(i2cbus_port[dev->port].mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
             
@@ -164,7 +883,9 @@ esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
             i2c_master_write(cmd, (void *)data, data_size, true);
             // add a stop condition in buffer.
             i2c_master_stop(cmd);
-            res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(dev->time_out));
+            // the transaction only gets what is left of the caller's budget.
+            TickType_t ticks = i2cbus_remaining(deadline);
+            res = ticks ? i2c_master_cmd_begin(dev->port, cmd, ticks) : ESP_ERR_TIMEOUT;
             if (res != ESP_OK)
                 ESP_LOGE(TAG, "Device not found [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
             
@@ -172,7 +893,7 @@ esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
 
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(i2cbus_port[dev->port].mutex);
+            xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
@@ -183,17 +904,298 @@ esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
     return res;
 }
 
-esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size)
+// caller holds port lock.
+static esp_err_t _i2cbus_post_flush(i2cbus_t *dev, TickType_t deadline)
+{
+    i2cbus_post_t *post = dev->post;
+
+    if ((post == NULL) || !post->len)
+        return ESP_OK;
+
+    esp_timer_stop(post->timer);
+    // staged burst is dropped on failure, as a write sent at once would be.
+    esp_err_t res = _i2cbus_write_reg_until(dev, post->buf, post->reg_size, post->buf + post->reg_size, 
+                                            post->len - post->reg_size, deadline);
+    post->len = 0;
+    post->flushes++;
+
+    return res;
+}
+
+static void _i2cbus_post_timer(void *arg)
+{
+    i2cbus_post_t *post = (i2cbus_post_t *)arg;
+
+    // every esp_timer shares this task, the port flush task does the waiting.
+    if (xQueueSend(i2cbus_port[post->dev->port].post_queue, &post, 0) != pdTRUE)
+        esp_timer_start_once(post->timer, post->delay_us);
+}
+
+static void _i2cbus_post_task(void *arg)
+{
+    i2c_port_t i2c_port = (i2c_port_t)(intptr_t)arg;
+    QueueHandle_t queue = i2cbus_port[i2c_port].post_queue;
+    i2cbus_post_t *post;
+
+    while (true) {
+        xQueuePeek(queue, &post, portMAX_DELAY);
+
+        // this task only flushes, it can wait for the port as long as it takes.
+        if (xSemaphoreTakeRecursive(i2cbus_port[i2c_port].mutex, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        // taken under the port lock, as removal of a staging drops its entries.
+        if (xQueueReceive(queue, &post, 0) == pdTRUE) {
+            i2cbus_t *dev = post->dev;
+            // staging may have been replaced meanwhile.
+            if (dev->post == post) {
+                esp_err_t res = _i2cbus_post_flush(dev, i2cbus_deadline(dev->time_out));
+                if (res != ESP_OK)
+                    post->res = res;
+            }
+        }
+        xSemaphoreGiveRecursive(i2cbus_port[i2c_port].mutex);
+    }
+}
+
+// caller holds port lock. Timed flushes queued for a staging being removed are 
+// dropped, its storage goes back to the caller.
+static void _i2cbus_post_cancel(i2c_port_t i2c_port, i2cbus_post_t *post)
+{
+    QueueHandle_t queue = i2cbus_port[i2c_port].post_queue;
+    i2cbus_post_t *queued;
+
+    if (queue == NULL)
+        return;
+
+    for (UBaseType_t n = uxQueueMessagesWaiting(queue); n && (xQueueReceive(queue, &queued, 0) == pdTRUE); n--) {
+        // a timer may have filled the slot, the flush then waits another delay.
+        if ((queued != post) && (xQueueSend(queue, &queued, 0) != pdTRUE))
+            esp_timer_start_once(queued->timer, queued->delay_us);
+    }
+}
+
+// caller holds port lock.
+static esp_err_t _i2cbus_post_start(i2c_port_t i2c_port)
+{
+    if (i2cbus_port[i2c_port].post_queue != NULL)
+        return ESP_OK;
+
+    QueueHandle_t queue = xQueueCreate(I2CBUS_POST_QUEUE_SIZE, sizeof(i2cbus_post_t *));
+    if (queue == NULL)
+        return ESP_ERR_NO_MEM;
+
+    i2cbus_port[i2c_port].post_queue = queue;
+    if (xTaskCreate(_i2cbus_post_task, "i2cbus_post", I2CBUS_POST_TASK_STACK, (void *)(intptr_t)i2c_port, 
+                    I2CBUS_POST_TASK_PRIORITY, NULL) != pdPASS) {
+        i2cbus_port[i2c_port].post_queue = NULL;
+        vQueueDelete(queue);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t _i2cbus_post(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                              TickType_t deadline)
+{
+    if (!reg)
+        reg_size = 0;
+
+    if (i2cbus_lock(dev->port, deadline) != ESP_OK)
+        return ESP_ERR_TIMEOUT;
+
+    // staging was removed since caller looked, the write goes at once.
+    i2cbus_post_t *post = dev->post;
+    if (post == NULL) {
+        esp_err_t res = _i2cbus_write_reg_until(dev, reg, reg_size, data, data_size, deadline);
+        i2cbus_unlock(dev->port);
+        return res;
+    }
+
+    // a timed flush nobody waited for failed, its writer learns it now.
+    esp_err_t res = post->res;
+    post->res = ESP_OK;
+
+    // registers wider than the merge key always go on their own.
+    uint32_t reg_value = 0;
+    for (size_t i = 0; (i < reg_size) && (reg_size <= sizeof(uint32_t)); i++)
+        reg_value = (reg_value << 8) | reg[i];
+
+    bool join = post->len && (reg_size == post->reg_size) && (reg_size <= sizeof(uint32_t)) && 
+                (!reg_size || (reg_value == post->next_reg)) && ((post->len + data_size) <= post->buf_size);
+
+    if (!join) {
+        esp_err_t flush_res = _i2cbus_post_flush(dev, deadline);
+        if (res == ESP_OK)
+            res = flush_res;
+    }
+
+    if (!join && ((reg_size > sizeof(uint32_t)) || ((reg_size + data_size) > post->buf_size))) {
+        // too large to stage, nothing is staged ahead of it now.
+        esp_err_t write_res = _i2cbus_write_reg_until(dev, reg, reg_size, data, data_size, deadline);
+        if (res == ESP_OK)
+            res = write_res;
+    }
+    else {
+        if (!join) {
+            memcpy(post->buf, reg, reg_size);
+            post->len = reg_size;
+            post->reg_size = reg_size;
+            post->next_reg = reg_value;
+            esp_timer_start_once(post->timer, post->delay_us);
+        }
+        memcpy(post->buf + post->len, data, data_size);
+        post->len += data_size;
+        post->next_reg += data_size;
+        post->writes++;
+
+        // size threshold.
+        if (post->len == post->buf_size) {
+            esp_err_t flush_res = _i2cbus_post_flush(dev, deadline);
+            if (res == ESP_OK)
+                res = flush_res;
+        }
+    }
+
+    i2cbus_unlock(dev->port);
+    return res;
+}
+
+esp_err_t i2cbus_write_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                 TickType_t deadline)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    int64_t start_us = _i2cbus_trace_start();
+    // wait for device bandwidth budget before competing for the port. Posted 
+    // writes pay when posted, their flush may run with the port held.
+    esp_err_t res = _i2cbus_quota_take(dev, (reg ? reg_size : 0) + data_size, 0, false, deadline);
+    if ((res == ESP_OK) && (dev->post != NULL))
+        res = _i2cbus_post(dev, reg, reg_size, data, data_size, deadline);
+    else if (res == ESP_OK)
+        res = _i2cbus_write_reg_until(dev, reg, reg_size, data, data_size, deadline);
+    _i2cbus_trace(dev, I2CBUS_TRACE_WRITE, reg, reg_size, data_size, start_us, res);
+
+    return res;
+}
+
+esp_err_t i2cbus_set_post(i2cbus_t *dev, i2cbus_post_t *post, uint8_t *buf, size_t buf_size, uint32_t delay_us)
+{
+    if ((dev == NULL) || (dev->port >= I2C_NUM_MAX) || !i2cbus_port[dev->port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    if ((post != NULL) && ((buf == NULL) || !buf_size || !delay_us))
+        return ESP_ERR_INVALID_ARG;
+
+    TickType_t deadline = i2cbus_deadline(dev->time_out);
+    if (i2cbus_lock(dev->port, deadline) != ESP_OK)
+        return ESP_ERR_TIMEOUT;
+
+    // what the previous staging holds goes out first.
+    i2cbus_post_t *old = dev->post;
+    esp_err_t res = _i2cbus_post_flush(dev, deadline);
+    dev->post = NULL;
+    if (old != NULL) {
+        esp_timer_stop(old->timer);
+        esp_timer_delete(old->timer);
+        old->timer = NULL;
+        _i2cbus_post_cancel(dev->port, old);
+    }
+
+    if (post != NULL) {
+        memset(post, 0, sizeof(i2cbus_post_t));
+        post->dev = dev;
+        post->buf = buf;
+        post->buf_size = buf_size;
+        post->delay_us = delay_us;
+
+        esp_timer_create_args_t args = {
+            .callback = _i2cbus_post_timer,
+            .arg = post,
+            .name = "i2cbus_post",
+        };
+
+        // timed flushes run on a task of the port, started with its first staging.
+        esp_err_t start_res = _i2cbus_post_start(dev->port);
+        if ((start_res == ESP_OK) && (esp_timer_create(&args, &post->timer) != ESP_OK))
+            start_res = ESP_ERR_NO_MEM;
+        if (start_res == ESP_OK)
+            dev->post = post;
+        else
+            res = start_res;
+    }
+    i2cbus_unlock(dev->port);
+
+    return res;
+}
+
+static esp_err_t _i2cbus_flush_until(i2cbus_t *dev, TickType_t deadline)
+{
+    if ((dev == NULL) || (dev->port >= I2C_NUM_MAX) || !i2cbus_port[dev->port].installed)
+        return ESP_ERR_INVALID_ARG;
+
+    // nothing staged without posted writes, no need to wait for port.
+    if (dev->post == NULL)
+        return ESP_OK;
+
+    if (i2cbus_lock(dev->port, deadline) != ESP_OK)
+        return ESP_ERR_TIMEOUT;
+
+    esp_err_t res = ESP_OK;
+    if (dev->post != NULL) {
+        res = dev->post->res;
+        dev->post->res = ESP_OK;
+        esp_err_t flush_res = _i2cbus_post_flush(dev, deadline);
+        if (res == ESP_OK)
+            res = flush_res;
+    }
+    i2cbus_unlock(dev->port);
+
+    return res;
+}
+
+esp_err_t i2cbus_flush_until(i2cbus_t *dev, TickType_t deadline)
+{
+    int64_t start_us = _i2cbus_trace_start();
+    esp_err_t res = _i2cbus_flush_until(dev, deadline);
+    _i2cbus_trace(dev, I2CBUS_TRACE_FLUSH, NULL, 0, 0, start_us, res);
+
+    return res;
+}
+
+esp_err_t i2cbus_flush(i2cbus_t *dev)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return i2cbus_flush_until(dev, i2cbus_deadline(dev->time_out));
+}
+
+static esp_err_t _i2cbus_read_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, 
+                                        size_t data_size, TickType_t deadline)
 {
     esp_err_t res = ESP_ERR_INVALID_ARG;
 
     if (dev != NULL) {
+        // wait for device bandwidth budget before competing for the port.
+        if (_i2cbus_quota_take(dev, (reg ? reg_size : 0), data_size, false, deadline) != ESP_OK)
+            return ESP_ERR_TIMEOUT;
+
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(i2cbus_port[dev->port].mutex, pdMS_TO_TICKS(dev->time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTakeRecursive(i2cbus_port[dev->port].mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
+            // a read sees every write posted before it.
+            res = _i2cbus_flush_until(dev, deadline);
+            if (res != ESP_OK) {
+                xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
+                return res;
+            }
+
             i2c_cmd_handle_t cmd = i2c_cmd_link_create();
             // Select a register to read if needs.
             if (reg && reg_size) {
@@ -209,7 +1211,9 @@ esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
             i2c_master_read(cmd, data, data_size, I2C_MASTER_LAST_NACK);
             // add a stop condition in buffer.
             i2c_master_stop(cmd);
-            res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(dev->time_out));
+            // the transaction only gets what is left of the caller's budget.
+            TickType_t ticks = i2cbus_remaining(deadline);
+            res = ticks ? i2c_master_cmd_begin(dev->port, cmd, ticks) : ESP_ERR_TIMEOUT;
             if (res != ESP_OK) 
                 ESP_LOGE(TAG, "Device not found [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
             
@@ -218,7 +1222,7 @@ esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
 
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(i2cbus_port[dev->port].mutex);
+            xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
@@ -229,6 +1233,81 @@ esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
     return res;
 }
 
+esp_err_t i2cbus_read_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                TickType_t deadline)
+{
+    int64_t start_us = _i2cbus_trace_start();
+    esp_err_t res = _i2cbus_read_reg_until(dev, reg, reg_size, data, data_size, deadline);
+    _i2cbus_trace(dev, I2CBUS_TRACE_READ, reg, reg_size, data_size, start_us, res);
+
+    return res;
+}
+
+esp_err_t i2cbus_read_piece_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                 bool first, bool last, TickType_t deadline)
+{
+    if ((dev == NULL) || (data == NULL) || !data_size)
+        return ESP_ERR_INVALID_ARG;
+
+    // each piece pays for what it puts on the wire.
+    if (_i2cbus_quota_take(dev, (first && reg) ? reg_size : 0, data_size, false, deadline) != ESP_OK)
+        return ESP_ERR_TIMEOUT;
+
+    // caller already holds the port, this only nests.
+    if (xSemaphoreTakeRecursive(i2cbus_port[dev->port].mutex, i2cbus_remaining(deadline)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    // a read sees every write posted before it.
+    if (first) {
+        esp_err_t res = _i2cbus_flush_until(dev, deadline);
+        if (res != ESP_OK) {
+            xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
+            return res;
+        }
+    }
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    if (first) {
+        if (reg && reg_size) {
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, I2C_WRITE(dev->addr), true);
+            i2c_master_write(cmd, (void *)reg, reg_size, true);
+        }
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, I2C_READ(dev->addr), true);
+    }
+    // an ack on the last byte asks the device for more, the next piece reads it.
+    i2c_master_read(cmd, data, data_size, last ? I2C_MASTER_LAST_NACK : I2C_MASTER_ACK);
+    if (last)
+        i2c_master_stop(cmd);
+
+    TickType_t ticks = i2cbus_remaining(deadline);
+    esp_err_t res = ticks ? i2c_master_cmd_begin(dev->port, cmd, ticks) : ESP_ERR_TIMEOUT;
+    if (res != ESP_OK)
+        ESP_LOGE(TAG, "Device not found [0x%02x at %d]: %d (%s)", dev->addr, dev->port, res, esp_err_to_name(res));
+
+    i2c_cmd_link_delete(cmd);
+    xSemaphoreGiveRecursive(i2cbus_port[dev->port].mutex);
+
+    return res;
+}
+
+esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return i2cbus_write_reg_until(dev, reg, reg_size, data, data_size, i2cbus_deadline(dev->time_out));
+}
+
+esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return i2cbus_read_reg_until(dev, reg, reg_size, data, data_size, i2cbus_deadline(dev->time_out));
+}
+
 esp_err_t i2cbus_write(i2cbus_t *dev, uint8_t *data, size_t data_size)
 {
     return i2cbus_write_reg(dev, 0, 0, data, data_size);
@@ -237,4 +1316,14 @@ esp_err_t i2cbus_write(i2cbus_t *dev, uint8_t *data, size_t data_size)
 esp_err_t i2cbus_read(i2cbus_t *dev, uint8_t *data, size_t data_size)
 {
     return i2cbus_read_reg(dev, 0, 0, data, data_size);
+}
+
+esp_err_t i2cbus_write_until(i2cbus_t *dev, uint8_t *data, size_t data_size, TickType_t deadline)
+{
+    return i2cbus_write_reg_until(dev, 0, 0, data, data_size, deadline);
+}
+
+esp_err_t i2cbus_read_until(i2cbus_t *dev, uint8_t *data, size_t data_size, TickType_t deadline)
+{
+    return i2cbus_read_reg_until(dev, 0, 0, data, data_size, deadline);
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_priv.h
+ * 
+ * @brief Internals shared by i2cbus sources, not part of the public API.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Run one piece of a read transaction that spans several commands.
+ * 
+ * The first piece selects the register, if any, and addresses the device 
+ * for reading. Every piece but the last acks its last byte and leaves the 
+ * bus without stop, so the device keeps sending on the next piece. The last
+ * piece nacks its last byte and stops.
+ * 
+ * @note Caller holds the port with i2cbus_lock() from first to last piece.
+ * 
+ * @param dev pointer to device.
+ * @param reg pointer to register address, used by the first piece only.
+ * @param reg_size sizeof register.
+ * @param data receives the piece.
+ * @param data_size sizeof piece, not 0.
+ * @param first first piece of the transaction.
+ * @param last last piece of the transaction.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to read, device not found.
+ */
+esp_err_t i2cbus_read_piece_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                 bool first, bool last, TickType_t deadline);
+
+#ifdef __cplusplus
+}
+#endif
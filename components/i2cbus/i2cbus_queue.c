@@ -0,0 +1,392 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_queue.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "i2cbus_queue.h"
+#include "i2cbus_priv.h"
+
+// LOCAL CONST
+#define I2CBUS_QUEUE_TASK_PRIORITY  CONFIG_I2CBUS_QUEUE_TASK_PRIORITY
+#define I2CBUS_QUEUE_TASK_STACK     CONFIG_I2CBUS_QUEUE_TASK_STACK
+#define I2CBUS_QUEUE_MASK           (I2CBUS_QUEUE_SIZE - 1)
+
+_Static_assert((I2CBUS_QUEUE_SIZE & I2CBUS_QUEUE_MASK) == 0, "I2CBUS_QUEUE_SIZE must be a power of two");
+
+static const char *TAG = "i2cbus_queue";
+
+typedef struct {
+    i2cbus_xfer_t *xfer;        /*!< Posted transaction */
+    volatile uint32_t seq;      /*!< Ring lap the cell is ready for */
+} i2cbus_queue_cell_t;
+
+typedef struct {
+    i2cbus_queue_cell_t cell[I2CBUS_QUEUE_SIZE];
+    volatile uint32_t enqueue;  /*!< Next position claimed by producers */
+    uint32_t dequeue;           /*!< Next position drained by worker */
+    TaskHandle_t worker;        /*!< Task draining ring */
+    bool started;               /*!< Ring set up */
+} i2cbus_queue_t;
+
+typedef struct {
+    i2cbus_xfer_t xfer;         /*!< Slot posted to worker, first so worker can cast it back */
+    size_t chunk;               /*!< Bytes per chunk, half of buffer */
+    bool hold;                  /*!< Port locked for one transaction */
+    uint32_t time_out;          /*!< Per chunk timeout, 0 to use deadline */
+    TickType_t deadline;        /*!< Whole stream deadline */
+    TaskHandle_t worker;        /*!< Worker filling chunks */
+    volatile uint32_t filled;   /*!< Chunks read by worker */
+    volatile uint32_t consumed; /*!< Chunks handed back by caller */
+    volatile bool abort;        /*!< Callback stopped stream */
+} i2cbus_stream_t;
+
+static DRAM_ATTR i2cbus_queue_t i2cbus_queue[I2C_NUM_MAX];
+static portMUX_TYPE i2cbus_queue_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR esp_err_t _i2cbus_queue_push(i2cbus_queue_t *queue, i2cbus_xfer_t *xfer)
+{
+    uint32_t pos = __atomic_load_n(&queue->enqueue, __ATOMIC_RELAXED);
+    i2cbus_queue_cell_t *cell;
+
+    // claim a position with a compare and swap, each cell sequence tells if
+    // the worker has already released it for this lap of the ring.
+    while (true) {
+        cell = &queue->cell[pos & I2CBUS_QUEUE_MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueue, &pos, pos + 1, true, __ATOMIC_RELAXED, 
+                                            __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return ESP_ERR_NO_MEM;
+        } else {
+            pos = __atomic_load_n(&queue->enqueue, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->xfer = xfer;
+    // hand cell to worker.
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+static i2cbus_xfer_t *_i2cbus_queue_pop(i2cbus_queue_t *queue)
+{
+    i2cbus_queue_cell_t *cell = &queue->cell[queue->dequeue & I2CBUS_QUEUE_MASK];
+
+    // cell not published yet, a producer may still be filling it.
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != (queue->dequeue + 1))
+        return NULL;
+
+    i2cbus_xfer_t *xfer = cell->xfer;
+    // release cell to producers of next lap.
+    __atomic_store_n(&cell->seq, queue->dequeue + I2CBUS_QUEUE_SIZE, __ATOMIC_RELEASE);
+    queue->dequeue++;
+
+    return xfer;
+}
+
+// runs on the port worker, the caller consumes chunks meanwhile.
+static esp_err_t _i2cbus_stream_fill(i2cbus_stream_t *stream)
+{
+    i2cbus_xfer_t *xfer = &stream->xfer;
+    uint32_t chunks = (xfer->data_size + stream->chunk - 1) / stream->chunk;
+    TickType_t deadline = stream->time_out ? i2cbus_deadline(stream->time_out) : stream->deadline;
+    bool open = false;
+    esp_err_t res = ESP_OK;
+
+    if (stream->hold) {
+        // a quota is paid for the whole stream before the port is taken.
+        res = i2cbus_prepay_quota_until(xfer->dev, xfer->reg ? xfer->reg_size : 0, xfer->data_size, deadline);
+        if (res != ESP_OK)
+            return res;
+        if (i2cbus_lock(xfer->dev->port, deadline) != ESP_OK)
+            return ESP_ERR_TIMEOUT;
+    }
+
+    for (uint32_t i = 0; (i < chunks) && (res == ESP_OK); i++) {
+        if (stream->time_out && i)
+            deadline = i2cbus_deadline(stream->time_out);
+
+        // a half is free again once the caller is done with the chunk before.
+        while (((i - __atomic_load_n(&stream->consumed, __ATOMIC_ACQUIRE)) >= 2) && !stream->abort) {
+            TickType_t ticks = i2cbus_remaining(deadline);
+            if (!ticks) {
+                res = ESP_ERR_TIMEOUT;
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, ticks);
+        }
+        if ((res != ESP_OK) || stream->abort)
+            break;
+
+        size_t offset = i * stream->chunk;
+        size_t size = ((xfer->data_size - offset) > stream->chunk) ? stream->chunk : (xfer->data_size - offset);
+        uint8_t *half = xfer->data + ((i & 1) * stream->chunk);
+
+        if (stream->hold) {
+            res = i2cbus_read_piece_until(xfer->dev, xfer->reg, xfer->reg_size, half, size, !i, (i + 1) == chunks, 
+                                          deadline);
+            open = (res == ESP_OK) && ((i + 1) < chunks);
+        }
+        else {
+            res = i2cbus_read_reg_until(xfer->dev, xfer->reg, xfer->reg_size, half, size, deadline);
+        }
+
+        if (res == ESP_OK) {
+            __atomic_store_n(&stream->filled, i + 1, __ATOMIC_RELEASE);
+            xTaskNotifyGive(xfer->notify);
+        }
+    }
+
+    if (stream->hold) {
+        // device still sending, a nacked byte and a stop end the transaction.
+        if (open) {
+            uint8_t dummy;
+            i2cbus_read_piece_until(xfer->dev, NULL, 0, &dummy, 1, false, true, i2cbus_deadline(xfer->dev->time_out));
+        }
+        i2cbus_unlock(xfer->dev->port);
+    }
+
+    return res;
+}
+
+static void _i2cbus_queue_worker(void *arg)
+{
+    i2cbus_queue_t *queue = (i2cbus_queue_t *)arg;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        i2cbus_xfer_t *xfer;
+        while ((xfer = _i2cbus_queue_pop(queue)) != NULL) {
+            esp_err_t res;
+            TickType_t deadline = i2cbus_deadline(xfer->dev->time_out);
+
+            if (xfer->op == I2CBUS_XFER_STREAM)
+                res = _i2cbus_stream_fill((i2cbus_stream_t *)xfer);
+            else if (xfer->op == I2CBUS_XFER_READ)
+                res = i2cbus_read_reg_until(xfer->dev, xfer->reg, xfer->reg_size, xfer->data, xfer->data_size, 
+                                            deadline);
+            else
+                res = i2cbus_write_reg_until(xfer->dev, xfer->reg, xfer->reg_size, xfer->data, xfer->data_size, 
+                                             deadline);
+
+            // slot belongs to submitter again once result is stored, take
+            // what is needed from it before.
+            TaskHandle_t notify = xfer->notify;
+            i2cbus_xfer_cb_t done = xfer->done;
+            void *done_arg = xfer->arg;
+            __atomic_store_n(&xfer->res, res, __ATOMIC_RELEASE);
+            if (notify)
+                xTaskNotifyGive(notify);
+            if (done)
+                done(xfer, done_arg);
+        }
+    }
+}
+
+static IRAM_ATTR esp_err_t _i2cbus_submit(i2cbus_xfer_t *xfer, TaskHandle_t *worker)
+{
+    if ((xfer == NULL) || (xfer->dev == NULL) || (xfer->dev->port >= I2C_NUM_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    i2cbus_queue_t *queue = &i2cbus_queue[xfer->dev->port];
+
+    *worker = __atomic_load_n(&queue->worker, __ATOMIC_ACQUIRE);
+    if (*worker == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if (__atomic_exchange_n(&xfer->res, ESP_ERR_NOT_FINISHED, __ATOMIC_ACQ_REL) == ESP_ERR_NOT_FINISHED)
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t res = _i2cbus_queue_push(queue, xfer);
+    if (res != ESP_OK)
+        xfer->res = res;
+
+    return res;
+}
+
+esp_err_t i2cbus_queue_start(i2c_port_t i2c_port)
+{
+    if (i2c_port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    i2cbus_queue_t *queue = &i2cbus_queue[i2c_port];
+    bool starting = false;
+
+    // only the first caller sets the ring up.
+    portENTER_CRITICAL(&i2cbus_queue_lock);
+    if (!queue->started) {
+        queue->started = true;
+        for (uint32_t i = 0; i < I2CBUS_QUEUE_SIZE; i++)
+            queue->cell[i].seq = i;
+        starting = true;
+    }
+    portEXIT_CRITICAL(&i2cbus_queue_lock);
+
+    if (!starting)
+        return ESP_OK;
+
+    TaskHandle_t worker;
+    if (xTaskCreate(_i2cbus_queue_worker, "i2cbus_queue", I2CBUS_QUEUE_TASK_STACK, queue, 
+                    I2CBUS_QUEUE_TASK_PRIORITY, &worker) != pdPASS) {
+        memset(queue, 0, sizeof(i2cbus_queue_t));
+        return ESP_ERR_NO_MEM;
+    }
+
+    // ring becomes visible to submitters only when worker is running.
+    __atomic_store_n(&queue->worker, worker, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "worker started on port %d", i2c_port);
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_submit(i2cbus_xfer_t *xfer)
+{
+    TaskHandle_t worker;
+    esp_err_t res = _i2cbus_submit(xfer, &worker);
+
+    if (res == ESP_OK)
+        xTaskNotifyGive(worker);
+
+    return res;
+}
+
+IRAM_ATTR esp_err_t i2cbus_submit_from_isr(i2cbus_xfer_t *xfer, BaseType_t *woken)
+{
+    TaskHandle_t worker;
+    esp_err_t res = _i2cbus_submit(xfer, &worker);
+
+    if (res == ESP_OK)
+        vTaskNotifyGiveFromISR(worker, woken);
+
+    return res;
+}
+
+esp_err_t i2cbus_xfer_wait(i2cbus_xfer_t *xfer, TickType_t deadline)
+{
+    if (xfer == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    while (__atomic_load_n(&xfer->res, __ATOMIC_ACQUIRE) == ESP_ERR_NOT_FINISHED) {
+        TickType_t ticks = i2cbus_remaining(deadline);
+        if (!ticks)
+            return ESP_ERR_TIMEOUT;
+
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+
+    return xfer->res;
+}
+
+static esp_err_t _i2cbus_read_stream(i2cbus_t *dev, uint8_t *reg, size_t reg_size, size_t size, uint8_t *buf, 
+                                     size_t buf_size, bool hold, i2cbus_stream_cb_t cb, void *arg, 
+                                     uint32_t time_out, TickType_t deadline)
+{
+    if ((dev == NULL) || (dev->port >= I2C_NUM_MAX) || (buf == NULL) || (buf_size < 2) || (cb == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    if (!size)
+        return ESP_OK;
+
+    esp_err_t res = i2cbus_queue_start(dev->port);
+    if (res != ESP_OK)
+        return res;
+
+    i2cbus_stream_t stream = {
+        .xfer = {
+            .dev = dev,
+            .op = I2CBUS_XFER_STREAM,
+            .reg = reg,
+            .reg_size = reg_size,
+            .data = buf,
+            .data_size = size,
+            .notify = xTaskGetCurrentTaskHandle(),
+        },
+        .chunk = buf_size / 2,
+        .hold = hold,
+        .time_out = time_out,
+        .deadline = deadline,
+        .worker = __atomic_load_n(&i2cbus_queue[dev->port].worker, __ATOMIC_ACQUIRE),
+    };
+    uint32_t chunks = (size + stream.chunk - 1) / stream.chunk;
+
+    res = i2cbus_submit(&stream.xfer);
+    if (res != ESP_OK)
+        return res;
+
+    esp_err_t cb_res = ESP_OK;
+    for (uint32_t i = 0; i < chunks; i++) {
+        // worker bounds every wait by its deadline, it always finishes.
+        while ((__atomic_load_n(&stream.filled, __ATOMIC_ACQUIRE) <= i) && 
+               (__atomic_load_n(&stream.xfer.res, __ATOMIC_ACQUIRE) == ESP_ERR_NOT_FINISHED))
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (__atomic_load_n(&stream.filled, __ATOMIC_ACQUIRE) <= i)
+            break;
+
+        size_t offset = i * stream.chunk;
+        cb_res = cb(offset, buf + ((i & 1) * stream.chunk), ((size - offset) > stream.chunk) ? stream.chunk : 
+                    (size - offset), arg);
+        if (cb_res != ESP_OK)
+            stream.abort = true;
+
+        // hand half back to worker.
+        __atomic_store_n(&stream.consumed, i + 1, __ATOMIC_RELEASE);
+        xTaskNotifyGive(stream.worker);
+        if (cb_res != ESP_OK)
+            break;
+    }
+
+    // slot and buffer are on loan to worker until it stores result.
+    while (__atomic_load_n(&stream.xfer.res, __ATOMIC_ACQUIRE) == ESP_ERR_NOT_FINISHED)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return (cb_res != ESP_OK) ? cb_res : stream.xfer.res;
+}
+
+esp_err_t i2cbus_read_stream_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, size_t size, uint8_t *buf, 
+                                   size_t buf_size, bool hold, i2cbus_stream_cb_t cb, void *arg, TickType_t deadline)
+{
+    return _i2cbus_read_stream(dev, reg, reg_size, size, buf, buf_size, hold, cb, arg, 0, deadline);
+}
+
+esp_err_t i2cbus_read_stream(i2cbus_t *dev, uint8_t *reg, size_t reg_size, size_t size, uint8_t *buf, 
+                             size_t buf_size, bool hold, i2cbus_stream_cb_t cb, void *arg)
+{
+    if (dev == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return _i2cbus_read_stream(dev, reg, reg_size, size, buf, buf_size, hold, cb, arg, dev->time_out, 
+                               i2cbus_deadline(dev->time_out));
+}
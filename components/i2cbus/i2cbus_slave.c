@@ -0,0 +1,248 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_slave.c
+ * 
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c.h"
+#include "i2cbus_slave.h"
+
+// LOCAL CONST
+#define I2CBUS_SLAVE_RX_BUF         CONFIG_I2CBUS_SLAVE_RX_BUF
+#define I2CBUS_SLAVE_TASK_PRIORITY  CONFIG_I2CBUS_SLAVE_TASK_PRIORITY
+#define I2CBUS_SLAVE_TASK_STACK     CONFIG_I2CBUS_SLAVE_TASK_STACK
+#define I2CBUS_SLAVE_MAP_MAX        256
+
+static const char *TAG = "i2cbus_slave";
+
+static void _i2cbus_slave_arm(i2cbus_slave_t *slave)
+{
+    size_t size = slave->config.map_size;
+    size_t window = slave->config.read_window ? slave->config.read_window : (size - slave->pointer);
+
+    // take latest committed copy, the one served before goes back to pool.
+    portENTER_CRITICAL(&slave->lock);
+    if (slave->fresh) {
+        uint8_t front = slave->front;
+        slave->front = slave->ready;
+        slave->ready = front;
+        slave->fresh = false;
+    }
+    portEXIT_CRITICAL(&slave->lock);
+
+    // pointer auto-increments and wraps at map end.
+    uint8_t *map = slave->map[slave->front];
+    size_t queued = 0;
+    while (queued < window) {
+        size_t pos = (slave->pointer + queued) % size;
+        size_t chunk = window - queued;
+        if (chunk > (size - pos))
+            chunk = size - pos;
+
+        int len = i2c_slave_write_buffer(slave->port, &map[pos], chunk, 0);
+        if (len <= 0)
+            break;
+        queued += len;
+    }
+
+    slave->stats.reads++;
+    slave->stats.tx_bytes += queued;
+    if (queued < window)
+        slave->stats.tx_short++;
+}
+
+static void _i2cbus_slave_apply(i2cbus_slave_t *slave, const uint8_t *data, size_t size)
+{
+    size_t map_size = slave->config.map_size;
+
+    // a master write lands in every copy: the served one for the reads that 
+    // follow, the committed and staging ones so a commit does not undo it.
+    portENTER_CRITICAL(&slave->lock);
+    for (size_t i = 0; i < size; i++) {
+        size_t pos = (slave->pointer + i) % map_size;
+        for (int copy = 0; copy < 3; copy++)
+            slave->map[copy][pos] = data[i];
+    }
+    portEXIT_CRITICAL(&slave->lock);
+}
+
+static void _i2cbus_slave_task(void *arg)
+{
+    i2cbus_slave_t *slave = (i2cbus_slave_t *)arg;
+    size_t rx_size = slave->config.rx_buf_size;
+
+    while (true) {
+        // first byte of a master write is the register pointer.
+        int len = i2c_slave_read_buffer(slave->port, slave->rx, 1, portMAX_DELAY);
+        if (len <= 0)
+            continue;
+
+        // rest of write comes in driver FIFO batches, a read that times out 
+        // empty ends it.
+        while ((size_t)len < rx_size) {
+            int got = i2c_slave_read_buffer(slave->port, &slave->rx[len], rx_size - len, I2CBUS_SLAVE_GAP_TICKS);
+            if (got <= 0)
+                break;
+            len += got;
+        }
+
+        slave->stats.rx_bytes += len;
+        slave->pointer = slave->rx[0] % slave->config.map_size;
+
+        // the driver ring can not be flushed, a window armed for a write of 
+        // registers would be left unread: only a pointer alone arms one.
+        if (len == 1) {
+            _i2cbus_slave_arm(slave);
+            continue;
+        }
+
+        slave->stats.writes++;
+        _i2cbus_slave_apply(slave, &slave->rx[1], len - 1);
+        if (slave->config.on_write)
+            slave->config.on_write(slave->pointer, &slave->rx[1], len - 1, slave->config.arg);
+        slave->pointer = (slave->pointer + len - 1) % slave->config.map_size;
+    }
+}
+
+esp_err_t i2cbus_slave_init(i2cbus_slave_t *slave, i2c_port_t i2c_port, gpio_num_t i2c_sda, gpio_num_t i2c_scl, 
+                            const i2cbus_slave_config_t *config)
+{
+    if ((slave == NULL) || (config == NULL) || (i2c_port >= I2C_NUM_MAX) || (config->addr > 0x7F) || 
+        !config->map_size || (config->map_size > I2CBUS_SLAVE_MAP_MAX) || (config->read_window > config->map_size))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(slave, 0, sizeof(i2cbus_slave_t));
+    slave->port = i2c_port;
+    slave->config = *config;
+    if (!slave->config.rx_buf_size)
+        slave->config.rx_buf_size = I2CBUS_SLAVE_RX_BUF;
+
+    // TX ring holds one window at most, bytes a master left unread can not 
+    // pile up behind the windows armed later.
+    size_t window = slave->config.read_window ? slave->config.read_window : slave->config.map_size;
+    if (!slave->config.tx_buf_size || (slave->config.tx_buf_size > window))
+        slave->config.tx_buf_size = window;
+    portMUX_INITIALIZE(&slave->lock);
+
+    // three map copies and receive buffer in one block.
+    uint8_t *mem = calloc(1, (3 * slave->config.map_size) + slave->config.rx_buf_size);
+    if (mem == NULL)
+        return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < 3; i++)
+        slave->map[i] = &mem[i * slave->config.map_size];
+    slave->rx = &mem[3 * slave->config.map_size];
+    slave->front = 0;
+    slave->ready = 1;
+    slave->back = 2;
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_SLAVE,
+        .sda_io_num = i2c_sda,
+        .scl_io_num = i2c_scl,
+        .sda_pullup_en = GPIO_PULLUP_DISABLE,
+        .scl_pullup_en = GPIO_PULLUP_DISABLE,
+        .slave.addr_10bit_en = 0,
+        .slave.slave_addr = config->addr,
+    };
+
+    esp_err_t res = i2c_param_config(i2c_port, &conf);
+    if (res == ESP_OK)
+        res = i2c_driver_install(i2c_port, I2C_MODE_SLAVE, slave->config.rx_buf_size, slave->config.tx_buf_size, 0);
+    if (res != ESP_OK) {
+        free(mem);
+        return ESP_FAIL;
+    }
+
+    slave->stats_us = esp_timer_get_time();
+    if (xTaskCreate(_i2cbus_slave_task, "i2cbus_slave", I2CBUS_SLAVE_TASK_STACK, slave, 
+                    I2CBUS_SLAVE_TASK_PRIORITY, &slave->task) != pdPASS) {
+        i2c_driver_delete(i2c_port);
+        free(mem);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "slave 0x%02x started on port %d", config->addr, i2c_port);
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_slave_set(i2cbus_slave_t *slave, uint8_t reg, const uint8_t *data, size_t size)
+{
+    if ((slave == NULL) || (data == NULL) || ((reg + size) > slave->config.map_size))
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(&slave->map[slave->back][reg], data, size);
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_slave_commit(i2cbus_slave_t *slave)
+{
+    if (slave == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    // staged copy becomes latest, the previous latest becomes staging. The one 
+    // just published seeds staging, in the same section as master writes go 
+    // to both.
+    portENTER_CRITICAL(&slave->lock);
+    uint8_t back = slave->back;
+    slave->back = slave->ready;
+    slave->ready = back;
+    slave->fresh = true;
+    memcpy(slave->map[slave->back], slave->map[back], slave->config.map_size);
+    portEXIT_CRITICAL(&slave->lock);
+    slave->stats.commits++;
+
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_slave_get_stats(i2cbus_slave_t *slave, i2cbus_slave_stats_t *stats, bool reset)
+{
+    if ((slave == NULL) || (stats == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    int64_t now = esp_timer_get_time();
+
+    *stats = slave->stats;
+    stats->elapsed_us = now - slave->stats_us;
+    if (stats->elapsed_us > 0) {
+        stats->rx_rate = (stats->rx_bytes * 1000000) / stats->elapsed_us;
+        stats->tx_rate = (stats->tx_bytes * 1000000) / stats->elapsed_us;
+    }
+
+    if (reset) {
+        memset(&slave->stats, 0, sizeof(i2cbus_slave_stats_t));
+        slave->stats_us = now;
+    }
+
+    return ESP_OK;
+}
@@ -33,6 +33,7 @@
 
 #include "esp_err.h"
 #include "driver/i2c.h"
+#include "esp_timer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,12 +44,85 @@ extern "C" {
 #define I2C_MASTER_FREQ     CONFIG_I2C_MASTER_FREQ  /*!< I2C master clock frequency */
 #define I2C_TIMEOUT         CONFIG_I2C_TIMEOUT      /*!< I2C timeout */
 
-typedef struct 
+typedef enum {
+    I2CBUS_QUOTA_BYTES = 0,     /*!< Budget counts bytes written and read */
+    I2CBUS_QUOTA_BUS_US         /*!< Budget counts microseconds on the wire */
+} i2cbus_quota_unit_t;
+
+typedef struct i2cbus_quota
+{
+    i2cbus_quota_unit_t unit;   /*!< What budget counts */
+    uint32_t budget;            /*!< Units allowed per window */
+    uint32_t window_us;         /*!< Budget window */
+    int64_t tokens;             /*!< Bucket level, scaled by window_us */
+    int64_t refill_us;          /*!< Last bucket refill */
+    int64_t since_us;           /*!< Start of statistics */
+    uint64_t used;              /*!< Units used since start of statistics */
+    uint32_t deferred;          /*!< Transfers deferred for lack of budget */
+    uint64_t deferred_us;       /*!< Time spent deferred */
+    int64_t credit;             /*!< Units paid ahead with i2cbus_prepay_quota_until() */
+    portMUX_TYPE lock;          /*!< Guards bucket among tasks sharing device */
+} i2cbus_quota_t;
+
+typedef struct
+{
+    int64_t elapsed_us;         /*!< Time covered by statistics */
+    uint64_t used;              /*!< Units used */
+    uint64_t budgeted;          /*!< Units allowed over elapsed time */
+    uint32_t utilization;       /*!< Used over budgeted, in percent */
+    uint32_t deferred;          /*!< Transfers deferred for lack of budget */
+    uint64_t deferred_us;       /*!< Time spent deferred */
+} i2cbus_quota_stats_t;
+
+typedef struct i2cbus_post
+{
+    struct i2cbus_dev *dev;     /*!< Device staging writes here */
+    uint8_t *buf;               /*!< Staging buffer, register bytes of the burst first */
+    size_t buf_size;            /*!< sizeof buffer, a full buffer is flushed */
+    size_t len;                 /*!< Bytes staged */
+    size_t reg_size;            /*!< Register bytes heading the burst, 0 for raw writes */
+    uint32_t next_reg;          /*!< Register a write must select to join the burst */
+    uint32_t delay_us;          /*!< Longest time a write stays staged */
+    esp_timer_handle_t timer;   /*!< Flushes burst once delay_us expires */
+    esp_err_t res;              /*!< Failure of a timed flush, reported to next write */
+    uint32_t writes;            /*!< Writes posted */
+    uint32_t flushes;           /*!< Transactions sent for posted writes */
+} i2cbus_post_t;
+
+typedef enum {
+    I2CBUS_TRACE_WRITE = 0,     /*!< i2cbus_write_reg() and its variants */
+    I2CBUS_TRACE_READ,          /*!< i2cbus_read_reg() and its variants */
+    I2CBUS_TRACE_PING,          /*!< i2cbus_ping_until() */
+    I2CBUS_TRACE_FLUSH          /*!< i2cbus_flush() and its variants */
+} i2cbus_trace_op_t;
+
+typedef struct
+{
+    int64_t start_us;           /*!< Call entry, esp_timer_get_time() */
+    int64_t end_us;             /*!< Call return */
+    TaskHandle_t task;          /*!< Calling task */
+    i2c_port_t port;            /*!< I2C port of device */
+    uint8_t addr;               /*!< Device address */
+    i2cbus_trace_op_t op;       /*!< Call made */
+    uint32_t reg;               /*!< Register address, last four bytes of it, most significant first */
+    size_t reg_size;            /*!< sizeof register, 0 for raw transfers */
+    size_t data_size;           /*!< Data bytes written or read */
+    esp_err_t res;              /*!< Call result */
+} i2cbus_trace_t;
+
+/**
+ * @brief Trace callback, runs in the calling task right after a call returns.
+ */
+typedef void (*i2cbus_trace_cb_t)(const i2cbus_trace_t *event, void *arg);
+
+typedef struct i2cbus_dev
 {
     i2c_port_t port;            /*!< I2C port to access */
     SemaphoreHandle_t mutex;    /*!< Device mutex semaphore */
     uint8_t addr;               /*!< Device address */
     uint32_t time_out;          /*!< I2C comunication timeout */
+    i2cbus_quota_t *quota;      /*!< Bandwidth budget, NULL when unlimited */
+    i2cbus_post_t *post;        /*!< Posted writes staging, NULL when writes go at once */
 } i2cbus_t;
 
 
@@ -56,13 +130,14 @@ typedef struct
  * @brief Initiate i2cbus and start thread safe controll.
  * 
  * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
- * @param i2c_mode I2C mode (either master or slave).
+ * @param i2c_mode I2C mode, only master, slave ports use i2cbus_slave_init().
  * @param i2c_sda GPIO number for I2C SDA signal.
  * @param i2c_scl GPIO number for I2C SCL signal.
  *
  * @return 
  *     - ESP_OK: success.
  *     - ESP_FAIL: fail to init.
+ *     - ESP_ERR_NOT_SUPPORTED: slave mode.
  */
 esp_err_t i2cbus_init(i2c_port_t i2c_port, i2c_mode_t i2c_mode, gpio_num_t i2c_sda, gpio_num_t i2c_scl);
 
@@ -76,6 +151,7 @@ esp_err_t i2cbus_init(i2c_port_t i2c_port, i2c_mode_t i2c_mode, gpio_num_t i2c_s
  *
  * @return 
  *     - ESP_OK: success.
+ *     - ESP_ERR_NOT_FOUND: a scan of port did not find device.
  *     - ESP_FAIL: fail to start.
  */
 esp_err_t i2cbus_create(i2cbus_t *dev, i2c_port_t i2c_port, uint8_t addr);
@@ -94,6 +170,343 @@ esp_err_t i2cbus_create(i2cbus_t *dev, i2c_port_t i2c_port, uint8_t addr);
 esp_err_t i2cbus_delete(i2cbus_t *dev);
 
 
+/**
+ * @brief Limit bandwidth a device can take from its port.
+ * 
+ * @note A token bucket refilled at budget per window is checked before each 
+ *       transfer of device. Transfers over budget are deferred until the bucket 
+ *       refills, not failed, as long as their deadline allows it. A transfer 
+ *       larger than budget is let through and paid back by the next ones. 
+ *       A transfer made while its task holds the port, with i2cbus_lock() or 
+ *       as a driver burst, is never deferred rather than keep the port from 
+ *       other devices: it uses what i2cbus_prepay_quota_until() paid before 
+ *       the port was taken, or goes into debt the next transfers wait out. 
+ *       Posted writes pay when they are posted, not when flushed.
+ * 
+ * @param dev pointer to device configurations.
+ * @param quota storage of quota, it must live as long as device. NULL removes 
+ *              the limit.
+ * @param unit what budget counts.
+ * @param budget units allowed per window.
+ * @param window_us budget window, at least one RTOS tick long is advisable.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t i2cbus_set_quota(i2cbus_t *dev, i2cbus_quota_t *quota, i2cbus_quota_unit_t unit, uint32_t budget, 
+                           uint32_t window_us);
+
+
+/**
+ * @brief Pay the quota of a device for transfers made later holding the port.
+ * 
+ * @note Waits for the budget as a transfer would, and keeps what was paid as a 
+ *       credit the next transfers of device use instead of paying. Drivers 
+ *       call it before i2cbus_lock() with the sizes they are about to transfer, 
+ *       so their transfers are deferred before the port is taken. Without 
+ *       sizes it only waits until the device is within budget, for callers 
+ *       that learn what they transfer once the port is held. Called with the 
+ *       port held, it pays at once and goes into debt if it must.
+ * 
+ * @param dev pointer to device configurations.
+ * @param wr_size bytes to write, register bytes included, 0 with rd_size 0 to 
+ *                only wait for the budget.
+ * @param rd_size bytes to read.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success, or device has no quota.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expires before the budget allows it.
+ */
+esp_err_t i2cbus_prepay_quota_until(i2cbus_t *dev, size_t wr_size, size_t rd_size, TickType_t deadline);
+
+
+/**
+ * @brief Report achieved versus budgeted utilization of a device.
+ * 
+ * @param dev pointer to device configurations.
+ * @param stats receives statistics since quota was set or last reset.
+ * @param reset restart statistics after reading them.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: device has no quota.
+ */
+esp_err_t i2cbus_get_quota_stats(i2cbus_t *dev, i2cbus_quota_stats_t *stats, bool reset);
+
+
+/**
+ * @brief Post writes of a device instead of sending them at once.
+ * 
+ * @note Writes are staged and return at once. A write to the register that 
+ *       follows the last one staged, or a raw write after raw writes, joins 
+ *       the staged burst, so the device must auto-increment its register or 
+ *       take a byte stream. The burst goes as one transaction when the buffer 
+ *       fills, delay_us after its first write, on i2cbus_flush(), before a 
+ *       write that cannot join it, and before any read or ping of the device.
+ *       A driver that waits for the device after a write must flush first.
+ * 
+ * @param dev pointer to device configurations.
+ * @param post storage of staging state, it must live as long as device. NULL 
+ *             flushes what is staged and sends writes at once again.
+ * @param buf staging buffer, it must live as long as device.
+ * @param buf_size sizeof buffer, writes larger than it are sent at once.
+ * @param delay_us longest time a write stays staged.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to create flush timer or port flush task.
+ *     - other: see i2cbus_flush_until(), when removing staging.
+ */
+esp_err_t i2cbus_set_post(i2cbus_t *dev, i2cbus_post_t *post, uint8_t *buf, size_t buf_size, uint32_t delay_us);
+
+
+/**
+ * @brief Send the writes a device has staged.
+ * 
+ * @param dev pointer to device configurations.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success, or nothing staged.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to write, device not found. Staged writes are dropped.
+ */
+esp_err_t i2cbus_flush_until(i2cbus_t *dev, TickType_t deadline);
+
+
+/**
+ * @brief Send the writes a device has staged within device timeout.
+ * 
+ * @param dev pointer to device configurations.
+ *
+ * @return see i2cbus_flush_until().
+ */
+esp_err_t i2cbus_flush(i2cbus_t *dev);
+
+
+/**
+ * @brief Compute an absolute deadline for the `_until` functions.
+ * 
+ * @param time_out timeout in milliseconds counted from now.
+ *
+ * @return tick count at which the deadline expires.
+ */
+TickType_t i2cbus_deadline(uint32_t time_out);
+
+
+/**
+ * @brief Get the budget left before a deadline expires.
+ * 
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return ticks left until deadline, zero if it has already expired.
+ */
+TickType_t i2cbus_remaining(TickType_t deadline);
+
+
+/**
+ * @brief Probe one address and record the result in port presence map.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ * @param addr 7-bit device address.
+ *
+ * @return 
+ *     - ESP_OK: device acknowledged its address.
+ *     - ESP_ERR_NOT_FOUND: no device at address.
+ *     - ESP_ERR_INVALID_ARG: port not initiated or invalid address.
+ *     - ESP_ERR_TIMEOUT: bus is busy or stuck.
+ */
+esp_err_t i2cbus_probe(i2c_port_t i2c_port, uint8_t addr);
+
+
+/**
+ * @brief Probe every non reserved address of a port and fill its presence map.
+ * 
+ * @note Probes are address only writes with a CONFIG_I2CBUS_SCAN_TIMEOUT 
+ *       timeout. Once a port is scanned, i2cbus_create() fails right away for
+ *       absent devices instead of each access waiting for its timeout.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: port not initiated.
+ *     - ESP_ERR_TIMEOUT: bus is busy or stuck, presence map is left unused.
+ */
+esp_err_t i2cbus_scan(i2c_port_t i2c_port);
+
+
+/**
+ * @brief Scan every initiated port, each controller in parallel.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_STATE: no port initiated.
+ *     - ESP_ERR_TIMEOUT: a bus is busy or stuck.
+ */
+esp_err_t i2cbus_scan_all(void);
+
+
+/**
+ * @brief Check port presence map for a device.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ * @param addr 7-bit device address.
+ *
+ * @return true if device was found or port was not scanned yet.
+ */
+bool i2cbus_present(i2c_port_t i2c_port, uint8_t addr);
+
+
+/**
+ * @brief Find the fastest clock the wiring of a port carries reliably.
+ * 
+ * @note The port is scanned at CONFIG_I2C_MASTER_FREQ, then the clock steps up 
+ *       by CONFIG_I2CBUS_AUTOTUNE_STEP until CONFIG_I2CBUS_AUTOTUNE_MAX. Each 
+ *       step probes every address CONFIG_I2CBUS_AUTOTUNE_ROUNDS times and must 
+ *       read the presence map back without a single lost or phantom ack. Each 
+ *       present device is read a few bytes every round too, and must return 
+ *       the bytes it read twice alike at CONFIG_I2C_MASTER_FREQ; devices that 
+ *       read different bytes there, live data or a moving register pointer, 
+ *       only have to answer. The fastest verified step lowered by 
+ *       CONFIG_I2CBUS_AUTOTUNE_MARGIN is kept and, with 
+ *       CONFIG_I2CBUS_AUTOTUNE_NVS, stored for i2cbus_init() of later boots. 
+ *       Devices are read from their current position and are never written. 
+ *       Run it with the bus otherwise idle, a device busy with a write cycle 
+ *       fails its step.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success, port runs at tuned clock.
+ *     - ESP_ERR_INVALID_ARG: port not initiated.
+ *     - ESP_ERR_TIMEOUT: bus is busy or stuck.
+ *     - ESP_ERR_NOT_FOUND: no device to verify against.
+ *     - ESP_ERR_NO_MEM: fail to allocate reference data.
+ *     - ESP_FAIL: bus unreliable even at CONFIG_I2C_MASTER_FREQ.
+ *     - other: NVS error, port runs at tuned clock but it was not stored.
+ */
+esp_err_t i2cbus_autotune(i2c_port_t i2c_port);
+
+
+/**
+ * @brief Get the clock a port runs at.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ *
+ * @return SCL frequency in Hz, 0 if port is not initiated.
+ */
+uint32_t i2cbus_get_freq(i2c_port_t i2c_port);
+
+
+/**
+ * @brief Set the clock a port runs at.
+ * 
+ * @note It applies from the next transaction on and is not stored, a tuned 
+ *       clock kept in NVS still wins at next i2cbus_init().
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ * @param freq SCL frequency in Hz.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument or port not initiated.
+ *     - ESP_ERR_TIMEOUT: bus is busy.
+ *     - ESP_FAIL: driver refused the clock.
+ */
+esp_err_t i2cbus_set_freq(i2c_port_t i2c_port, uint32_t freq);
+
+
+/**
+ * @brief Address a device once, without data, before a deadline.
+ * 
+ * @note Unlike transfers it logs nothing on NACK and leaves the presence map 
+ *       alone, it suits ACK polling of devices busy with an internal cycle.
+ * 
+ * @param dev pointer to device.
+ * @param deadline absolute deadline.
+ *
+ * @return 
+ *     - ESP_OK: device acknowledged its address.
+ *     - ESP_FAIL: device did not acknowledge.
+ *     - ESP_ERR_INVALID_ARG: invalid argument or port not initiated.
+ *     - ESP_ERR_TIMEOUT: bus is busy or deadline expired.
+ */
+esp_err_t i2cbus_ping_until(i2cbus_t *dev, TickType_t deadline);
+
+
+/**
+ * @brief Hold a port for a burst of transfers.
+ * 
+ * @note The calling task can keep using every transfer function on the port 
+ *       while holding it, other tasks wait until i2cbus_unlock() is called.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ * @param deadline absolute deadline to get the port.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: port not initiated.
+ *     - ESP_ERR_TIMEOUT: bus is busy.
+ */
+esp_err_t i2cbus_lock(i2c_port_t i2c_port, TickType_t deadline);
+
+
+/**
+ * @brief Release a port held by i2cbus_lock().
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: port not initiated.
+ *     - ESP_ERR_INVALID_STATE: port not held by calling task.
+ */
+esp_err_t i2cbus_unlock(i2c_port_t i2c_port);
+
+
+/**
+ * @brief Estimate time on the wire of one transaction.
+ * 
+ * @note Counts start, address, data, ACK and stop bits at port clock speed, 
+ *       driver and task switching overhead is not included.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ * @param wr_size bytes written after address, register included.
+ * @param rd_size bytes read after a repeated start, zero for write only.
+ *
+ * @return transaction time in microseconds.
+ */
+uint32_t i2cbus_wire_time_us(i2c_port_t i2c_port, size_t wr_size, size_t rd_size);
+
+
+/**
+ * @brief Report transfer calls of every device to a callback.
+ * 
+ * @note One event per write, read, ping or flush call, as the caller made it: 
+ *       a posted write is one event though it may share a transaction, the 
+ *       flush a read or ping does first is part of that read or ping. Drivers 
+ *       on top, lcd_i2c among them, show as the calls they make. Transfers 
+ *       queued with i2cbus_submit() show as calls of the submission worker. 
+ *       Pieces of read streams are not reported. Keep the callback short, it 
+ *       delays its caller; copying the event to a ring is the intended use.
+ * 
+ * @param cb callback, NULL stops tracing.
+ * @param arg handed to callback.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_NOT_SUPPORTED: built without CONFIG_I2CBUS_TRACE.
+ */
+esp_err_t i2cbus_set_trace(i2cbus_trace_cb_t cb, void *arg);
+
+
 /**
  * @brief Write data to device at specific register.
  * 
@@ -112,6 +525,29 @@ esp_err_t i2cbus_delete(i2cbus_t *dev);
 esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size);
 
 
+/**
+ * @brief Write data to device at specific register before a deadline.
+ * 
+ * @note On a device with posted writes, see i2cbus_set_post(), it returns once
+ *       data is staged, or with the result of the burst it had to flush.
+ * 
+ * @param dev pointer to device configurations.
+ * @param reg register address to write.
+ * @param reg_size sizeof register.
+ * @param data data to write on device.
+ * @param data_size sizeof data.
+ * @param deadline absolute deadline shared by the lock wait and the transfer.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_FAIL: fail to write, device not found.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ */
+esp_err_t i2cbus_write_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                 TickType_t deadline);
+
+
 /**
  * @brief Read data from device at specific register.
  * 
@@ -130,6 +566,26 @@ esp_err_t i2cbus_write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
 esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size);
 
 
+/**
+ * @brief Read data from device at specific register before a deadline.
+ * 
+ * @param dev pointer to device configurations.
+ * @param reg register address  to read.
+ * @param reg_size sizeof register.
+ * @param data data pointer to send read data.
+ * @param data_size sizeof data read.
+ * @param deadline absolute deadline shared by the lock wait and the transfer.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_FAIL: fail to write, device not found.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ */
+esp_err_t i2cbus_read_reg_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size, 
+                                TickType_t deadline);
+
+
 /**
  * @brief Write data to device.
  * 
@@ -146,6 +602,23 @@ esp_err_t i2cbus_read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t
 esp_err_t i2cbus_write(i2cbus_t *dev, uint8_t *data, size_t data_size);
 
 
+/**
+ * @brief Write data to device before a deadline.
+ * 
+ * @param dev pointer to device configurations.
+ * @param data data to read from device.
+ * @param data_size sizeof data read.
+ * @param deadline absolute deadline shared by the lock wait and the transfer.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_FAIL: fail to write, device not found.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ */
+esp_err_t i2cbus_write_until(i2cbus_t *dev, uint8_t *data, size_t data_size, TickType_t deadline);
+
+
 /**
  * @brief Read data from device.
  * 
@@ -161,6 +634,23 @@ esp_err_t i2cbus_write(i2cbus_t *dev, uint8_t *data, size_t data_size);
  */
 esp_err_t i2cbus_read(i2cbus_t *dev, uint8_t *data, size_t data_size);
 
+
+/**
+ * @brief Read data from device before a deadline.
+ * 
+ * @param dev pointer to device configurations.
+ * @param data data pointer to send read data.
+ * @param data_size sizeof data read.
+ * @param deadline absolute deadline shared by the lock wait and the transfer.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_FAIL: fail to write, device not found.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ */
+esp_err_t i2cbus_read_until(i2cbus_t *dev, uint8_t *data, size_t data_size, TickType_t deadline);
+
 /**@}*/
 
 #ifdef __cplusplus
@@ -0,0 +1,322 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus.hpp
+ * @defgroup i2cbus_cpp i2cbus_cpp
+ * @ingroup i2cbus
+ * @{
+ *
+ * @brief Header-only C++17 device and register layer over i2cbus.
+ * 
+ * Register address, width, byte order and access are template parameters, so 
+ * marshalling is resolved at compile time into stack buffers and each access 
+ * is one direct i2cbus call, without heap or virtual dispatch.
+ * 
+ * @code{.cpp}
+ * using Mpu = i2cbus::Device<I2C_NUM_0, 0x68>;
+ * using WhoAmI = i2cbus::Register<0x75, 1, i2cbus::Endian::Big, i2cbus::Access::ReadOnly>;
+ * using AccelX = i2cbus::Register<0x3B, 2, i2cbus::Endian::Big, i2cbus::Access::ReadOnly>;
+ * using Config = i2cbus::Register<0x1A, 1>;
+ * using DlpfCfg = i2cbus::Field<Config, 0, 3>;
+ * 
+ * Mpu mpu;
+ * mpu.init();
+ * uint16_t x;
+ * mpu.read<AccelX>(x);
+ * mpu.modify<DlpfCfg>(3);
+ * @endcode
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "i2cbus.h"
+
+namespace i2cbus {
+
+enum class Endian {
+    Big,                        /*!< Most significant byte at lowest address */
+    Little                      /*!< Least significant byte at lowest address */
+};
+
+enum class Access {
+    ReadOnly,
+    WriteOnly,
+    ReadWrite
+};
+
+namespace detail {
+
+template <size_t Width>
+struct uint_for {
+    static_assert((Width == 1) || (Width == 2) || (Width == 4) || (Width == 8), "register width must be 1, 2, 4 or 8 bytes");
+    using type = std::conditional_t<(Width == 1), uint8_t, 
+                 std::conditional_t<(Width == 2), uint16_t, 
+                 std::conditional_t<(Width == 4), uint32_t, uint64_t>>>;
+};
+
+template <typename T, size_t Width, Endian Order>
+constexpr std::array<uint8_t, Width> encode(T value)
+{
+    std::array<uint8_t, Width> buf{};
+    for (size_t i = 0; i < Width; i++) {
+        size_t shift = (Order == Endian::Big) ? (Width - 1 - i) * 8 : i * 8;
+        buf[i] = static_cast<uint8_t>(value >> shift);
+    }
+    return buf;
+}
+
+template <typename T, size_t Width, Endian Order>
+constexpr T decode(const std::array<uint8_t, Width> &buf)
+{
+    T value = 0;
+    for (size_t i = 0; i < Width; i++) {
+        size_t shift = (Order == Endian::Big) ? (Width - 1 - i) * 8 : i * 8;
+        value |= static_cast<T>(buf[i]) << shift;
+    }
+    return value;
+}
+
+} // namespace detail
+
+/**
+ * @brief Device register.
+ * 
+ * @tparam Addr register address.
+ * @tparam Width register size in bytes, 1, 2, 4 or 8.
+ * @tparam Order byte order of multi-byte registers.
+ * @tparam Mode allowed accesses, checked at compile time.
+ * @tparam AddrWidth register address size in bytes, sent most significant first.
+ */
+template <uint32_t Addr, size_t Width = 1, Endian Order = Endian::Big, Access Mode = Access::ReadWrite, 
+          size_t AddrWidth = 1>
+struct Register {
+    static_assert((AddrWidth >= 1) && (AddrWidth <= 4), "register address must be 1 to 4 bytes");
+    static_assert((AddrWidth == 4) || (Addr < (1UL << (AddrWidth * 8))), "register address does not fit its width");
+
+    using value_type = typename detail::uint_for<Width>::type;
+
+    static constexpr uint32_t addr = Addr;
+    static constexpr size_t width = Width;
+    static constexpr Endian order = Order;
+    static constexpr bool readable = Mode != Access::WriteOnly;
+    static constexpr bool writable = Mode != Access::ReadOnly;
+    static constexpr std::array<uint8_t, AddrWidth> addr_bytes = detail::encode<uint32_t, AddrWidth, Endian::Big>(Addr);
+
+    static constexpr std::array<uint8_t, Width> encode(value_type value)
+    {
+        return detail::encode<value_type, Width, Order>(value);
+    }
+
+    static constexpr value_type decode(const std::array<uint8_t, Width> &buf)
+    {
+        return detail::decode<value_type, Width, Order>(buf);
+    }
+};
+
+/**
+ * @brief Bit field of a register.
+ * 
+ * @tparam Reg register holding field.
+ * @tparam Lsb position of field least significant bit.
+ * @tparam Bits field size in bits.
+ * @tparam T field value type, register value type by default, it may be an enum.
+ */
+template <typename Reg, unsigned Lsb, unsigned Bits, typename T = typename Reg::value_type>
+struct Field {
+    static_assert((Bits > 0) && ((Lsb + Bits) <= (Reg::width * 8)), "field does not fit its register");
+
+    using reg = Reg;
+    using value_type = T;
+    using reg_type = typename Reg::value_type;
+
+    static constexpr reg_type mask = static_cast<reg_type>(((Bits == (sizeof(reg_type) * 8)) ? ~0ULL : ((1ULL << Bits) - 1)) << Lsb);
+
+    static constexpr reg_type insert(reg_type reg_value, T value)
+    {
+        return static_cast<reg_type>((reg_value & ~mask) | ((static_cast<reg_type>(value) << Lsb) & mask));
+    }
+
+    static constexpr T extract(reg_type reg_value)
+    {
+        return static_cast<T>((reg_value & mask) >> Lsb);
+    }
+};
+
+/**
+ * @brief Device on a port, a thin owner of an i2cbus_t.
+ * 
+ * @tparam Port I2C port number lesser than I2C_NUM_MAX.
+ * @tparam Addr 7-bit device address.
+ */
+template <i2c_port_t Port, uint8_t Addr>
+class Device {
+    static_assert(Addr < 0x80, "device address must be 7-bit");
+
+public:
+    static constexpr i2c_port_t port = Port;
+    static constexpr uint8_t addr = Addr;
+
+    /**
+     * @brief Create device on its port, see i2cbus_create().
+     */
+    esp_err_t init()
+    {
+        return i2cbus_create(&bus_, Port, Addr);
+    }
+
+    /**
+     * @brief Delete device, see i2cbus_delete().
+     */
+    esp_err_t deinit()
+    {
+        return i2cbus_delete(&bus_);
+    }
+
+    /**
+     * @brief Underlying device, to use the C API directly.
+     */
+    i2cbus_t *bus()
+    {
+        return &bus_;
+    }
+
+    /**
+     * @brief Read a register before deadline.
+     */
+    template <typename Reg>
+    esp_err_t read_until(typename Reg::value_type &value, TickType_t deadline)
+    {
+        static_assert(Reg::readable, "register is write-only");
+        auto reg = Reg::addr_bytes;
+        std::array<uint8_t, Reg::width> buf;
+
+        esp_err_t res = i2cbus_read_reg_until(&bus_, reg.data(), reg.size(), buf.data(), buf.size(), deadline);
+        if (res == ESP_OK)
+            value = Reg::decode(buf);
+        return res;
+    }
+
+    /**
+     * @brief Write a register before deadline.
+     */
+    template <typename Reg>
+    esp_err_t write_until(typename Reg::value_type value, TickType_t deadline)
+    {
+        static_assert(Reg::writable, "register is read-only");
+        auto reg = Reg::addr_bytes;
+        auto buf = Reg::encode(value);
+
+        return i2cbus_write_reg_until(&bus_, reg.data(), reg.size(), buf.data(), buf.size(), deadline);
+    }
+
+    /**
+     * @brief Read a field before deadline, one register read.
+     */
+    template <typename F>
+    esp_err_t read_field_until(typename F::value_type &value, TickType_t deadline)
+    {
+        typename F::reg_type reg_value;
+
+        esp_err_t res = read_until<typename F::reg>(reg_value, deadline);
+        if (res == ESP_OK)
+            value = F::extract(reg_value);
+        return res;
+    }
+
+    /**
+     * @brief Update fields of one register before deadline.
+     * 
+     * @note One read and one write, with the port held in between so no other 
+     *       task can change register meanwhile.
+     */
+    template <typename F, typename... Fs>
+    esp_err_t modify_until(typename F::value_type value, typename Fs::value_type... values, TickType_t deadline)
+    {
+        using Reg = typename F::reg;
+        static_assert((std::is_same_v<Reg, typename Fs::reg> && ...), "fields must share one register");
+        static_assert(Reg::readable && Reg::writable, "register must be read-write");
+
+        esp_err_t res = i2cbus_lock(Port, deadline);
+        if (res != ESP_OK)
+            return res;
+
+        typename Reg::value_type reg_value;
+        res = read_until<Reg>(reg_value, deadline);
+        if (res == ESP_OK) {
+            reg_value = F::insert(reg_value, value);
+            ((reg_value = Fs::insert(reg_value, values)), ...);
+            res = write_until<Reg>(reg_value, deadline);
+        }
+
+        i2cbus_unlock(Port);
+        return res;
+    }
+
+    /**
+     * @brief Read a register, with device timeout.
+     */
+    template <typename Reg>
+    esp_err_t read(typename Reg::value_type &value)
+    {
+        return read_until<Reg>(value, i2cbus_deadline(bus_.time_out));
+    }
+
+    /**
+     * @brief Write a register, with device timeout.
+     */
+    template <typename Reg>
+    esp_err_t write(typename Reg::value_type value)
+    {
+        return write_until<Reg>(value, i2cbus_deadline(bus_.time_out));
+    }
+
+    /**
+     * @brief Read a field, with device timeout.
+     */
+    template <typename F>
+    esp_err_t read_field(typename F::value_type &value)
+    {
+        return read_field_until<F>(value, i2cbus_deadline(bus_.time_out));
+    }
+
+    /**
+     * @brief Update fields of one register, with device timeout.
+     */
+    template <typename F, typename... Fs>
+    esp_err_t modify(typename F::value_type value, typename Fs::value_type... values)
+    {
+        return modify_until<F, Fs...>(value, values..., i2cbus_deadline(bus_.time_out));
+    }
+
+private:
+    i2cbus_t bus_{};
+};
+
+} // namespace i2cbus
+
+/**@}*/
@@ -0,0 +1,412 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_coro.hpp
+ * @defgroup i2cbus_coro i2cbus_coro
+ * @ingroup i2cbus
+ * @{
+ *
+ * @brief C++20 coroutine front end of i2cbus.
+ * 
+ * Transactions are posted to the port submission ring of i2cbus_queue and the 
+ * awaiting coroutine is suspended; the port worker runs the transaction and 
+ * its completion callback hands the coroutine back to an Executor, which 
+ * resumes it from its own task. One task can this way keep transactions of 
+ * several devices and ports in flight, each coroutine costing a small frame 
+ * allocated at spawn instead of a task stack.
+ * 
+ * @code{.cpp}
+ * i2cbus::Task poll_sensor(i2cbus_t *dev)
+ * {
+ *     uint8_t reg = 0x3B, data[6];
+ *     while (true) {
+ *         esp_err_t res = co_await i2cbus::read_reg(dev, &reg, 1, data, sizeof(data));
+ *         ...
+ *     }
+ * }
+ * 
+ * i2cbus::Executor executor;
+ * executor.init();
+ * executor.spawn(poll_sensor(&sensor1));
+ * executor.spawn(poll_sensor(&sensor2));
+ * executor.run();
+ * @endcode
+ * 
+ * @note Coroutines of one executor only run in the task calling run(), so they 
+ *       need no locking among themselves. Build with exceptions disabled is 
+ *       supported, frame allocation failures give an empty Task.
+ */
+#pragma once
+
+#include <coroutine>
+#include <cstdlib>
+#include <new>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "i2cbus.hpp"
+#include "i2cbus_queue.h"
+
+namespace i2cbus {
+
+class Executor;
+
+/**
+ * @brief Coroutine run by an Executor, it returns nothing.
+ */
+class Task {
+public:
+    struct promise_type {
+        Executor *executor = nullptr;   /*!< Executor resuming coroutine */
+
+        static void *operator new(size_t size) noexcept
+        {
+            return std::malloc(size);
+        }
+
+        static void operator delete(void *ptr) noexcept
+        {
+            std::free(ptr);
+        }
+
+        static Task get_return_object_on_allocation_failure() noexcept
+        {
+            return Task{};
+        }
+
+        Task get_return_object() noexcept
+        {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept;
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::abort();
+        }
+    };
+
+    Task() noexcept = default;
+
+    Task(Task &&other) noexcept : handle_(other.handle_)
+    {
+        other.handle_ = nullptr;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        // never spawned.
+        if (handle_)
+            handle_.destroy();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return static_cast<bool>(handle_);
+    }
+
+private:
+    friend class Executor;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief Runs coroutines in the calling task, resuming them on completions.
+ */
+class Executor {
+public:
+    Executor() noexcept = default;
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    ~Executor()
+    {
+        if (ready_)
+            vQueueDelete(ready_);
+    }
+
+    /**
+     * @brief Create the ready queue.
+     * 
+     * @param depth maximum coroutines alive at once.
+     *
+     * @return 
+     *     - ESP_OK: success.
+     *     - ESP_ERR_NO_MEM: fail to create queue.
+     */
+    esp_err_t init(size_t depth = I2CBUS_QUEUE_SIZE)
+    {
+        ready_ = xQueueCreate(depth, sizeof(void *));
+        depth_ = depth;
+        return ready_ ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+
+    /**
+     * @brief Hand a coroutine to the executor, it starts on next run().
+     *
+     * @return 
+     *     - ESP_OK: success.
+     *     - ESP_ERR_INVALID_ARG: empty task, frame allocation failed.
+     *     - ESP_ERR_NO_MEM: executor already has depth coroutines.
+     */
+    esp_err_t spawn(Task &&task)
+    {
+        if (!task)
+            return ESP_ERR_INVALID_ARG;
+        if (alive_ >= depth_)
+            return ESP_ERR_NO_MEM;
+
+        auto handle = task.handle_;
+        task.handle_ = nullptr;
+        handle.promise().executor = this;
+        alive_++;
+        post(handle);
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Resume coroutines as they become ready until all have finished.
+     */
+    void run()
+    {
+        while (alive_) {
+            void *addr;
+            if (xQueueReceive(ready_, &addr, portMAX_DELAY) == pdTRUE)
+                std::coroutine_handle<>::from_address(addr).resume();
+        }
+    }
+
+    /**
+     * @brief Queue a suspended coroutine for resumption, callable from any task.
+     */
+    void post(std::coroutine_handle<> handle) noexcept
+    {
+        void *addr = handle.address();
+        // one slot per live coroutine, each waits for one thing at a time.
+        xQueueSend(ready_, &addr, portMAX_DELAY);
+    }
+
+    /**
+     * @brief Coroutines spawned and not finished.
+     */
+    size_t alive() const noexcept
+    {
+        return alive_;
+    }
+
+private:
+    friend class Task;
+
+    QueueHandle_t ready_ = nullptr;
+    size_t depth_ = 0;
+    size_t alive_ = 0;
+};
+
+inline auto Task::promise_type::final_suspend() noexcept
+{
+    struct Finish {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+        {
+            // runs in executor task, frame is freed here.
+            handle.promise().executor->alive_--;
+            handle.destroy();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+    return Finish{};
+}
+
+/**
+ * @brief Awaitable transaction, resumes with its esp_err_t result.
+ */
+class XferAwaiter {
+public:
+    XferAwaiter(i2cbus_t *dev, i2cbus_xfer_op_t op, uint8_t *reg, size_t reg_size, uint8_t *data, 
+                size_t data_size) noexcept
+    {
+        xfer_.dev = dev;
+        xfer_.op = op;
+        xfer_.reg = reg;
+        xfer_.reg_size = reg_size;
+        xfer_.data = data;
+        xfer_.data_size = data_size;
+        xfer_.done = &XferAwaiter::complete;
+        xfer_.arg = this;
+    }
+
+    XferAwaiter(const XferAwaiter &) = delete;
+    XferAwaiter &operator=(const XferAwaiter &) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<Task::promise_type> handle) noexcept
+    {
+        executor_ = handle.promise().executor;
+        handle_ = handle;
+
+        esp_err_t res = i2cbus_submit(&xfer_);
+        // port worker is started on first use.
+        if ((res == ESP_ERR_INVALID_STATE) && xfer_.dev && (i2cbus_queue_start(xfer_.dev->port) == ESP_OK))
+            res = i2cbus_submit(&xfer_);
+
+        if (res != ESP_OK) {
+            xfer_.res = res;
+            return false;
+        }
+        return true;
+    }
+
+    esp_err_t await_resume() const noexcept
+    {
+        return xfer_.res;
+    }
+
+protected:
+    void buffers(uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size) noexcept
+    {
+        xfer_.reg = reg;
+        xfer_.reg_size = reg_size;
+        xfer_.data = data;
+        xfer_.data_size = data_size;
+    }
+
+    i2cbus_xfer_t xfer_{};
+
+private:
+    static void complete(i2cbus_xfer_t *xfer, void *arg)
+    {
+        auto self = static_cast<XferAwaiter *>(arg);
+        self->executor_->post(self->handle_);
+    }
+
+    Executor *executor_ = nullptr;
+    std::coroutine_handle<> handle_;
+};
+
+/**
+ * @brief Awaitable register read, see i2cbus_read_reg().
+ */
+inline XferAwaiter read_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size) noexcept
+{
+    return XferAwaiter(dev, I2CBUS_XFER_READ, reg, reg_size, data, data_size);
+}
+
+/**
+ * @brief Awaitable register write, see i2cbus_write_reg().
+ */
+inline XferAwaiter write_reg(i2cbus_t *dev, uint8_t *reg, size_t reg_size, uint8_t *data, size_t data_size) noexcept
+{
+    return XferAwaiter(dev, I2CBUS_XFER_WRITE, reg, reg_size, data, data_size);
+}
+
+/**
+ * @brief Awaitable typed register read of a Device, buffers live in the awaiter.
+ */
+template <typename Reg>
+class RegReadAwaiter : public XferAwaiter {
+    static_assert(Reg::readable, "register is write-only");
+
+public:
+    RegReadAwaiter(i2cbus_t *dev, typename Reg::value_type &value) noexcept 
+        : XferAwaiter(dev, I2CBUS_XFER_READ, nullptr, 0, nullptr, 0), value_(value)
+    {
+        buffers(reg_.data(), reg_.size(), buf_.data(), buf_.size());
+    }
+
+    esp_err_t await_resume() const noexcept
+    {
+        if (xfer_.res == ESP_OK)
+            value_ = Reg::decode(buf_);
+        return xfer_.res;
+    }
+
+private:
+    std::array<uint8_t, Reg::addr_bytes.size()> reg_ = Reg::addr_bytes;
+    std::array<uint8_t, Reg::width> buf_{};
+    typename Reg::value_type &value_;
+};
+
+/**
+ * @brief Awaitable typed register write of a Device, buffers live in the awaiter.
+ */
+template <typename Reg>
+class RegWriteAwaiter : public XferAwaiter {
+    static_assert(Reg::writable, "register is read-only");
+
+public:
+    RegWriteAwaiter(i2cbus_t *dev, typename Reg::value_type value) noexcept 
+        : XferAwaiter(dev, I2CBUS_XFER_WRITE, nullptr, 0, nullptr, 0), buf_(Reg::encode(value))
+    {
+        buffers(reg_.data(), reg_.size(), buf_.data(), buf_.size());
+    }
+
+private:
+    std::array<uint8_t, Reg::addr_bytes.size()> reg_ = Reg::addr_bytes;
+    std::array<uint8_t, Reg::width> buf_;
+};
+
+template <typename Reg, i2c_port_t Port, uint8_t Addr>
+RegReadAwaiter<Reg> read(Device<Port, Addr> &dev, typename Reg::value_type &value) noexcept
+{
+    return RegReadAwaiter<Reg>(dev.bus(), value);
+}
+
+template <typename Reg, i2c_port_t Port, uint8_t Addr>
+RegWriteAwaiter<Reg> write(Device<Port, Addr> &dev, typename Reg::value_type value) noexcept
+{
+    return RegWriteAwaiter<Reg>(dev.bus(), value);
+}
+
+} // namespace i2cbus
+
+/**@}*/
@@ -0,0 +1,200 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_queue.h
+ * @defgroup i2cbus_queue i2cbus_queue
+ * @{
+ *
+ * @brief Transaction submission from interrupts and tasks.
+ * 
+ * Transactions are described in caller owned i2cbus_xfer_t slots and posted 
+ * to a lock-free ring of their port, which takes no mutex and allocates no 
+ * memory, so it can be used from an interrupt. A worker task per port drains 
+ * the ring, runs each transaction and notifies the task waiting for it.
+ * 
+ * Streamed reads ride on the worker too: it reads the next chunk while the 
+ * calling task consumes the previous one.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2CBUS_QUEUE_SIZE   CONFIG_I2CBUS_QUEUE_SIZE    /*!< Submission ring slots per port */
+
+typedef enum {
+    I2CBUS_XFER_WRITE = 0,      /*!< i2cbus_write_reg() transaction */
+    I2CBUS_XFER_READ,           /*!< i2cbus_read_reg() transaction */
+    I2CBUS_XFER_STREAM          /*!< i2cbus_read_stream() transfer, posted by it only */
+} i2cbus_xfer_op_t;
+
+typedef struct i2cbus_xfer i2cbus_xfer_t;
+
+/**
+ * @brief Called from the port worker once a transaction completes, it must not block.
+ */
+typedef void (*i2cbus_xfer_cb_t)(i2cbus_xfer_t *xfer, void *arg);
+
+/**
+ * @brief Receives each chunk of a streamed read, other than ESP_OK stops it.
+ */
+typedef esp_err_t (*i2cbus_stream_cb_t)(size_t offset, const uint8_t *data, size_t size, void *arg);
+
+struct i2cbus_xfer
+{
+    i2cbus_t *dev;              /*!< Device to access */
+    i2cbus_xfer_op_t op;        /*!< Write or read */
+    uint8_t *reg;               /*!< Register address, may be NULL */
+    size_t reg_size;            /*!< sizeof register */
+    uint8_t *data;              /*!< Data to write or read buffer */
+    size_t data_size;           /*!< sizeof data */
+    TaskHandle_t notify;        /*!< Task notified on completion, may be NULL */
+    i2cbus_xfer_cb_t done;      /*!< Completion callback, may be NULL */
+    void *arg;                  /*!< Completion callback argument */
+    volatile esp_err_t res;     /*!< Result, ESP_ERR_NOT_FINISHED while pending */
+};
+
+
+/**
+ * @brief Start the submission worker of a port.
+ * 
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success, or worker already running.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to create worker task.
+ */
+esp_err_t i2cbus_queue_start(i2c_port_t i2c_port);
+
+
+/**
+ * @brief Post a transaction from a task.
+ * 
+ * @note The slot must stay untouched until xfer->res is no longer 
+ *       ESP_ERR_NOT_FINISHED, or until its completion callback is called.
+ * 
+ * @param xfer pointer to transaction slot.
+ *
+ * @return 
+ *     - ESP_OK: transaction queued.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: port worker not started or slot still pending.
+ *     - ESP_ERR_NO_MEM: submission ring is full.
+ */
+esp_err_t i2cbus_submit(i2cbus_xfer_t *xfer);
+
+
+/**
+ * @brief Post a transaction from an interrupt.
+ * 
+ * @param xfer pointer to transaction slot.
+ * @param woken set to pdTRUE when a context switch should be requested at 
+ *              interrupt exit.
+ *
+ * @return same as i2cbus_submit().
+ */
+esp_err_t i2cbus_submit_from_isr(i2cbus_xfer_t *xfer, BaseType_t *woken);
+
+
+/**
+ * @brief Wait until a transaction posted by the calling task completes.
+ * 
+ * @note Caller must be xfer->notify.
+ * 
+ * @param xfer pointer to transaction slot.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return transaction result, or ESP_ERR_TIMEOUT if it is still pending.
+ */
+esp_err_t i2cbus_xfer_wait(i2cbus_xfer_t *xfer, TickType_t deadline);
+
+
+/**
+ * @brief Read a long region through two ping-pong halves of a caller buffer.
+ * 
+ * The port worker, started if needed, fills one half while the callback 
+ * runs on the calling task with the other, so RAM stays bounded by the 
+ * buffer and the bus keeps busy while chunks are consumed.
+ * 
+ * Without hold, each chunk is a transaction of its own that selects reg 
+ * again, as a sensor FIFO data register wants, and other tasks may use the 
+ * port between chunks. With hold, the region is one read transaction split 
+ * in chunks, for devices that stream on from an address pointer, and the 
+ * port stays locked until it ends.
+ * 
+ * @note Other transactions posted to the port wait for the stream to end.
+ * 
+ * @param dev pointer to device.
+ * @param reg pointer to register address, may be NULL.
+ * @param reg_size sizeof register.
+ * @param size number of bytes to read.
+ * @param buf ping-pong buffer, a chunk is half of it.
+ * @param buf_size sizeof buffer, at least 2.
+ * @param hold keep the port locked and read the region as one transaction.
+ * @param cb called with each chunk.
+ * @param arg callback argument.
+ * @param deadline absolute deadline from i2cbus_deadline() for the whole stream.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to start port worker, or submission ring is full.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to read, device not found.
+ *     - other: the callback result that stopped it.
+ */
+esp_err_t i2cbus_read_stream_until(i2cbus_t *dev, uint8_t *reg, size_t reg_size, size_t size, uint8_t *buf, 
+                                   size_t buf_size, bool hold, i2cbus_stream_cb_t cb, void *arg, TickType_t deadline);
+
+
+/**
+ * @brief Read a long region through two ping-pong halves of a caller buffer,
+ * each chunk gets the device timeout.
+ * 
+ * @param dev pointer to device.
+ * @param reg pointer to register address, may be NULL.
+ * @param reg_size sizeof register.
+ * @param size number of bytes to read.
+ * @param buf ping-pong buffer, a chunk is half of it.
+ * @param buf_size sizeof buffer, at least 2.
+ * @param hold keep the port locked and read the region as one transaction.
+ * @param cb called with each chunk.
+ * @param arg callback argument.
+ *
+ * @return see i2cbus_read_stream_until().
+ */
+esp_err_t i2cbus_read_stream(i2cbus_t *dev, uint8_t *reg, size_t reg_size, size_t size, uint8_t *buf, 
+                             size_t buf_size, bool hold, i2cbus_stream_cb_t cb, void *arg);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,182 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_slave.h
+ * @defgroup i2cbus_slave i2cbus_slave
+ * @ingroup i2cbus
+ * @{
+ *
+ * @brief I2C slave engine emulating a register map.
+ * 
+ * A master write starts with a register pointer, any following bytes are 
+ * register writes: they go to the map with auto-increment and are handed to 
+ * the application. A write of the pointer alone arms a read: a window of the 
+ * map from the pointer is queued on the driver TX ring for the master to read 
+ * next. A write of registers arms nothing, the master writes the pointer again 
+ * to read them back.
+ * 
+ * Application updates are staged and published with i2cbus_slave_commit(); 
+ * the engine serves reads from its own copy of the map and picks the latest 
+ * committed one when it arms a read, so a master read never sees half of an 
+ * update and the application never waits for the bus.
+ * 
+ * @note The legacy slave driver reports neither address match nor stop, so 
+ *       the engine frames master writes by the silence after their last byte, 
+ *       one driver FIFO batch at CONFIG_I2C_MASTER_FREQ rounded up to ticks. A 
+ *       master must leave I2CBUS_SLAVE_FRAME_GAP_US between a write and the 
+ *       next one, a register read is a pointer write with a stop then a read, 
+ *       a repeated start is not supported. The driver TX ring can not be 
+ *       flushed, so it is sized to one window: bytes a master leaves unread 
+ *       come first on its next read and the window armed behind them is cut 
+ *       short, as counted in tx_short.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2CBUS_SLAVE_FIFO_BATCH     28      /*!< Bytes the driver moves from RX FIFO at a time */
+#define I2CBUS_SLAVE_BATCH_US       (((I2CBUS_SLAVE_FIFO_BATCH + 2) * 9 * 1000000ULL) / I2C_MASTER_FREQ)
+#define I2CBUS_SLAVE_GAP_TICKS      ((TickType_t)(I2CBUS_SLAVE_BATCH_US / (portTICK_PERIOD_MS * 1000ULL)) + 2)
+#define I2CBUS_SLAVE_FRAME_GAP_US   (I2CBUS_SLAVE_BATCH_US + (I2CBUS_SLAVE_GAP_TICKS * portTICK_PERIOD_MS * 1000ULL))
+
+/**
+ * @brief Called from the engine task for each master write of registers, 
+ *        after they went to the map.
+ */
+typedef void (*i2cbus_slave_write_cb_t)(uint8_t reg, const uint8_t *data, size_t size, void *arg);
+
+typedef struct
+{
+    uint16_t addr;                      /*!< Own 7-bit address */
+    size_t map_size;                    /*!< Register map size, 1 to 256 */
+    size_t read_window;                 /*!< Bytes armed per read, 0 up to map end */
+    size_t rx_buf_size;                 /*!< Driver RX ring, 0 for CONFIG_I2CBUS_SLAVE_RX_BUF */
+    size_t tx_buf_size;                 /*!< Driver TX ring, 0 or more for one read window */
+    i2cbus_slave_write_cb_t on_write;   /*!< Register writes, NULL to ignore them */
+    void *arg;                          /*!< Write callback argument */
+} i2cbus_slave_config_t;
+
+typedef struct
+{
+    int64_t elapsed_us;                 /*!< Time covered by statistics */
+    uint32_t writes;                    /*!< Master writes carrying registers */
+    uint32_t reads;                     /*!< Read windows armed */
+    uint32_t commits;                   /*!< Map updates published */
+    uint32_t tx_short;                  /*!< Reads armed partially, TX ring full */
+    uint64_t rx_bytes;                  /*!< Bytes received, pointers included */
+    uint64_t tx_bytes;                  /*!< Bytes queued for master reads */
+    uint32_t rx_rate;                   /*!< Bytes received per second */
+    uint32_t tx_rate;                   /*!< Bytes queued per second */
+} i2cbus_slave_stats_t;
+
+typedef struct
+{
+    i2c_port_t port;                    /*!< Slave port */
+    i2cbus_slave_config_t config;       /*!< Configuration */
+    uint8_t *map[3];                    /*!< Map copies: engine, latest committed and staging */
+    uint8_t front;                      /*!< Copy served by engine */
+    uint8_t ready;                      /*!< Latest committed copy */
+    uint8_t back;                       /*!< Copy staged by application */
+    bool fresh;                         /*!< Committed copy not picked by engine yet */
+    uint8_t *rx;                        /*!< Engine receive buffer */
+    uint8_t pointer;                    /*!< Register pointer */
+    i2cbus_slave_stats_t stats;         /*!< Statistics */
+    int64_t stats_us;                   /*!< Statistics start */
+    TaskHandle_t task;                  /*!< Engine task */
+    portMUX_TYPE lock;                  /*!< Guards map copies swap */
+} i2cbus_slave_t;
+
+
+/**
+ * @brief Install a port as slave and start its engine.
+ * 
+ * @param slave slave storage, it must live while port is in use.
+ * @param i2c_port I2C port number lesser than I2C_NUM_MAX, not used by i2cbus_init().
+ * @param i2c_sda GPIO number for I2C SDA signal.
+ * @param i2c_scl GPIO number for I2C SCL signal.
+ * @param config slave configuration.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to allocate map or engine task.
+ *     - ESP_FAIL: fail to install driver.
+ */
+esp_err_t i2cbus_slave_init(i2cbus_slave_t *slave, i2c_port_t i2c_port, gpio_num_t i2c_sda, gpio_num_t i2c_scl, 
+                            const i2cbus_slave_config_t *config);
+
+
+/**
+ * @brief Stage registers for the next commit.
+ * 
+ * @note Staging and commit must be done from one task at a time.
+ * 
+ * @param slave pointer to slave.
+ * @param reg first register.
+ * @param data register values.
+ * @param size number of registers, up to map end.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument or registers out of map.
+ */
+esp_err_t i2cbus_slave_set(i2cbus_slave_t *slave, uint8_t reg, const uint8_t *data, size_t size);
+
+
+/**
+ * @brief Publish staged registers as one update.
+ * 
+ * @param slave pointer to slave.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t i2cbus_slave_commit(i2cbus_slave_t *slave);
+
+
+/**
+ * @brief Get slave statistics, achieved throughput included.
+ * 
+ * @param slave pointer to slave.
+ * @param stats receives statistics.
+ * @param reset start a new statistics period.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t i2cbus_slave_get_stats(i2cbus_slave_t *slave, i2cbus_slave_stats_t *stats, bool reset);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,329 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_poll.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "i2cbus_poll.h"
+
+// LOCAL CONST
+#define I2CBUS_POLL_TASK_PRIORITY   CONFIG_I2CBUS_POLL_TASK_PRIORITY
+#define I2CBUS_POLL_TASK_STACK      CONFIG_I2CBUS_POLL_TASK_STACK
+#define I2CBUS_POLL_COALESCE_US     CONFIG_I2CBUS_POLL_COALESCE_US
+#define I2CBUS_POLL_OVERHEAD_US     CONFIG_I2CBUS_POLL_OVERHEAD_US
+#define I2CBUS_POLL_SPIN_US         20      /*!< Longest gap between jobs waited out holding the port */
+
+static const char *TAG = "i2cbus_poll";
+
+typedef struct {
+    SemaphoreHandle_t mutex;    /*!< Guards port timeline */
+    TaskHandle_t worker;        /*!< Task running jobs of port */
+    esp_timer_handle_t timer;   /*!< Wakes worker at next due time */
+    int64_t epoch_us;           /*!< Time origin of job phases */
+    i2cbus_poll_job_t *jobs;    /*!< Timeline, sorted by next due time */
+} i2cbus_poll_port_t;
+
+static i2cbus_poll_port_t poll_port[I2C_NUM_MAX];
+static portMUX_TYPE poll_port_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void _poll_insert(i2cbus_poll_port_t *pp, i2cbus_poll_job_t *job)
+{
+    i2cbus_poll_job_t **it = &pp->jobs;
+
+    // keep timeline sorted, jobs due at same time run in insertion order.
+    while (*it && ((*it)->next_us <= job->next_us))
+        it = &(*it)->next;
+
+    job->next = *it;
+    *it = job;
+}
+
+static void _poll_run(i2cbus_poll_job_t *job)
+{
+    // read straight into the FIFO slot, the producer never waits for readers.
+    uint8_t *data = sample_fifo_claim(job->fifo);
+    int64_t timestamp = esp_timer_get_time();
+
+    if (i2cbus_read_reg_until(job->dev, job->reg_size ? job->reg : NULL, job->reg_size, data, 
+                              job->fifo->sample_size, i2cbus_deadline(job->dev->time_out)) != ESP_OK) {
+        job->errors++;
+        return;
+    }
+
+    sample_fifo_publish(job->fifo, timestamp);
+}
+
+static void _poll_advance(i2cbus_poll_job_t *job, int64_t now)
+{
+    job->next_us += job->period_us;
+
+    // worker fell behind, skip whole periods to keep the phase.
+    if (job->next_us <= now) {
+        uint32_t skip = (uint32_t)((now - job->next_us) / job->period_us) + 1;
+        job->missed += skip;
+        job->next_us += (int64_t)skip * job->period_us;
+    }
+}
+
+// quotas of jobs due are paid before the port is taken, a job whose deadline 
+// expires first still runs and leaves its device in debt.
+static void _poll_prepay(i2cbus_poll_port_t *pp)
+{
+    int64_t due = esp_timer_get_time() + I2CBUS_POLL_SPIN_US;
+
+    for (i2cbus_poll_job_t *job = pp->jobs; job && (job->next_us <= due); job = job->next)
+        i2cbus_prepay_quota_until(job->dev, job->reg_size, job->fifo->sample_size, 
+                                  i2cbus_deadline(job->dev->time_out));
+}
+
+static void _poll_timer_cb(void *arg)
+{
+    xTaskNotifyGive(((i2cbus_poll_port_t *)arg)->worker);
+}
+
+static void _poll_worker(void *arg)
+{
+    i2c_port_t port = (i2c_port_t)(intptr_t)arg;
+    i2cbus_poll_port_t *pp = &poll_port[port];
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(pp->mutex, portMAX_DELAY);
+
+        // run jobs due back-to-back on a single port lock, for at most the 
+        // coalescing window. Only short gaps are waited out holding the port, a 
+        // longer one ends the batch and the timer wakes worker for the next.
+        if (pp->jobs && (pp->jobs->next_us <= (esp_timer_get_time() + I2CBUS_POLL_SPIN_US))) {
+            _poll_prepay(pp);
+            if (i2cbus_lock(port, i2cbus_deadline(I2C_TIMEOUT)) == ESP_OK) {
+                int64_t now = esp_timer_get_time();
+                int64_t end = now + I2CBUS_POLL_COALESCE_US;
+
+                while (pp->jobs && (pp->jobs->next_us <= end) && 
+                       (pp->jobs->next_us <= (now + I2CBUS_POLL_SPIN_US))) {
+                    i2cbus_poll_job_t *job = pp->jobs;
+                    pp->jobs = job->next;
+
+                    while (now < job->next_us)
+                        now = esp_timer_get_time();
+
+                    _poll_run(job);
+                    now = esp_timer_get_time();
+                    _poll_advance(job, now);
+                    _poll_insert(pp, job);
+                }
+                i2cbus_unlock(port);
+            } else {
+                ESP_LOGE(TAG, "port %d is busy", port);
+            }
+        }
+
+        // sleep until next job is due.
+        if (pp->jobs) {
+            int64_t wait = pp->jobs->next_us - esp_timer_get_time();
+            esp_timer_stop(pp->timer);
+            esp_timer_start_once(pp->timer, (wait > 0) ? wait : 1);
+        }
+
+        xSemaphoreGive(pp->mutex);
+    }
+}
+
+static esp_err_t _poll_port_start(i2c_port_t port)
+{
+    i2cbus_poll_port_t *pp = &poll_port[port];
+
+    // create port mutex once, a racing task drops its own copy.
+    if (pp->mutex == NULL) {
+        SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+        if (mutex == NULL)
+            return ESP_ERR_NO_MEM;
+
+        portENTER_CRITICAL(&poll_port_lock);
+        if (pp->mutex == NULL) {
+            pp->mutex = mutex;
+            mutex = NULL;
+        }
+        portEXIT_CRITICAL(&poll_port_lock);
+
+        if (mutex != NULL)
+            vSemaphoreDelete(mutex);
+    }
+
+    esp_err_t res = ESP_OK;
+    xSemaphoreTake(pp->mutex, portMAX_DELAY);
+
+    if (pp->worker == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = _poll_timer_cb,
+            .arg = pp,
+            .name = "i2cbus_poll",
+        };
+
+        // worker needs its timer, neither is left behind without the other.
+        if (esp_timer_create(&args, &pp->timer) != ESP_OK) {
+            pp->timer = NULL;
+            res = ESP_ERR_NO_MEM;
+        } else if (xTaskCreate(_poll_worker, "i2cbus_poll", I2CBUS_POLL_TASK_STACK, (void *)(intptr_t)port, 
+                               I2CBUS_POLL_TASK_PRIORITY, &pp->worker) != pdPASS) {
+            esp_timer_delete(pp->timer);
+            pp->timer = NULL;
+            pp->worker = NULL;
+            res = ESP_ERR_NO_MEM;
+        } else {
+            pp->epoch_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "worker started on port %d", port);
+        }
+    }
+
+    xSemaphoreGive(pp->mutex);
+    return res;
+}
+
+esp_err_t i2cbus_poll_job_init(i2cbus_poll_job_t *job, i2cbus_t *dev, uint8_t *reg, size_t reg_size, 
+                               uint32_t period_us, uint32_t phase_us, sample_fifo_t *fifo)
+{
+    if (!job || !dev || !fifo || !period_us)
+        return ESP_ERR_INVALID_ARG;
+
+    if ((reg_size > I2CBUS_POLL_REG_MAX) || (reg_size && !reg))
+        return ESP_ERR_INVALID_ARG;
+
+    if ((phase_us != I2CBUS_POLL_PHASE_AUTO) && (phase_us >= period_us))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(job, 0, sizeof(i2cbus_poll_job_t));
+    job->dev = dev;
+    if (reg_size)
+        memcpy(job->reg, reg, reg_size);
+    job->reg_size = reg_size;
+    job->data_size = fifo->sample_size;
+    job->period_us = period_us;
+    job->phase_us = phase_us;
+    job->cost_us = i2cbus_wire_time_us(dev->port, reg_size, fifo->sample_size) + I2CBUS_POLL_OVERHEAD_US;
+    job->fifo = fifo;
+
+    return sample_fifo_reader_init(&job->reader, fifo);
+}
+
+esp_err_t i2cbus_poll_add(i2cbus_poll_job_t *job)
+{
+    if (!job || !job->dev || (job->dev->port >= I2C_NUM_MAX) || !job->period_us)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = _poll_port_start(job->dev->port);
+    if (res != ESP_OK)
+        return res;
+
+    i2cbus_poll_port_t *pp = &poll_port[job->dev->port];
+    xSemaphoreTake(pp->mutex, portMAX_DELAY);
+
+    // pack job right after the bus windows of jobs already on the timeline.
+    if (job->phase_us == I2CBUS_POLL_PHASE_AUTO) {
+        uint32_t phase = 0;
+        for (i2cbus_poll_job_t *it = pp->jobs; it; it = it->next) {
+            if ((it->phase_us + it->cost_us) > phase)
+                phase = it->phase_us + it->cost_us;
+        }
+        job->phase_us = phase % job->period_us;
+    }
+
+    // first due time is the next one of its phase on port timeline.
+    int64_t now = esp_timer_get_time();
+    job->next_us = pp->epoch_us + job->phase_us;
+    if (job->next_us <= now)
+        job->next_us += (((now - job->next_us) / job->period_us) + 1) * (int64_t)job->period_us;
+
+    _poll_insert(pp, job);
+
+    xSemaphoreGive(pp->mutex);
+
+    // let worker re-arm its timer for the new timeline head.
+    xTaskNotifyGive(pp->worker);
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_poll_remove(i2cbus_poll_job_t *job)
+{
+    if (!job || !job->dev || (job->dev->port >= I2C_NUM_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    i2cbus_poll_port_t *pp = &poll_port[job->dev->port];
+    if (pp->mutex == NULL)
+        return ESP_ERR_NOT_FOUND;
+
+    esp_err_t res = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(pp->mutex, portMAX_DELAY);
+
+    for (i2cbus_poll_job_t **it = &pp->jobs; *it; it = &(*it)->next) {
+        if (*it == job) {
+            *it = job->next;
+            job->next = NULL;
+            res = ESP_OK;
+            break;
+        }
+    }
+
+    xSemaphoreGive(pp->mutex);
+    return res;
+}
+
+size_t i2cbus_poll_drain(i2cbus_poll_job_t *job, int64_t *timestamps, uint8_t *data, size_t max)
+{
+    if (!job || !job->fifo)
+        return 0;
+
+    size_t n = 0;
+
+    // a batch stops at ring wrap, keep going until caller buffer is full.
+    while (n < max) {
+        const sample_fifo_sample_t *first;
+        size_t count = sample_fifo_peek(&job->reader, &first, max - n);
+        if (!count)
+            break;
+
+        for (size_t i = 0; i < count; i++) {
+            const sample_fifo_sample_t *sample = SAMPLE_FIFO_AT(job->fifo, first, i);
+            if (timestamps)
+                timestamps[n + i] = sample->timestamp;
+            if (data)
+                memcpy(data + ((n + i) * job->data_size), sample->data, job->data_size);
+        }
+
+        // samples overwritten while they were copied are dropped.
+        if (sample_fifo_commit(&job->reader, count) == ESP_OK)
+            n += count;
+    }
+
+    return n;
+}
@@ -0,0 +1,136 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file i2cbus_poll.h
+ * @defgroup i2cbus_poll i2cbus_poll
+ * @{
+ *
+ * @brief Periodic polling scheduler for devices on i2cbus.
+ * 
+ * Every port gets one worker task that runs the registered read jobs on a 
+ * shared timeline, so polled devices never contend for the port mutex with 
+ * each other. Jobs due close together are run back-to-back on a single port 
+ * lock and each sample is published with its esp_timer timestamp in the job 
+ * sample_fifo, where any number of readers drain it in batches.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+#include "sample_fifo.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2CBUS_POLL_REG_MAX     4           /*!< Maximum register address size of a job */
+#define I2CBUS_POLL_PHASE_AUTO  UINT32_MAX  /*!< Place job right after the jobs already on the timeline */
+
+typedef struct i2cbus_poll_job
+{
+    i2cbus_t *dev;                      /*!< Device to read */
+    uint8_t reg[I2CBUS_POLL_REG_MAX];   /*!< Register address to read */
+    size_t reg_size;                    /*!< sizeof register */
+    size_t data_size;                   /*!< Bytes read on each sample */
+    uint32_t period_us;                 /*!< Sampling period */
+    uint32_t phase_us;                  /*!< Offset of the first sample in period */
+    uint32_t cost_us;                   /*!< Estimated bus time of one sample */
+    int64_t next_us;                    /*!< Next due time */
+    sample_fifo_t *fifo;                /*!< Samples of job */
+    sample_fifo_reader_t reader;        /*!< Reader used by i2cbus_poll_drain() */
+    uint32_t errors;                    /*!< Failed reads */
+    uint32_t missed;                    /*!< Periods skipped when worker fell behind */
+    struct i2cbus_poll_job *next;       /*!< Next job on port timeline */
+} i2cbus_poll_job_t;
+
+
+/**
+ * @brief Set-up a polling job.
+ * 
+ * @param job pointer to job.
+ * @param dev device to read.
+ * @param reg register address to read, may be NULL.
+ * @param reg_size sizeof register, up to I2CBUS_POLL_REG_MAX.
+ * @param period_us sampling period in microseconds.
+ * @param phase_us offset of first sample within period, or I2CBUS_POLL_PHASE_AUTO.
+ * @param fifo FIFO receiving samples, each read is fifo->sample_size bytes.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t i2cbus_poll_job_init(i2cbus_poll_job_t *job, i2cbus_t *dev, uint8_t *reg, size_t reg_size, 
+                               uint32_t period_us, uint32_t phase_us, sample_fifo_t *fifo);
+
+
+/**
+ * @brief Put a job on the timeline of its device port.
+ * 
+ * @note The port worker is started on first job added to a port.
+ * 
+ * @param job pointer to job set-up by i2cbus_poll_job_init().
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NO_MEM: fail to start port worker.
+ */
+esp_err_t i2cbus_poll_add(i2cbus_poll_job_t *job);
+
+
+/**
+ * @brief Take a job out of its port timeline.
+ * 
+ * @param job pointer to job.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NOT_FOUND: job is not on timeline.
+ */
+esp_err_t i2cbus_poll_remove(i2cbus_poll_job_t *job);
+
+
+/**
+ * @brief Drain samples of a job into caller buffers.
+ * 
+ * @note It copies samples through the job own reader, consumers that want to 
+ *       use them in place attach their own sample_fifo_reader_t to job fifo.
+ * 
+ * @param job pointer to job.
+ * @param timestamps array receiving esp_timer timestamp of each sample, may be NULL.
+ * @param data buffer receiving max * data_size bytes of samples.
+ * @param max maximum number of samples to drain.
+ *
+ * @return number of samples drained, samples overwritten while being copied 
+ *         are left out and counted in job->reader.overruns.
+ */
+size_t i2cbus_poll_drain(i2cbus_poll_job_t *job, int64_t *timestamps, uint8_t *data, size_t max);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
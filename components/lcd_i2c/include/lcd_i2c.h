@@ -31,13 +31,19 @@
  */
 #pragma once
 
+#include <stdarg.h>
 #include "esp_err.h"
 #include "i2cbus.h"
+#include "pcf8574.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define LCD_I2C_GLYPHS      8   /*!< Custom glyph slots in CGRAM */
+#define LCD_I2C_GLYPH_ROWS  8   /*!< Rows of a glyph, 5 low bits each */
+#define LCD_I2C_GLYPH(slot) ((char)(0x08 + (slot)))     /*!< Character of a glyph slot, safe in strings */
+
 typedef enum{
     LCD_CURSOR_INVISIBLE = 0,   /*!< */
     LCD_CURSOR_UNDERSCORE,  /*!< */
@@ -50,6 +56,12 @@ typedef enum{
     LCD_SHIFT_RIGHT /*!< */
 } lcd_i2c_shift_display_t;
 
+typedef enum{
+    LCD_ALIGN_RIGHT = 0,    /*!< Pad with spaces before the value */
+    LCD_ALIGN_LEFT,         /*!< Pad with spaces after the value */
+    LCD_ALIGN_ZERO          /*!< Pad with zeros between sign and digits */
+} lcd_i2c_align_t;
+
 typedef enum{
     LCD_1602 = 0,   /*!< */
     LCD_2004    /*!< */
@@ -57,25 +69,49 @@ typedef enum{
 
 typedef struct
 {
-    i2cbus_t bus;   /*!< */
+    pcf8574_t pcf;  /*!< Expander driving display lines */
     lcd_type_t type;    /*!< */
     bool backlight; /*!< */
     bool started;   /*!< */
+    const uint8_t (*glyphs)[LCD_I2C_GLYPH_ROWS];    /*!< Widget glyph set in CGRAM, NULL if none */
 } lcd_i2c_t;
 
 /**
  * @brief Create a new lcd on i2c bus.
  * 
+ * Bus accesses get I2C_TIMEOUT, on top of the some 27 ms of power-on and 
+ * reset waits.
+ * 
  * @param lcd pointer to device configurations.
  * @param port I2C port number lesser than I2C_NUM_MAX.
  * @param addr I2C address to access device on the bus.
  *
  * @return 
  *     - ESP_OK: success
+ *     - ESP_ERR_NOT_FOUND: a scan of port did not find display
  *     - ESP_FAIL: fail to start
  */
 esp_err_t lcd_i2c_init(lcd_i2c_t *lcd, i2c_port_t port, uint8_t addr, lcd_type_t lcd_type);
 
+/**
+ * @brief Create a new lcd on i2c bus before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param addr I2C address to access device on the bus.
+ * @param lcd_type display geometry.
+ * @param deadline absolute deadline for the whole reset sequence.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_ERR_NOT_FOUND: a scan of port did not find display
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_init_until(lcd_i2c_t *lcd, i2c_port_t port, uint8_t addr, lcd_type_t lcd_type, 
+                             TickType_t deadline);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -98,6 +134,21 @@ esp_err_t lcd_i2c_delete(lcd_i2c_t *lcd);
  */
 esp_err_t lcd_i2c_clear_display(lcd_i2c_t *lcd);
 
+/**
+ * @brief Clear display before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_clear_display_until(lcd_i2c_t *lcd, TickType_t deadline);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -109,6 +160,162 @@ esp_err_t lcd_i2c_clear_display(lcd_i2c_t *lcd);
  */
 esp_err_t lcd_i2c_write(lcd_i2c_t *lcd, const char *data);
 
+/**
+ * @brief Write a string at cursor position before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param data null terminated string to write.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_write_until(lcd_i2c_t *lcd, const char *data, TickType_t deadline);
+
+/**
+ * @brief Write an integer at cursor position in a fixed width field.
+ * 
+ * Digits are encoded straight into the expander writes, with no intermediate 
+ * string, and a field goes to the display in one transaction. A value wider 
+ * than its field fills the field with '#', so what follows on the line keeps 
+ * its place.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param value value to write.
+ * @param width field width in characters, 0 to fit the value.
+ * @param align alignment of the value in its field.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_write_int(lcd_i2c_t *lcd, int32_t value, uint8_t width, lcd_i2c_align_t align);
+
+/**
+ * @brief Write an integer at cursor position in a fixed width field before a 
+ *        deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param value value to write.
+ * @param width field width in characters, 0 to fit the value.
+ * @param align alignment of the value in its field.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_write_int_until(lcd_i2c_t *lcd, int32_t value, uint8_t width, lcd_i2c_align_t align, 
+                                  TickType_t deadline);
+
+/**
+ * @brief Write a fixed-point number at cursor position in a fixed width field.
+ * 
+ * The value is scaled by 10 to the power of decimals, 235 with one decimal 
+ * shows as 23.5 and -5 with two as -0.05. Field rules are the ones of 
+ * lcd_i2c_write_int().
+ * 
+ * @param lcd pointer to device configurations.
+ * @param value scaled value to write.
+ * @param decimals digits after the point, up to 9.
+ * @param width field width in characters, 0 to fit the value.
+ * @param align alignment of the value in its field.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_write_fixed(lcd_i2c_t *lcd, int32_t value, uint8_t decimals, uint8_t width, 
+                              lcd_i2c_align_t align);
+
+/**
+ * @brief Write a fixed-point number at cursor position in a fixed width field 
+ *        before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param value scaled value to write.
+ * @param decimals digits after the point, up to 9.
+ * @param width field width in characters, 0 to fit the value.
+ * @param align alignment of the value in its field.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_write_fixed_until(lcd_i2c_t *lcd, int32_t value, uint8_t decimals, uint8_t width, 
+                                    lcd_i2c_align_t align, TickType_t deadline);
+
+/**
+ * @brief Write formatted text at cursor position.
+ * 
+ * Supports %d, %i, %u, %x, %X, %c, %s and %%, with the '-' and '0' flags, a 
+ * width, a precision and the l length. Text is encoded straight into the 
+ * expander writes as it is formatted, with no heap and no intermediate string. 
+ * Unlike printf a width is fixed: a number wider than its field shows as '#' 
+ * and a string is cut at the field. Floating point is not supported, use 
+ * lcd_i2c_write_fixed() for scaled values.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param fmt format string.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_printf(lcd_i2c_t *lcd, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Write formatted text at cursor position before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ * @param fmt format string, as of lcd_i2c_printf().
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_printf_until(lcd_i2c_t *lcd, TickType_t deadline, const char *fmt, ...) 
+                               __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Write formatted text from a variable argument list at cursor position 
+ *        before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ * @param fmt format string, as of lcd_i2c_printf().
+ * @param args arguments of fmt.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_vprintf_until(lcd_i2c_t *lcd, TickType_t deadline, const char *fmt, va_list args);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -120,6 +327,22 @@ esp_err_t lcd_i2c_write(lcd_i2c_t *lcd, const char *data);
  */
 esp_err_t lcd_i2c_set_backlight(lcd_i2c_t *lcd, bool bkl_status);
 
+/**
+ * @brief Switch backlight before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param bkl_status backlight on when true.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_set_backlight_until(lcd_i2c_t *lcd, bool bkl_status, TickType_t deadline);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -131,6 +354,60 @@ esp_err_t lcd_i2c_set_backlight(lcd_i2c_t *lcd, bool bkl_status);
  */
 esp_err_t lcd_i2c_set_cursor(lcd_i2c_t *lcd, uint8_t col, uint8_t row);
 
+/**
+ * @brief Move cursor before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param col column starting at 0.
+ * @param row row starting at 0.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_set_cursor_until(lcd_i2c_t *lcd, uint8_t col, uint8_t row, TickType_t deadline);
+
+/**
+ * @brief Load a custom glyph into CGRAM.
+ * 
+ * The glyph shows wherever LCD_I2C_GLYPH(slot) is written, on screen already 
+ * too. Cursor moves to the first column of the first line. Widgets that use 
+ * the glyph slots load their glyph set again on their next update.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param slot glyph slot, lesser than LCD_I2C_GLYPHS.
+ * @param rows glyph rows, 5 low bits per row, top row first.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_set_glyph(lcd_i2c_t *lcd, uint8_t slot, const uint8_t rows[LCD_I2C_GLYPH_ROWS]);
+
+/**
+ * @brief Load a custom glyph into CGRAM before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param slot glyph slot, lesser than LCD_I2C_GLYPHS.
+ * @param rows glyph rows, 5 low bits per row, top row first.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_set_glyph_until(lcd_i2c_t *lcd, uint8_t slot, const uint8_t rows[LCD_I2C_GLYPH_ROWS], 
+                                  TickType_t deadline);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -142,6 +419,22 @@ esp_err_t lcd_i2c_set_cursor(lcd_i2c_t *lcd, uint8_t col, uint8_t row);
  */
 esp_err_t lcd_i2c_set_cursor_style(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style);
 
+/**
+ * @brief Change cursor style before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param style cursor style.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_set_cursor_style_until(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style, TickType_t deadline);
+
 /**
  * @brief Create a new device on bus
  * 
@@ -153,6 +446,22 @@ esp_err_t lcd_i2c_set_cursor_style(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style)
  */
 esp_err_t lcd_i2c_shift_display(lcd_i2c_t *lcd, lcd_i2c_shift_display_t direction);
 
+/**
+ * @brief Shift display content before a deadline.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param direction shift direction.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_shift_display_until(lcd_i2c_t *lcd, lcd_i2c_shift_display_t direction, TickType_t deadline);
+
 
 /**@}*/
 
@@ -40,6 +40,8 @@ extern "C" {
 #define DELAY_RST   (5 * DELAY_MS)
 #define DELAY_EN    (1)
 #define DELAY_CLR   (2 * DELAY_MS)
+#define DELAY_EXEC  (37)
+#define DELAY_INIT  (DELAY_PWON + 2 * DELAY_RST + DELAY_CLR)   // fixed waits of power-on and reset
 
 // LCD byte pins according PCF8574A connections
 #define LCD_BIT_RS  0x0
@@ -92,6 +94,16 @@ extern "C" {
 
 #define LCD_MAX_NUM CONFIG_LCD_MAX_NUM      /*<! maximum display on i2c bus */
 
+// expander writes per byte, an enable pulse around each nibble.
+#define LCD_WAVE_STATES 6
+// idle writes ahead of a byte at most, nibbles of consecutive bytes are kept 
+// DELAY_EXEC apart up to 1 MHz.
+#define LCD_WAVE_PAD_MAX 2
+// characters encoded in one transaction, a 2004 row.
+#define LCD_BURST_CHARS 20
+// fixed-point decimals an int32_t can hold.
+#define LCD_DECIMALS_MAX 9
+
 // macros
 #define MOVE_NIBBLE (4)
 #define SET_BIT(y,bit)  (y |=(1<<bit))
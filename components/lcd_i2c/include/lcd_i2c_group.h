@@ -0,0 +1,284 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file lcd_i2c_group.h
+ * @defgroup lcd_i2c_group lcd_i2c_group
+ * @ingroup lcd_i2c
+ * @{
+ *
+ * @brief Displays on one port mirroring the same content.
+ * 
+ * An update is encoded once and the same expander writes go to every member, 
+ * all in one locked session of the port. The group keeps the DDRAM content 
+ * members show. A member that fails an update falls out of sync and is left 
+ * out of later updates, lcd_i2c_group_resync() resets it and rewrites the 
+ * content. Members are driven through their group only while in it.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "lcd_i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_GROUP_MEMBERS_MAX   32      /*!< Members of a group, bits of stale */
+#define LCD_GROUP_DDRAM_SIZE    0x68    /*!< DDRAM addresses of a 2-line controller */
+
+typedef struct
+{
+    lcd_i2c_t **members;                    /*!< Displays of the group, owned by caller */
+    uint8_t count;                          /*!< Number of members */
+    uint32_t stale;                         /*!< Members out of sync, bit n for members[n] */
+    bool backlight;                         /*!< Backlight of every member */
+    uint8_t ac;                             /*!< DDRAM address of next character */
+    uint8_t ddram[LCD_GROUP_DDRAM_SIZE];    /*!< Content members show, by DDRAM address */
+} lcd_i2c_group_t;
+
+
+/**
+ * @brief Group started displays showing the same content.
+ * 
+ * Members must be of one type, on one port and cleared, as they are after 
+ * lcd_i2c_init(). They take the backlight of the first member with the next 
+ * update.
+ * 
+ * @param group group storage, owned by caller.
+ * @param members displays of the group, it must live until the group is no 
+ *                longer used.
+ * @param count number of members, up to LCD_GROUP_MEMBERS_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument, members of different types or 
+ *       ports
+ *     - ESP_ERR_INVALID_STATE: a member is not started
+ */
+esp_err_t lcd_i2c_group_init(lcd_i2c_group_t *group, lcd_i2c_t **members, uint8_t count);
+
+/**
+ * @brief Clear every member.
+ * 
+ * @param group pointer to group.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_clear_display(lcd_i2c_group_t *group);
+
+/**
+ * @brief Clear every member before a deadline.
+ * 
+ * Members run the clear instruction together, the group waits for it once.
+ * 
+ * @param group pointer to group.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_clear_display_until(lcd_i2c_group_t *group, TickType_t deadline);
+
+/**
+ * @brief Write a string at cursor position of every member.
+ * 
+ * @param group pointer to group.
+ * @param data null terminated string to write.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_write(lcd_i2c_group_t *group, const char *data);
+
+/**
+ * @brief Write a string at cursor position of every member before a deadline.
+ * 
+ * @param group pointer to group.
+ * @param data null terminated string to write.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_write_until(lcd_i2c_group_t *group, const char *data, TickType_t deadline);
+
+/**
+ * @brief Write formatted text at cursor position of every member.
+ * 
+ * @param group pointer to group.
+ * @param fmt format string, as of lcd_i2c_printf().
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_printf(lcd_i2c_group_t *group, const char *fmt, ...) 
+                               __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Write formatted text at cursor position of every member before a 
+ *        deadline.
+ * 
+ * @param group pointer to group.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ * @param fmt format string, as of lcd_i2c_printf().
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_printf_until(lcd_i2c_group_t *group, TickType_t deadline, const char *fmt, ...) 
+                                     __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Set cursor position of every member.
+ * 
+ * @param group pointer to group.
+ * @param col column, limited to the last one of display.
+ * @param row row, lesser than rows of display.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_set_cursor(lcd_i2c_group_t *group, uint8_t col, uint8_t row);
+
+/**
+ * @brief Set cursor position of every member before a deadline.
+ * 
+ * @param group pointer to group.
+ * @param col column, limited to the last one of display.
+ * @param row row, lesser than rows of display.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_set_cursor_until(lcd_i2c_group_t *group, uint8_t col, uint8_t row, TickType_t deadline);
+
+/**
+ * @brief Turn backlight of every member on or off.
+ * 
+ * @param group pointer to group.
+ * @param bkl_status backlight status.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_set_backlight(lcd_i2c_group_t *group, bool bkl_status);
+
+/**
+ * @brief Turn backlight of every member on or off before a deadline.
+ * 
+ * @param group pointer to group.
+ * @param bkl_status backlight status.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired before any write
+ *     - ESP_FAIL: a member fell out of sync, others were updated, or no member 
+ *       is in sync
+ */
+esp_err_t lcd_i2c_group_set_backlight_until(lcd_i2c_group_t *group, bool bkl_status, TickType_t deadline);
+
+/**
+ * @brief Bring members out of sync back.
+ * 
+ * Each member out of sync gets the power-on time and runs the reset sequence, 
+ * then gets the group content and cursor position. It takes some 30 ms per 
+ * member, other devices on the port are served meanwhile. Every member gets 
+ * a deadline of its own, I2C_TIMEOUT over its power-on and reset waits.
+ * 
+ * @param group pointer to group.
+ *
+ * @return 
+ *     - ESP_OK: success, every member in sync
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: a member is still out of sync
+ */
+esp_err_t lcd_i2c_group_resync(lcd_i2c_group_t *group);
+
+/**
+ * @brief Bring members out of sync back before a deadline.
+ * 
+ * @param group pointer to group.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success, every member in sync
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: a member is still out of sync
+ */
+esp_err_t lcd_i2c_group_resync_until(lcd_i2c_group_t *group, TickType_t deadline);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,169 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file lcd_i2c_widget.h
+ * @defgroup lcd_i2c_widget lcd_i2c_widget
+ * @ingroup lcd_i2c
+ * @{
+ *
+ * @brief Bar graphs and big digits on lcd_i2c displays.
+ * 
+ * A widget keeps the value it last rendered. An update renders the new value 
+ * and sends only the cells whose character changes, a bar moving by a step 
+ * sends one or two cells, with the cursor moves, in one transaction.
+ * 
+ * Partial bar cells and digit strokes are CGRAM glyphs, loaded once per 
+ * display when a widget first needs them. Horizontal bars and big digits share 
+ * a glyph set, vertical bars need the whole CGRAM for theirs: a display shows 
+ * either kind. Loading the other set, or a glyph with lcd_i2c_set_glyph(), 
+ * changes cells of widgets drawn with the set before.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "lcd_i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_WIDGET_BIG_DIGITS_MAX   5   /*!< Big digits across a 20 column display */
+
+typedef enum{
+    LCD_WIDGET_HBAR = 0,    /*!< Horizontal bar, grows right, 5 steps per cell */
+    LCD_WIDGET_VBAR,        /*!< Vertical bar, grows up, 8 steps per cell */
+    LCD_WIDGET_BIG2,        /*!< Big digits 2 rows high */
+    LCD_WIDGET_BIG4         /*!< Big digits 4 rows high */
+} lcd_i2c_widget_type_t;
+
+typedef struct
+{
+    lcd_i2c_t *lcd;                 /*!< Display the widget is on */
+    lcd_i2c_widget_type_t type;     /*!< Widget kind */
+    uint8_t col;                    /*!< Left column */
+    uint8_t row;                    /*!< Top row */
+    uint8_t size;                   /*!< Bar length in cells or number of big digits */
+    int32_t min;                    /*!< Bar value shown empty */
+    int32_t max;                    /*!< Bar value shown full */
+    int32_t value;                  /*!< Value on display */
+    bool drawn;                     /*!< Value is on display */
+} lcd_i2c_widget_t;
+
+
+/**
+ * @brief Place a bar graph on a display, drawn on first update.
+ * 
+ * A horizontal bar takes size cells of row from col on, a vertical one size 
+ * rows of col from row down. Values are clamped to min and max.
+ * 
+ * @param widget widget storage, owned by caller.
+ * @param lcd display the bar is on, already started.
+ * @param type LCD_WIDGET_HBAR or LCD_WIDGET_VBAR.
+ * @param col left column.
+ * @param row top row.
+ * @param size bar length in cells.
+ * @param min value shown empty.
+ * @param max value shown full, greater than min.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument, bar does not fit display
+ */
+esp_err_t lcd_i2c_bar_init(lcd_i2c_widget_t *widget, lcd_i2c_t *lcd, lcd_i2c_widget_type_t type, uint8_t col, 
+                           uint8_t row, uint8_t size, int32_t min, int32_t max);
+
+/**
+ * @brief Place big digits on a display, drawn on first update.
+ * 
+ * Each digit is 3 columns wide with a blank column after it, numbers are right 
+ * aligned with a leading minus sign. A number with more digits than the 
+ * widget shows as minus signs.
+ * 
+ * @param widget widget storage, owned by caller.
+ * @param lcd display the digits are on, already started.
+ * @param type LCD_WIDGET_BIG2 or LCD_WIDGET_BIG4.
+ * @param col left column.
+ * @param row top row.
+ * @param digits number of digits, up to LCD_WIDGET_BIG_DIGITS_MAX.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument, digits do not fit display
+ */
+esp_err_t lcd_i2c_big_init(lcd_i2c_widget_t *widget, lcd_i2c_t *lcd, lcd_i2c_widget_type_t type, uint8_t col, 
+                           uint8_t row, uint8_t digits);
+
+/**
+ * @brief Show a value on a widget.
+ * 
+ * Only cells that change are sent, the whole widget the first time and after 
+ * lcd_i2c_widget_invalidate(). The cursor is left after the last cell sent.
+ * 
+ * @param widget pointer to widget.
+ * @param value value to show.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_widget_update(lcd_i2c_widget_t *widget, int32_t value);
+
+/**
+ * @brief Show a value on a widget before a deadline.
+ * 
+ * @param widget pointer to widget.
+ * @param value value to show.
+ * @param deadline absolute deadline from i2cbus_deadline(), shared by every bus 
+ *                 access the operation makes.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_widget_update_until(lcd_i2c_widget_t *widget, int32_t value, TickType_t deadline);
+
+/**
+ * @brief Draw the whole widget on its next update.
+ * 
+ * Call it once the cells of a widget were overwritten, by 
+ * lcd_i2c_clear_display() for instance.
+ * 
+ * @param widget pointer to widget.
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ */
+esp_err_t lcd_i2c_widget_invalidate(lcd_i2c_widget_t *widget);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -28,241 +28,621 @@
  */
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include "esp_log.h"
 #include "esp32/rom/ets_sys.h"
 #include "lcd_i2c.h"
 #include "lcd_i2c_const.h"
+#include "lcd_i2c_priv.h"
 
 static const char *TAG = "lcd_i2c";
 
-esp_err_t _lcd_i2c_write(lcd_i2c_t *lcd, uint8_t data, lcd_i2c_reg_t lcd_reg)
+// reset and set-up sequence, with the delay to wait after each instruction.
+static const struct {
+    uint8_t cmd;
+    uint32_t delay;
+} lcd_init_seq[] = {
+    // starting reset device procedment.
+    {LCD_CONFIG_8BIT_RST, DELAY_RST},
+    {LCD_CONFIG_8BIT_RST, DELAY_RST},
+    {LCD_CONFIG_8BIT_RST, 0},
+    {LCD_CONFIG_4BIT_RST, 0},
+    // set-up display comunication bits, number of lines and character size.
+    {LCD_CONFIG_4BIT_2LINE_5X7, 0},
+    // finish reset procedment.
+    {LCD_DISPLAY_OFF, 0},
+    {LCD_CLR_DISPLAY, 0},
+    {LCD_WRITE_TO_RIGHT, 0},
+    // turn on display and it is restarted done.
+    {LCD_DISPLAY_ON, 0},
+};
+
+// idle writes that keep the first nibble of a byte DELAY_EXEC after the last 
+// nibble of the byte before, latched 3 writes of 9 clocks earlier.
+static size_t _lcd_i2c_pad(const lcd_i2c_t *lcd)
 {
-    if (lcd != NULL) {
-        for (int wr_seq = 0; wr_seq < 2; wr_seq ++) {
-            uint8_t _data;
-            // select witch nibble of data will be writing at time.
-            if (wr_seq) {
-                if (!lcd->started) {
-                    if ((data == LCD_CONFIG_4BIT_RST) && 
-                        (lcd_reg == LCD_I2C_INSTRUCTION))
-                        lcd->started = true;
-                    return ESP_OK;
-                }
-                // send LSB.
-                _data = SHFT_LEFT(LOW_NIBBLE(data), MOVE_NIBBLE);
-            } else {
-                // send MSB.
-                _data = HIGH_NIBBLE(data);
-            }
+    uint64_t writes = ((uint64_t)DELAY_EXEC * i2cbus_get_freq(lcd->pcf.bus.port) + 9000000 - 1) / 9000000;
+    size_t pad = (writes > 3) ? (size_t)(writes - 3) : 0;
 
-            // switch register to write instruction or data.
-            if (lcd_reg)
-                SET_BIT(_data, LCD_BIT_RS);
-            
-            // check backlight status and add it's bit to i2c byte.
-            if (lcd->backlight) 
-                SET_BIT(_data, LCD_BIT_BKL);
-            
-            // transmit the data to lcd via i2c bus, with enable sign.
-            for (int en_bit = 0; en_bit < 3; en_bit++) {
-                // switch enable bit and populate on data byte.
-                if (en_bit % 2)
-                    SET_BIT(_data, LCD_BIT_EN);
-                else
-                    CLR_BIT(_data, LCD_BIT_EN);
-
-                if (i2cbus_write(&lcd->bus, &_data, sizeof(_data)) != ESP_OK)
-                    return ESP_FAIL;
-                
-                ets_delay_us(DELAY_EN);
-            }
+    return (pad < LCD_WAVE_PAD_MAX) ? pad : LCD_WAVE_PAD_MAX;
+}
+
+// encode a byte as an enable pulse around each nibble: low, high, low. Only the 
+// high nibble goes out while the controller still takes 8-bit instructions. 
+// On a fast clock the first low state is repeated until the byte before has 
+// been executed.
+static size_t _lcd_i2c_encode(const lcd_i2c_t *lcd, uint8_t data, lcd_i2c_reg_t lcd_reg, uint8_t *states)
+{
+    size_t pad = _lcd_i2c_pad(lcd);
+    size_t count = 0;
+
+    for (int wr_seq = 0; wr_seq < (lcd->started ? 2 : 1); wr_seq ++) {
+        uint8_t _data;
+        // select witch nibble of data will be writing at time.
+        if (wr_seq) {
+            // send LSB.
+            _data = SHFT_LEFT(LOW_NIBBLE(data), MOVE_NIBBLE);
+        } else {
+            // send MSB.
+            _data = HIGH_NIBBLE(data);
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
+
+        // switch register to write instruction or data.
+        if (lcd_reg)
+            SET_BIT(_data, LCD_BIT_RS);
+        
+        // check backlight status and add it's bit to i2c byte.
+        if (lcd->backlight) 
+            SET_BIT(_data, LCD_BIT_BKL);
+        
+        for (; pad; pad--)
+            states[count++] = _data;
+        states[count++] = _data;
+        states[count++] = _data | (1 << LCD_BIT_EN);
+        states[count++] = _data;
     }
+    return count;
+}
+
+esp_err_t _lcd_i2c_write(lcd_i2c_t *lcd, uint8_t data, lcd_i2c_reg_t lcd_reg, TickType_t deadline)
+{
+    uint8_t states[LCD_WAVE_STATES + LCD_WAVE_PAD_MAX];
+
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    size_t count = _lcd_i2c_encode(lcd, data, lcd_reg, states);
+    bool started = !lcd->started && (data == LCD_CONFIG_4BIT_RST) && (lcd_reg == LCD_I2C_INSTRUCTION);
+
+    // whole instruction goes in one transaction, every byte on the wire is
+    // far longer than the enable pulse and set-up times.
+    esp_err_t res = pcf8574_write_wave_until(&lcd->pcf, states, count, deadline);
+    if (res != ESP_OK)
+        return res;
+    ets_delay_us(DELAY_EN);
+
+    // controller is in 4-bit mode once its switch instruction went through.
+    if (started)
+        lcd->started = true;
 
     if (!lcd_reg && (data < 4)) {
+        // clear and home run long, they must be on the wire before waiting
+        // when display writes are posted.
+        res = i2cbus_flush_until(&lcd->pcf.bus, deadline);
+        if (res != ESP_OK)
+            return res;
         ets_delay_us(DELAY_CLR);
     }
     
     return ESP_OK;
 }
 
-esp_err_t lcd_i2c_init(lcd_i2c_t *lcd, i2c_port_t port, uint8_t addr, lcd_type_t lcd_type)
+void lcd_i2c_burst_flush(lcd_i2c_burst_t *burst)
+{
+    // the first nibble of each character is 3 bytes on the wire after the last 
+    // one of the previous character, 27 us at 1 MHz against its 37 us of 
+    // execution. Encoding pads characters with idle bytes on clocks that fast.
+    if ((burst->res == ESP_OK) && burst->count) {
+        if (burst->group != NULL)
+            burst->res = lcd_i2c_group_send_until(burst->group, burst->states, burst->count, burst->deadline);
+        else
+            burst->res = pcf8574_write_wave_until(&burst->lcd->pcf, burst->states, burst->count, burst->deadline);
+        if (burst->res == ESP_OK)
+            ets_delay_us(DELAY_EN);
+    }
+    burst->count = 0;
+}
+
+void lcd_i2c_burst_write(lcd_i2c_burst_t *burst, uint8_t data, lcd_i2c_reg_t lcd_reg)
+{
+    // group content follows what is meant to be shown, failed members catch 
+    // up from it.
+    if (burst->group != NULL)
+        lcd_i2c_group_track(burst->group, data, lcd_reg);
+    if (burst->res != ESP_OK)
+        return;
+    if ((burst->count + LCD_WAVE_STATES + LCD_WAVE_PAD_MAX) > sizeof(burst->states))
+        lcd_i2c_burst_flush(burst);
+    burst->count += _lcd_i2c_encode(burst->lcd, data, lcd_reg, &burst->states[burst->count]);
+}
+
+void lcd_i2c_burst_glyphs(lcd_i2c_burst_t *burst, uint8_t slot, const uint8_t (*glyphs)[LCD_I2C_GLYPH_ROWS], 
+                          size_t count)
+{
+    lcd_i2c_burst_write(burst, LCD_SET_CGRAM_ADDR + (slot * LCD_I2C_GLYPH_ROWS), LCD_I2C_INSTRUCTION);
+    for (size_t i = 0; i < count; i++) {
+        for (int row = 0; row < LCD_I2C_GLYPH_ROWS; row++)
+            lcd_i2c_burst_write(burst, glyphs[i][row], LCD_I2C_DATA);
+    }
+}
+
+static void _lcd_i2c_burst_put(lcd_i2c_burst_t *burst, char c)
+{
+    lcd_i2c_burst_write(burst, c, LCD_I2C_DATA);
+}
+
+static void _lcd_i2c_burst_fill(lcd_i2c_burst_t *burst, char c, int count)
+{
+    while (count-- > 0)
+        _lcd_i2c_burst_put(burst, c);
+}
+
+// put a number in a field, width 0 fits the number and a number wider than 
+// its field turns the whole field into '#'. Digits come out most significant 
+// first, dividing by the largest power of base below the value.
+static void _lcd_i2c_burst_number(lcd_i2c_burst_t *burst, uint32_t value, bool negative, uint8_t base, 
+                                  bool upper, int min_digits, uint8_t decimals, uint8_t width, 
+                                  lcd_i2c_align_t align)
+{
+    uint32_t div = 1;
+    int value_digits = 1;
+
+    while ((value / div) >= base) {
+        div *= base;
+        value_digits++;
+    }
+    // a fixed-point value keeps a zero before its point.
+    if (min_digits < (decimals + 1))
+        min_digits = decimals + 1;
+    int digits = (value_digits > min_digits) ? value_digits : min_digits;
+
+    int len = negative + digits + (decimals ? 1 : 0);
+    if (width && (len > width)) {
+        _lcd_i2c_burst_fill(burst, '#', width);
+        return;
+    }
+
+    int pad = width - len;
+    if (align == LCD_ALIGN_RIGHT)
+        _lcd_i2c_burst_fill(burst, ' ', pad);
+    if (negative)
+        _lcd_i2c_burst_put(burst, '-');
+    if (align == LCD_ALIGN_ZERO)
+        _lcd_i2c_burst_fill(burst, '0', pad);
+
+    for (int pos = digits; pos > 0; pos--) {
+        uint32_t digit = 0;
+
+        if (pos == decimals)
+            _lcd_i2c_burst_put(burst, '.');
+        // positions above the value are leading zeros.
+        if (pos <= value_digits) {
+            digit = value / div;
+            value %= div;
+            div /= base;
+        }
+        _lcd_i2c_burst_put(burst, (digit < 10) ? ('0' + digit) : ((upper ? 'A' : 'a') + digit - 10));
+    }
+
+    if (align == LCD_ALIGN_LEFT)
+        _lcd_i2c_burst_fill(burst, ' ', pad);
+}
+
+void lcd_i2c_burst_format(lcd_i2c_burst_t *burst, const char *fmt, va_list args)
 {
-    // create lcd mutex semaphore, return fail if can't create.
-    if (i2cbus_create(&lcd->bus, port, addr) != ESP_OK)
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            _lcd_i2c_burst_put(burst, *fmt);
+            continue;
+        }
+
+        lcd_i2c_align_t align = LCD_ALIGN_RIGHT;
+        uint8_t width = 0;
+        int precision = -1;
+        bool is_long = false;
+
+        // flags, width, precision and length.
+        for (fmt++; (*fmt == '-') || (*fmt == '0'); fmt++) {
+            if (*fmt == '-')
+                align = LCD_ALIGN_LEFT;
+            else if (align != LCD_ALIGN_LEFT)
+                align = LCD_ALIGN_ZERO;
+        }
+        for (; (*fmt >= '0') && (*fmt <= '9'); fmt++)
+            width = width * 10 + (*fmt - '0');
+        if (*fmt == '.') {
+            for (precision = 0, fmt++; (*fmt >= '0') && (*fmt <= '9'); fmt++)
+                precision = precision * 10 + (*fmt - '0');
+        }
+        for (; *fmt == 'l'; fmt++)
+            is_long = true;
+
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                int32_t value = is_long ? (int32_t)va_arg(args, long) : va_arg(args, int);
+                uint32_t mag = (value < 0) ? (0U - (uint32_t)value) : (uint32_t)value;
+                _lcd_i2c_burst_number(burst, mag, value < 0, 10, false, precision, 0, width, align);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint32_t value = is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int);
+                _lcd_i2c_burst_number(burst, value, false, (*fmt == 'u') ? 10 : 16, *fmt == 'X', precision, 0, 
+                                      width, align);
+                break;
+            }
+            case 'c': {
+                int pad = width ? (width - 1) : 0;
+                if (align != LCD_ALIGN_LEFT)
+                    _lcd_i2c_burst_fill(burst, ' ', pad);
+                _lcd_i2c_burst_put(burst, (char)va_arg(args, int));
+                if (align == LCD_ALIGN_LEFT)
+                    _lcd_i2c_burst_fill(burst, ' ', pad);
+                break;
+            }
+            case 's': {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL)
+                    str = "(null)";
+                // a string longer than its field is cut at the field.
+                size_t limit = (precision >= 0) ? (size_t)precision : SIZE_MAX;
+                if (width && (width < limit))
+                    limit = width;
+                int len = strnlen(str, limit);
+                int pad = width - len;
+                if (align != LCD_ALIGN_LEFT)
+                    _lcd_i2c_burst_fill(burst, ' ', pad);
+                while (len--)
+                    _lcd_i2c_burst_put(burst, *str++);
+                if (align == LCD_ALIGN_LEFT)
+                    _lcd_i2c_burst_fill(burst, ' ', pad);
+                break;
+            }
+            case '%':
+                _lcd_i2c_burst_put(burst, '%');
+                break;
+            case '\0':
+                // lone '%' ends the format.
+                return;
+            default:
+                // unsupported conversions, floating point among them, show as 
+                // written.
+                _lcd_i2c_burst_put(burst, '%');
+                _lcd_i2c_burst_put(burst, *fmt);
+                break;
+        }
+    }
+}
+
+esp_err_t lcd_i2c_reset_until(lcd_i2c_t *lcd, TickType_t deadline)
+{
+    esp_err_t res = ESP_OK;
+
+    // controller may be in any mode, reset starts from 8-bit instructions.
+    lcd->started = false;
+    lcd->glyphs = NULL;
+
+    // run reset and set-up procedment, it stops at first failure so an 
+    // expired deadline is not stretched by the remaining steps.
+    for (size_t i = 0; (i < sizeof(lcd_init_seq) / sizeof(lcd_init_seq[0])) && (res == ESP_OK); i++) {
+        res = _lcd_i2c_write(lcd, lcd_init_seq[i].cmd, LCD_I2C_INSTRUCTION, deadline);
+        if ((res != ESP_OK) || !lcd_init_seq[i].delay)
+            continue;
+
+        // the wait only counts from the instruction on the wire, when display 
+        // writes are posted.
+        res = i2cbus_flush_until(&lcd->pcf.bus, deadline);
+        if (res == ESP_OK)
+            ets_delay_us(lcd_init_seq[i].delay);
+    }
+    return res;
+}
+
+esp_err_t lcd_i2c_init_until(lcd_i2c_t *lcd, i2c_port_t port, uint8_t addr, lcd_type_t lcd_type, 
+                             TickType_t deadline)
+{
+    esp_err_t res = ESP_OK;
+
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    // create lcd expander and its mutex semaphore, a display a bus scan did
+    // not find fails here without running the reset sequence.
+    res = pcf8574_init(&lcd->pcf, port, addr);
+    if (res == ESP_ERR_NOT_FOUND)
+        return res;
+    if (res != ESP_OK)
         return ESP_FAIL;
     
     lcd->backlight = true;
     lcd->type = lcd_type;
 
+    // See if we can obtain the semaphore.  If the semaphore is not available
+    // wait until the deadline to see if it becomes free.
+    if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
+        // We were able to obtain the semaphore and can now access the
+        // shared resource.
+
+        ets_delay_us(DELAY_PWON);
+        res = lcd_i2c_reset_until(lcd, deadline);
+
+        // We have finished accessing the shared resource.  Release the
+        // semaphore.
+        xSemaphoreGive(lcd->pcf.bus.mutex);
+    }
+    else {
+        // We could not obtain the semaphore and can therefore not access
+        // the shared resource safely.
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (res == ESP_OK)
+        ESP_LOGI(TAG, "init");
+    return res;
+}
+
+esp_err_t lcd_i2c_init(lcd_i2c_t *lcd, i2c_port_t port, uint8_t addr, lcd_type_t lcd_type)
+{
+    // the bus steps get the usual budget, the power-on and reset waits come on 
+    // top of it.
+    return lcd_i2c_init_until(lcd, port, addr, lcd_type, 
+                              i2cbus_deadline(I2C_TIMEOUT + DELAY_INIT / DELAY_MS));
+}
+
+esp_err_t lcd_i2c_delete(lcd_i2c_t *lcd)
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    // expander deletes the mutex once nobody else holds it.
+    return pcf8574_delete(&lcd->pcf);
+}
+
+esp_err_t lcd_i2c_clear_display_until(lcd_i2c_t *lcd, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
     if (lcd != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
-            ets_delay_us(DELAY_PWON);
-            // starting reset device procedment.
-            _lcd_i2c_write(lcd, LCD_CONFIG_8BIT_RST, LCD_I2C_INSTRUCTION);
-            ets_delay_us(DELAY_RST);
-            _lcd_i2c_write(lcd, LCD_CONFIG_8BIT_RST, LCD_I2C_INSTRUCTION);
-            ets_delay_us(DELAY_RST);
-            _lcd_i2c_write(lcd, LCD_CONFIG_8BIT_RST, LCD_I2C_INSTRUCTION);
-            _lcd_i2c_write(lcd, LCD_CONFIG_4BIT_RST, LCD_I2C_INSTRUCTION);
-
-            // set-up display comunication bits, number of lines and 
-            // character size.
-            _lcd_i2c_write(lcd, LCD_CONFIG_4BIT_2LINE_5X7, LCD_I2C_INSTRUCTION);
-            
-            // finish reset procedment.
-            _lcd_i2c_write(lcd, LCD_DISPLAY_OFF, LCD_I2C_INSTRUCTION);
-            _lcd_i2c_write(lcd, LCD_CLR_DISPLAY, LCD_I2C_INSTRUCTION);
-            _lcd_i2c_write(lcd, LCD_WRITE_TO_RIGHT, LCD_I2C_INSTRUCTION);
-
-            // turn on display and it is restarted done.
-            _lcd_i2c_write(lcd, LCD_DISPLAY_ON, LCD_I2C_INSTRUCTION);
+            res = _lcd_i2c_write(lcd, LCD_CLR_DISPLAY, LCD_I2C_INSTRUCTION, deadline);
 
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
+    return res;
+}
 
-    ESP_LOGI(TAG, "init");
-    return ESP_OK;
+esp_err_t lcd_i2c_clear_display(lcd_i2c_t *lcd)
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_clear_display_until(lcd, i2cbus_deadline(lcd->pcf.bus.time_out));
 }
 
-esp_err_t lcd_i2c_delete(lcd_i2c_t *lcd)
+esp_err_t lcd_i2c_write_until(lcd_i2c_t *lcd, const char *data, TickType_t deadline)
 {
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
     if (lcd != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
-            vSemaphoreDelete(lcd->bus.mutex);
-
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            while (*data)
+                _lcd_i2c_burst_put(&burst, *data++);
+            lcd_i2c_burst_flush(&burst);
+            res = burst.res;
+            
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_clear_display(lcd_i2c_t *lcd)
+esp_err_t lcd_i2c_write(lcd_i2c_t *lcd, const char *data)
 {
-    if (lcd != NULL) {
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_write_until(lcd, data, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+// fields of lcd_i2c_write_int() and lcd_i2c_write_fixed().
+static esp_err_t _lcd_i2c_write_number_until(lcd_i2c_t *lcd, int32_t value, uint8_t decimals, uint8_t width, 
+                                             lcd_i2c_align_t align, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
+    if ((lcd != NULL) && (decimals <= LCD_DECIMALS_MAX)) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
-            _lcd_i2c_write(lcd, LCD_CLR_DISPLAY, LCD_I2C_INSTRUCTION);
-
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            uint32_t mag = (value < 0) ? (0U - (uint32_t)value) : (uint32_t)value;
+            _lcd_i2c_burst_number(&burst, mag, value < 0, 10, false, 1, decimals, width, align);
+            lcd_i2c_burst_flush(&burst);
+            res = burst.res;
+            
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_write(lcd_i2c_t *lcd, const char *data)
+esp_err_t lcd_i2c_write_int_until(lcd_i2c_t *lcd, int32_t value, uint8_t width, lcd_i2c_align_t align, 
+                                  TickType_t deadline)
 {
-    if (lcd != NULL) {
+    return _lcd_i2c_write_number_until(lcd, value, 0, width, align, deadline);
+}
+
+esp_err_t lcd_i2c_write_int(lcd_i2c_t *lcd, int32_t value, uint8_t width, lcd_i2c_align_t align)
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_write_int_until(lcd, value, width, align, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_write_fixed_until(lcd_i2c_t *lcd, int32_t value, uint8_t decimals, uint8_t width, 
+                                    lcd_i2c_align_t align, TickType_t deadline)
+{
+    return _lcd_i2c_write_number_until(lcd, value, decimals, width, align, deadline);
+}
+
+esp_err_t lcd_i2c_write_fixed(lcd_i2c_t *lcd, int32_t value, uint8_t decimals, uint8_t width, 
+                              lcd_i2c_align_t align)
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_write_fixed_until(lcd, value, decimals, width, align, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_vprintf_until(lcd_i2c_t *lcd, TickType_t deadline, const char *fmt, va_list args)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
+    if ((lcd != NULL) && (fmt != NULL)) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
-            while (*data) {
-                _lcd_i2c_write(lcd, *data, LCD_I2C_DATA);
-                data++;
-            }
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            lcd_i2c_burst_format(&burst, fmt, args);
+            lcd_i2c_burst_flush(&burst);
+            res = burst.res;
             
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_set_backlight(lcd_i2c_t *lcd, bool bkl_status)
+esp_err_t lcd_i2c_printf_until(lcd_i2c_t *lcd, TickType_t deadline, const char *fmt, ...)
 {
-    lcd->backlight = bkl_status;
+    va_list args;
+
+    va_start(args, fmt);
+    esp_err_t res = lcd_i2c_vprintf_until(lcd, deadline, fmt, args);
+    va_end(args);
+    return res;
+}
+
+esp_err_t lcd_i2c_printf(lcd_i2c_t *lcd, const char *fmt, ...)
+{
+    va_list args;
+
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    va_start(args, fmt);
+    esp_err_t res = lcd_i2c_vprintf_until(lcd, i2cbus_deadline(lcd->pcf.bus.time_out), fmt, args);
+    va_end(args);
+    return res;
+}
+
+esp_err_t lcd_i2c_set_backlight_until(lcd_i2c_t *lcd, bool bkl_status, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
 
     if (lcd != NULL) {
+        lcd->backlight = bkl_status;
+
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
-            uint8_t _data = 0x00;
-            // check backlight status and add it's bit to i2c byte.
-            if (lcd->backlight) 
-                SET_BIT(_data, LCD_BIT_BKL);
-            // send backlight update.
-            if (i2cbus_write(&lcd->bus, &_data, sizeof(_data)) != ESP_OK)
-                return ESP_FAIL;
+            // send backlight update, other lines keep their levels and an
+            // unchanged backlight costs no transaction.
+            res = pcf8574_update_until(&lcd->pcf, PCF8574_PIN(LCD_BIT_BKL), lcd->backlight ? 0xFF : 0x00, 
+                                       deadline);
             
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_set_cursor(lcd_i2c_t *lcd, uint8_t col, uint8_t row)
+esp_err_t lcd_i2c_set_backlight(lcd_i2c_t *lcd, bool bkl_status)
 {
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_set_backlight_until(lcd, bkl_status, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_set_cursor_until(lcd_i2c_t *lcd, uint8_t col, uint8_t row, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
     if (lcd != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
 
@@ -277,43 +657,94 @@ esp_err_t lcd_i2c_set_cursor(lcd_i2c_t *lcd, uint8_t col, uint8_t row)
             }
 
             // set DDRAM address.
-            _lcd_i2c_write(lcd, (LCD_DDRAM_ADDR + col + lcd_line[row]), LCD_I2C_INSTRUCTION);
+            res = _lcd_i2c_write(lcd, (LCD_DDRAM_ADDR + col + lcd_line[row]), LCD_I2C_INSTRUCTION, deadline);
             
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
+    }
+    return res;
+}
+
+esp_err_t lcd_i2c_set_cursor(lcd_i2c_t *lcd, uint8_t col, uint8_t row)
+{
+    if (lcd == NULL)
         return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_set_cursor_until(lcd, col, row, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_set_glyph_until(lcd_i2c_t *lcd, uint8_t slot, const uint8_t rows[LCD_I2C_GLYPH_ROWS], 
+                                  TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
+    if ((lcd != NULL) && (slot < LCD_I2C_GLYPHS) && (rows != NULL)) {
+        // See if we can obtain the semaphore.  If the semaphore is not available
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
+            // We were able to obtain the semaphore and can now access the
+            // shared resource.
+
+            // glyph set of widgets is no longer whole.
+            lcd->glyphs = NULL;
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            lcd_i2c_burst_glyphs(&burst, slot, (const uint8_t (*)[LCD_I2C_GLYPH_ROWS])rows, 1);
+            // back to DDRAM, characters written next go to display.
+            lcd_i2c_burst_write(&burst, LCD_DDRAM_ADDR, LCD_I2C_INSTRUCTION);
+            lcd_i2c_burst_flush(&burst);
+            res = burst.res;
+            
+            // We have finished accessing the shared resource.  Release the
+            // semaphore.
+            xSemaphoreGive(lcd->pcf.bus.mutex);
+        }
+        else {
+            // We could not obtain the semaphore and can therefore not access
+            // the shared resource safely.
+            res = ESP_ERR_TIMEOUT;
+        }
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_set_cursor_style(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style)
+esp_err_t lcd_i2c_set_glyph(lcd_i2c_t *lcd, uint8_t slot, const uint8_t rows[LCD_I2C_GLYPH_ROWS])
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_set_glyph_until(lcd, slot, rows, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_set_cursor_style_until(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style, TickType_t deadline)
 {
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
     if (lcd != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
+            res = ESP_OK;
             switch(style) {
                 case LCD_CURSOR_INVISIBLE:
-                    _lcd_i2c_write(lcd, LCD_CURSOR_OFF, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_CURSOR_OFF, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 case LCD_CURSOR_UNDERSCORE:
-                    _lcd_i2c_write(lcd, LCD_CURSOR_UND, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_CURSOR_UND, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 case LCD_CURSOR_UNDERSCORE_BLINK:
-                    _lcd_i2c_write(lcd, LCD_CURSOR_UND_BLK, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_CURSOR_UND_BLK, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 case LCD_CURSOR_BLINK:
-                    _lcd_i2c_write(lcd, LCD_CURSOR_BLK, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_CURSOR_BLK, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 default:
                 break;
@@ -321,33 +752,42 @@ esp_err_t lcd_i2c_set_cursor_style(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style)
 
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
 }
 
-esp_err_t lcd_i2c_shift_display(lcd_i2c_t *lcd, lcd_i2c_shift_display_t direction)
+esp_err_t lcd_i2c_set_cursor_style(lcd_i2c_t *lcd, lcd_i2c_cursor_style_t style)
 {
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_set_cursor_style_until(lcd, style, i2cbus_deadline(lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_shift_display_until(lcd_i2c_t *lcd, lcd_i2c_shift_display_t direction, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
     if (lcd != NULL) {
         // See if we can obtain the semaphore.  If the semaphore is not available
-        // wait 10 ticks to see if it becomes free.
-        if (xSemaphoreTake(lcd->bus.mutex, pdMS_TO_TICKS(lcd->bus.time_out)) == pdTRUE) {
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
             // We were able to obtain the semaphore and can now access the
             // shared resource.
+            res = ESP_OK;
             switch(direction) {
                 case LCD_SHIFT_LEFT:
-                    _lcd_i2c_write(lcd, LCD_DISPLAY_MOVE_LEFT, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_DISPLAY_MOVE_LEFT, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 case LCD_SHIFT_RIGHT:
-                    _lcd_i2c_write(lcd, LCD_DISPLAY_MOVE_RIGHT, LCD_I2C_INSTRUCTION);
+                    res = _lcd_i2c_write(lcd, LCD_DISPLAY_MOVE_RIGHT, LCD_I2C_INSTRUCTION, deadline);
                 break;
                 default:
                 break;
@@ -355,15 +795,21 @@ esp_err_t lcd_i2c_shift_display(lcd_i2c_t *lcd, lcd_i2c_shift_display_t directio
 
             // We have finished accessing the shared resource.  Release the
             // semaphore.
-            xSemaphoreGive(lcd->bus.mutex);
+            xSemaphoreGive(lcd->pcf.bus.mutex);
         }
         else {
             // We could not obtain the semaphore and can therefore not access
             // the shared resource safely.
-            return ESP_ERR_TIMEOUT;
+            res = ESP_ERR_TIMEOUT;
         }
-    } else {
-        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_OK;
+    return res;
+}
+
+esp_err_t lcd_i2c_shift_display(lcd_i2c_t *lcd, lcd_i2c_shift_display_t direction)
+{
+    if (lcd == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_shift_display_until(lcd, direction, i2cbus_deadline(lcd->pcf.bus.time_out));
 }
\ No newline at end of file
@@ -0,0 +1,396 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file lcd_i2c_group.c
+ * 
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "esp32/rom/ets_sys.h"
+#include "lcd_i2c_group.h"
+#include "lcd_i2c_priv.h"
+
+#define GROUP_LINE_SIZE     0x28    /*!< DDRAM addresses of a line */
+#define GROUP_LINE2_ADDR    0x40    /*!< DDRAM address of second line */
+
+static const char *TAG = "lcd_i2c_group";
+
+typedef struct {
+    lcd_i2c_burst_t burst;      /*!< Update encoded once for members in sync */
+    uint32_t stale;             /*!< Members out of sync before update */
+    bool locked;                /*!< Port held for the update */
+} lcd_i2c_group_update_t;
+
+// start an update with the port locked until its end. With no member in sync 
+// nothing goes on the bus but content is still followed, for a later resync.
+static esp_err_t _lcd_i2c_group_begin(lcd_i2c_group_t *group, lcd_i2c_group_update_t *update, TickType_t deadline)
+{
+    if ((group == NULL) || (group->members == NULL) || !group->count)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(update, 0, sizeof(lcd_i2c_group_update_t));
+    update->stale = group->stale;
+    update->burst.group = group;
+    update->burst.deadline = deadline;
+    update->burst.lcd = group->members[0];
+    update->burst.res = ESP_FAIL;
+
+    // sizes are known only once encoded with the port held, quotas of members 
+    // are waited out before and charged as the update goes.
+    for (int i = 0; i < group->count; i++) {
+        if (group->stale & (1UL << i))
+            continue;
+        update->burst.res = i2cbus_prepay_quota_until(&group->members[i]->pcf.bus, 0, 0, deadline);
+        if (update->burst.res != ESP_OK)
+            return update->burst.res;
+    }
+
+    for (int i = 0; i < group->count; i++) {
+        if (!(group->stale & (1UL << i))) {
+            // members in sync share settings, any of them encodes for all.
+            update->burst.lcd = group->members[i];
+            update->burst.res = i2cbus_lock(group->members[0]->pcf.bus.port, deadline);
+            if (update->burst.res != ESP_OK)
+                return update->burst.res;
+            update->locked = true;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t _lcd_i2c_group_end(lcd_i2c_group_t *group, lcd_i2c_group_update_t *update)
+{
+    lcd_i2c_burst_flush(&update->burst);
+    if (update->locked)
+        i2cbus_unlock(group->members[0]->pcf.bus.port);
+
+    if (update->burst.res != ESP_OK)
+        return update->burst.res;
+    // members that failed this update are out of sync, the others got it.
+    return (group->stale & ~update->stale) ? ESP_FAIL : ESP_OK;
+}
+
+static void _lcd_i2c_group_drop(lcd_i2c_group_t *group, int member, esp_err_t err)
+{
+    group->stale |= 1UL << member;
+    ESP_LOGW(TAG, "display 0x%02x out of sync: %d (0x%x)", group->members[member]->pcf.bus.addr, err, err);
+}
+
+void lcd_i2c_group_track(lcd_i2c_group_t *group, uint8_t data, lcd_i2c_reg_t lcd_reg)
+{
+    if (lcd_reg == LCD_I2C_DATA) {
+        if (group->ac < LCD_GROUP_DDRAM_SIZE)
+            group->ddram[group->ac] = data;
+        // address counter runs from end of first line to the second one and 
+        // from end of second line back to the first.
+        group->ac++;
+        if (group->ac == GROUP_LINE_SIZE)
+            group->ac = GROUP_LINE2_ADDR;
+        else if (group->ac >= (GROUP_LINE2_ADDR + GROUP_LINE_SIZE))
+            group->ac = 0;
+    } else if (data & LCD_DDRAM_ADDR) {
+        group->ac = data & ~LCD_DDRAM_ADDR;
+    } else if (data == LCD_CLR_DISPLAY) {
+        memset(group->ddram, ' ', sizeof(group->ddram));
+        group->ac = 0;
+    } else if ((data & ~1) == LCD_CURSOR_HOME) {
+        group->ac = 0;
+    }
+}
+
+esp_err_t lcd_i2c_group_send_until(lcd_i2c_group_t *group, const uint8_t *states, size_t count, 
+                                   TickType_t deadline)
+{
+    esp_err_t res = ESP_FAIL;
+
+    for (int i = 0; i < group->count; i++) {
+        if (group->stale & (1UL << i))
+            continue;
+
+        esp_err_t err = pcf8574_write_wave_until(&group->members[i]->pcf, states, count, deadline);
+        if (err != ESP_OK)
+            _lcd_i2c_group_drop(group, i, err);
+        else
+            res = ESP_OK;
+    }
+    return res;
+}
+
+esp_err_t lcd_i2c_group_init(lcd_i2c_group_t *group, lcd_i2c_t **members, uint8_t count)
+{
+    if ((group == NULL) || (members == NULL) || !count || (count > LCD_GROUP_MEMBERS_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    for (int i = 0; i < count; i++) {
+        if ((members[i] == NULL) || (members[i]->pcf.bus.port != members[0]->pcf.bus.port) || 
+            (members[i]->type != members[0]->type))
+            return ESP_ERR_INVALID_ARG;
+        if (!members[i]->started)
+            return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(group, 0, sizeof(lcd_i2c_group_t));
+    group->members = members;
+    group->count = count;
+    group->backlight = members[0]->backlight;
+    memset(group->ddram, ' ', sizeof(group->ddram));
+    for (int i = 0; i < count; i++)
+        members[i]->backlight = group->backlight;
+
+    return ESP_OK;
+}
+
+esp_err_t lcd_i2c_group_clear_display_until(lcd_i2c_group_t *group, TickType_t deadline)
+{
+    lcd_i2c_group_update_t update;
+
+    esp_err_t res = _lcd_i2c_group_begin(group, &update, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    lcd_i2c_burst_write(&update.burst, LCD_CLR_DISPLAY, LCD_I2C_INSTRUCTION);
+    lcd_i2c_burst_flush(&update.burst);
+    if (update.burst.res == ESP_OK) {
+        // members run the clear together, it must be on the wire of each one 
+        // when display writes are posted, then one wait covers all.
+        for (int i = 0; i < group->count; i++) {
+            if (group->stale & (1UL << i))
+                continue;
+            esp_err_t err = i2cbus_flush_until(&group->members[i]->pcf.bus, deadline);
+            if (err != ESP_OK)
+                _lcd_i2c_group_drop(group, i, err);
+        }
+        ets_delay_us(DELAY_CLR);
+    }
+
+    return _lcd_i2c_group_end(group, &update);
+}
+
+esp_err_t lcd_i2c_group_clear_display(lcd_i2c_group_t *group)
+{
+    if ((group == NULL) || (group->members == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_group_clear_display_until(group, i2cbus_deadline(group->members[0]->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_group_write_until(lcd_i2c_group_t *group, const char *data, TickType_t deadline)
+{
+    lcd_i2c_group_update_t update;
+
+    if (data == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = _lcd_i2c_group_begin(group, &update, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    while (*data)
+        lcd_i2c_burst_write(&update.burst, *data++, LCD_I2C_DATA);
+
+    return _lcd_i2c_group_end(group, &update);
+}
+
+esp_err_t lcd_i2c_group_write(lcd_i2c_group_t *group, const char *data)
+{
+    if ((group == NULL) || (group->members == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_group_write_until(group, data, i2cbus_deadline(group->members[0]->pcf.bus.time_out));
+}
+
+static esp_err_t _lcd_i2c_group_vprintf_until(lcd_i2c_group_t *group, TickType_t deadline, const char *fmt, 
+                                              va_list args)
+{
+    lcd_i2c_group_update_t update;
+
+    if (fmt == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = _lcd_i2c_group_begin(group, &update, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    lcd_i2c_burst_format(&update.burst, fmt, args);
+
+    return _lcd_i2c_group_end(group, &update);
+}
+
+esp_err_t lcd_i2c_group_printf_until(lcd_i2c_group_t *group, TickType_t deadline, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    esp_err_t res = _lcd_i2c_group_vprintf_until(group, deadline, fmt, args);
+    va_end(args);
+    return res;
+}
+
+esp_err_t lcd_i2c_group_printf(lcd_i2c_group_t *group, const char *fmt, ...)
+{
+    va_list args;
+
+    if ((group == NULL) || (group->members == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    va_start(args, fmt);
+    esp_err_t res = _lcd_i2c_group_vprintf_until(group, i2cbus_deadline(group->members[0]->pcf.bus.time_out), 
+                                                 fmt, args);
+    va_end(args);
+    return res;
+}
+
+esp_err_t lcd_i2c_group_set_cursor_until(lcd_i2c_group_t *group, uint8_t col, uint8_t row, TickType_t deadline)
+{
+    lcd_i2c_group_update_t update;
+
+    if ((group == NULL) || (group->members == NULL) || !group->count)
+        return ESP_ERR_INVALID_ARG;
+
+    // same limits as lcd_i2c_set_cursor().
+    lcd_type_t type = group->members[0]->type;
+    if (row >= ((type == LCD_2004) ? 4 : 2))
+        return ESP_ERR_INVALID_ARG;
+    if (col > ((type == LCD_2004) ? LCD_2004_MAX_COL : LCD_1602_MAX_COL))
+        col = (type == LCD_2004) ? LCD_2004_MAX_COL : LCD_1602_MAX_COL;
+
+    esp_err_t res = _lcd_i2c_group_begin(group, &update, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    lcd_i2c_burst_write(&update.burst, LCD_DDRAM_ADDR + col + lcd_line[row], LCD_I2C_INSTRUCTION);
+
+    return _lcd_i2c_group_end(group, &update);
+}
+
+esp_err_t lcd_i2c_group_set_cursor(lcd_i2c_group_t *group, uint8_t col, uint8_t row)
+{
+    if ((group == NULL) || (group->members == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_group_set_cursor_until(group, col, row, i2cbus_deadline(group->members[0]->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_group_set_backlight_until(lcd_i2c_group_t *group, bool bkl_status, TickType_t deadline)
+{
+    lcd_i2c_group_update_t update;
+
+    esp_err_t res = _lcd_i2c_group_begin(group, &update, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    // expander latches differ in nothing but may be staged apart, each member 
+    // updates its own.
+    group->backlight = bkl_status;
+    for (int i = 0; i < group->count; i++) {
+        lcd_i2c_t *lcd = group->members[i];
+
+        lcd->backlight = bkl_status;
+        if (group->stale & (1UL << i))
+            continue;
+        esp_err_t err = pcf8574_update_until(&lcd->pcf, PCF8574_PIN(LCD_BIT_BKL), bkl_status ? 0xFF : 0x00, 
+                                             deadline);
+        if (err != ESP_OK)
+            _lcd_i2c_group_drop(group, i, err);
+    }
+
+    return _lcd_i2c_group_end(group, &update);
+}
+
+esp_err_t lcd_i2c_group_set_backlight(lcd_i2c_group_t *group, bool bkl_status)
+{
+    if ((group == NULL) || (group->members == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_group_set_backlight_until(group, bkl_status, i2cbus_deadline(group->members[0]->pcf.bus.time_out));
+}
+
+static esp_err_t _lcd_i2c_group_resync(lcd_i2c_group_t *group, TickType_t deadline, bool renew)
+{
+    esp_err_t res = ESP_OK;
+
+    for (int i = 0; (i < group->count) && (res != ESP_ERR_TIMEOUT); i++) {
+        lcd_i2c_t *lcd = group->members[i];
+
+        if (!(group->stale & (1UL << i)))
+            continue;
+
+        // a budget of its own for every member, the time taken by the previous 
+        // ones does not count against it.
+        if (renew)
+            deadline = i2cbus_deadline(I2C_TIMEOUT + DELAY_INIT / DELAY_MS);
+
+        // member may have lost power, it gets the power-on time before reset. 
+        // Nobody else drives it, the port is free for other devices meanwhile.
+        lcd->backlight = group->backlight;
+        ets_delay_us(DELAY_PWON);
+        esp_err_t err = lcd_i2c_reset_until(lcd, deadline);
+        if (err == ESP_OK)
+            err = i2cbus_prepay_quota_until(&lcd->pcf.bus, 0, 0, deadline);
+        if (err == ESP_OK)
+            err = i2cbus_lock(lcd->pcf.bus.port, deadline);
+        if (err == ESP_OK) {
+            // both lines whole, then the cursor, with group updates held off 
+            // until the member is back among them.
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            for (uint8_t line = 0; line < 2; line++) {
+                uint8_t addr = line ? GROUP_LINE2_ADDR : 0;
+                lcd_i2c_burst_write(&burst, LCD_DDRAM_ADDR + addr, LCD_I2C_INSTRUCTION);
+                for (int col = 0; col < GROUP_LINE_SIZE; col++)
+                    lcd_i2c_burst_write(&burst, group->ddram[addr + col], LCD_I2C_DATA);
+            }
+            lcd_i2c_burst_write(&burst, LCD_DDRAM_ADDR + group->ac, LCD_I2C_INSTRUCTION);
+            lcd_i2c_burst_flush(&burst);
+            err = burst.res;
+            if (err == ESP_OK)
+                group->stale &= ~(1UL << i);
+            i2cbus_unlock(lcd->pcf.bus.port);
+        }
+
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "display 0x%02x back in sync", lcd->pcf.bus.addr);
+        } else if (res == ESP_OK) {
+            res = (err == ESP_ERR_TIMEOUT) ? err : ESP_FAIL;
+        }
+    }
+    return res;
+}
+
+esp_err_t lcd_i2c_group_resync_until(lcd_i2c_group_t *group, TickType_t deadline)
+{
+    if ((group == NULL) || (group->members == NULL) || !group->count)
+        return ESP_ERR_INVALID_ARG;
+
+    return _lcd_i2c_group_resync(group, deadline, false);
+}
+
+esp_err_t lcd_i2c_group_resync(lcd_i2c_group_t *group)
+{
+    if ((group == NULL) || (group->members == NULL) || !group->count)
+        return ESP_ERR_INVALID_ARG;
+
+    return _lcd_i2c_group_resync(group, 0, true);
+}
@@ -0,0 +1,165 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file lcd_i2c_priv.h
+ * 
+ * @brief Internals shared by lcd_i2c sources, not part of the public API.
+ */
+#pragma once
+
+#include <stdarg.h>
+#include "esp_err.h"
+#include "lcd_i2c.h"
+#include "lcd_i2c_const.h"
+#include "lcd_i2c_group.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    lcd_i2c_t *lcd;             /*!< Display written, or encoding settings of a group */
+    lcd_i2c_group_t *group;     /*!< Group the burst fans out to, NULL for lcd alone */
+    TickType_t deadline;        /*!< Absolute deadline of every transaction */
+    esp_err_t res;              /*!< First failure, later bytes are dropped */
+    size_t count;               /*!< Expander writes in states */
+    uint8_t states[LCD_BURST_CHARS * (LCD_WAVE_STATES + LCD_WAVE_PAD_MAX)];   /*!< Encoded bytes */
+} lcd_i2c_burst_t;
+
+
+/**
+ * @brief Write one byte to the display.
+ * 
+ * @note Caller holds the display mutex.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param data instruction or character.
+ * @param lcd_reg register written.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t _lcd_i2c_write(lcd_i2c_t *lcd, uint8_t data, lcd_i2c_reg_t lcd_reg, TickType_t deadline);
+
+/**
+ * @brief Run the reset and set-up sequence of the controller.
+ * 
+ * @note Caller holds the display mutex or the port of a group.
+ * 
+ * @param lcd pointer to device configurations.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success
+ *     - ESP_ERR_TIMEOUT: deadline expired
+ *     - ESP_FAIL: fail to write, device not found
+ */
+esp_err_t lcd_i2c_reset_until(lcd_i2c_t *lcd, TickType_t deadline);
+
+/**
+ * @brief Encode one byte into a burst, sending the burst first when full.
+ * 
+ * Instructions that run long, clear and home, must not go through a burst.
+ * 
+ * @note Caller holds the display mutex until the burst is flushed.
+ * 
+ * @param burst burst, started with lcd, deadline and res set to ESP_OK.
+ * @param data instruction or character.
+ * @param lcd_reg register written.
+ */
+void lcd_i2c_burst_write(lcd_i2c_burst_t *burst, uint8_t data, lcd_i2c_reg_t lcd_reg);
+
+/**
+ * @brief Send what a burst holds in one transaction.
+ * 
+ * @note Caller holds the display mutex.
+ * 
+ * @param burst burst to send.
+ */
+void lcd_i2c_burst_flush(lcd_i2c_burst_t *burst);
+
+/**
+ * @brief Encode glyphs into a burst, to CGRAM from a slot on.
+ * 
+ * The address counter is left in CGRAM, a DDRAM address must be set before 
+ * writing characters again.
+ * 
+ * @note Caller holds the display mutex until the burst is flushed.
+ * 
+ * @param burst burst, started with lcd, deadline and res set to ESP_OK.
+ * @param slot first slot written, lesser than LCD_I2C_GLYPHS.
+ * @param glyphs rows of each glyph, 5 low bits per row, top row first.
+ * @param count glyphs to write, up to LCD_I2C_GLYPHS - slot.
+ */
+void lcd_i2c_burst_glyphs(lcd_i2c_burst_t *burst, uint8_t slot, const uint8_t (*glyphs)[LCD_I2C_GLYPH_ROWS], 
+                          size_t count);
+
+/**
+ * @brief Format text into a burst, as of lcd_i2c_printf().
+ * 
+ * @note Caller holds the display mutex until the burst is flushed.
+ * 
+ * @param burst burst, started with lcd, deadline and res set to ESP_OK.
+ * @param fmt format string.
+ * @param args arguments of fmt.
+ */
+void lcd_i2c_burst_format(lcd_i2c_burst_t *burst, const char *fmt, va_list args);
+
+/**
+ * @brief Follow a byte sent to a group in the content members show.
+ * 
+ * @param group pointer to group.
+ * @param data instruction or character.
+ * @param lcd_reg register written.
+ */
+void lcd_i2c_group_track(lcd_i2c_group_t *group, uint8_t data, lcd_i2c_reg_t lcd_reg);
+
+/**
+ * @brief Send encoded expander writes to every member of a group in sync.
+ * 
+ * A member that fails falls out of sync and gets nothing more until 
+ * lcd_i2c_group_resync().
+ * 
+ * @note Caller holds the port of the group with i2cbus_lock().
+ * 
+ * @param group pointer to group.
+ * @param states expander writes.
+ * @param count number of writes.
+ * @param deadline absolute deadline from i2cbus_deadline().
+ *
+ * @return 
+ *     - ESP_OK: success, at least a member still in sync
+ *     - ESP_FAIL: no member in sync
+ */
+esp_err_t lcd_i2c_group_send_until(lcd_i2c_group_t *group, const uint8_t *states, size_t count, 
+                                   TickType_t deadline);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,347 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file lcd_i2c_widget.c
+ * 
+ */
+#include <string.h>
+#include "lcd_i2c_widget.h"
+#include "lcd_i2c_priv.h"
+
+#define WIDGET_COLS_MAX     20      /*!< Columns of the widest display */
+#define WIDGET_ROWS_MAX     4       /*!< Rows of the tallest display */
+#define WIDGET_FULL         0xFF    /*!< Full block of character ROM */
+#define WIDGET_HBAR_STEPS   5       /*!< Pixel columns of a cell */
+#define WIDGET_VBAR_STEPS   8       /*!< Pixel rows of a cell */
+#define WIDGET_DIGIT_COLS   4       /*!< Columns of a big digit and its gap */
+#define WIDGET_GLYPHS(set)  (sizeof(set) / sizeof(set[0]))
+
+// horizontal bar cells 1 to 4 columns full, then big digit strokes: top, 
+// bottom and both bars.
+#define GLYPH_HBAR  0
+#define GLYPH_TOP   4
+#define GLYPH_BOT   5
+#define GLYPH_BOTH  6
+
+static const uint8_t lcd_glyphs_hbar[][LCD_I2C_GLYPH_ROWS] = {
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+    {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+};
+
+// vertical bar cells 1 to 7 rows full.
+static const uint8_t lcd_glyphs_vbar[][LCD_I2C_GLYPH_ROWS] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+};
+
+// seven segments of big digits, bit 0 to 6 are a to g.
+#define SEG_A   0x01
+#define SEG_B   0x02
+#define SEG_C   0x04
+#define SEG_D   0x08
+#define SEG_E   0x10
+#define SEG_F   0x20
+#define SEG_G   0x40
+
+static const uint8_t lcd_segments[] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+
+typedef uint8_t lcd_i2c_cells_t[WIDGET_ROWS_MAX][WIDGET_COLS_MAX];
+
+static void _lcd_i2c_widget_size(const lcd_i2c_widget_t *widget, uint8_t *cols, uint8_t *rows)
+{
+    switch (widget->type) {
+        case LCD_WIDGET_HBAR:
+            *cols = widget->size;
+            *rows = 1;
+            break;
+        case LCD_WIDGET_VBAR:
+            *cols = 1;
+            *rows = widget->size;
+            break;
+        default:
+            *cols = (widget->size * WIDGET_DIGIT_COLS) - 1;
+            *rows = (widget->type == LCD_WIDGET_BIG4) ? 4 : 2;
+            break;
+    }
+}
+
+static esp_err_t _lcd_i2c_widget_place(lcd_i2c_widget_t *widget, lcd_i2c_t *lcd, lcd_i2c_widget_type_t type, 
+                                       uint8_t col, uint8_t row, uint8_t size)
+{
+    uint8_t cols, rows;
+
+    if ((widget == NULL) || (lcd == NULL) || !size)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(widget, 0, sizeof(lcd_i2c_widget_t));
+    widget->lcd = lcd;
+    widget->type = type;
+    widget->col = col;
+    widget->row = row;
+    widget->size = size;
+    _lcd_i2c_widget_size(widget, &cols, &rows);
+
+    // widget must be on display as a whole.
+    uint8_t lcd_cols = (lcd->type == LCD_2004) ? 20 : 16;
+    uint8_t lcd_rows = (lcd->type == LCD_2004) ? 4 : 2;
+    if (((col + cols) > lcd_cols) || ((row + rows) > lcd_rows))
+        return ESP_ERR_INVALID_ARG;
+
+    return ESP_OK;
+}
+
+// a bar cell with fill steps of full steps lit.
+static uint8_t _lcd_i2c_bar_cell(int32_t fill, int32_t steps)
+{
+    if (fill <= 0)
+        return ' ';
+    if (fill >= steps)
+        return WIDGET_FULL;
+    return LCD_I2C_GLYPH(fill - 1);
+}
+
+static void _lcd_i2c_bar_render(const lcd_i2c_widget_t *widget, int32_t value, lcd_i2c_cells_t cells)
+{
+    int32_t steps = (widget->type == LCD_WIDGET_HBAR) ? WIDGET_HBAR_STEPS : WIDGET_VBAR_STEPS;
+
+    if (value < widget->min)
+        value = widget->min;
+    if (value > widget->max)
+        value = widget->max;
+    int32_t level = (((int64_t)value - widget->min) * widget->size * steps) / ((int64_t)widget->max - widget->min);
+
+    for (int i = 0; i < widget->size; i++) {
+        if (widget->type == LCD_WIDGET_HBAR)
+            cells[0][i] = _lcd_i2c_bar_cell(level - (i * steps), steps);
+        else
+            cells[widget->size - 1 - i][0] = _lcd_i2c_bar_cell(level - (i * steps), steps);
+    }
+}
+
+// a stroke cell with top and bottom bars.
+static uint8_t _lcd_i2c_big_bars(bool top, bool bottom)
+{
+    if (top && bottom)
+        return LCD_I2C_GLYPH(GLYPH_BOTH);
+    if (top)
+        return LCD_I2C_GLYPH(GLYPH_TOP);
+    if (bottom)
+        return LCD_I2C_GLYPH(GLYPH_BOT);
+    return ' ';
+}
+
+// a digit 3 columns wide: left and right columns are full where a vertical 
+// segment runs, bars elsewhere.
+static void _lcd_i2c_big_digit(uint8_t seg, bool tall, lcd_i2c_cells_t cells, int col)
+{
+    uint8_t bars[4][2];
+    int rows = 2;
+
+    if (tall) {
+        // a on top, g under the upper half and d at the bottom.
+        bars[0][0] = seg & SEG_A; bars[0][1] = 0;
+        bars[1][0] = 0;           bars[1][1] = seg & SEG_G;
+        bars[2][0] = 0;           bars[2][1] = 0;
+        bars[3][0] = 0;           bars[3][1] = seg & SEG_D;
+        rows = 4;
+    } else {
+        // a and g share the upper half.
+        bars[0][0] = seg & SEG_A; bars[0][1] = seg & SEG_G;
+        bars[1][0] = 0;           bars[1][1] = seg & SEG_D;
+    }
+
+    for (int row = 0; row < rows; row++) {
+        bool upper = row < (rows / 2);
+        uint8_t bar = _lcd_i2c_big_bars(bars[row][0], bars[row][1]);
+
+        cells[row][col] = (seg & (upper ? SEG_F : SEG_E)) ? WIDGET_FULL : bar;
+        cells[row][col + 1] = bar;
+        cells[row][col + 2] = (seg & (upper ? SEG_B : SEG_C)) ? WIDGET_FULL : bar;
+        if ((col + 3) < WIDGET_COLS_MAX)
+            cells[row][col + 3] = ' ';
+    }
+}
+
+static void _lcd_i2c_big_render(const lcd_i2c_widget_t *widget, int32_t value, lcd_i2c_cells_t cells)
+{
+    uint8_t seg[LCD_WIDGET_BIG_DIGITS_MAX] = {0};
+    uint32_t mag = (value < 0) ? (0U - (uint32_t)value) : (uint32_t)value;
+    int pos = widget->size;
+
+    // right aligned digits, then the sign.
+    do {
+        if (!pos)
+            break;
+        seg[--pos] = lcd_segments[mag % 10];
+        mag /= 10;
+    } while (mag);
+    if (mag || ((value < 0) && !pos))
+        memset(seg, SEG_G, widget->size);
+    else if (value < 0)
+        seg[--pos] = SEG_G;
+
+    for (int i = 0; i < widget->size; i++)
+        _lcd_i2c_big_digit(seg[i], widget->type == LCD_WIDGET_BIG4, cells, i * WIDGET_DIGIT_COLS);
+}
+
+static void _lcd_i2c_widget_render(const lcd_i2c_widget_t *widget, int32_t value, lcd_i2c_cells_t cells)
+{
+    if ((widget->type == LCD_WIDGET_HBAR) || (widget->type == LCD_WIDGET_VBAR))
+        _lcd_i2c_bar_render(widget, value, cells);
+    else
+        _lcd_i2c_big_render(widget, value, cells);
+}
+
+esp_err_t lcd_i2c_bar_init(lcd_i2c_widget_t *widget, lcd_i2c_t *lcd, lcd_i2c_widget_type_t type, uint8_t col, 
+                           uint8_t row, uint8_t size, int32_t min, int32_t max)
+{
+    if (((type != LCD_WIDGET_HBAR) && (type != LCD_WIDGET_VBAR)) || (min >= max))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = _lcd_i2c_widget_place(widget, lcd, type, col, row, size);
+    if (res != ESP_OK)
+        return res;
+
+    widget->min = min;
+    widget->max = max;
+    return ESP_OK;
+}
+
+esp_err_t lcd_i2c_big_init(lcd_i2c_widget_t *widget, lcd_i2c_t *lcd, lcd_i2c_widget_type_t type, uint8_t col, 
+                           uint8_t row, uint8_t digits)
+{
+    if (((type != LCD_WIDGET_BIG2) && (type != LCD_WIDGET_BIG4)) || (digits > LCD_WIDGET_BIG_DIGITS_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    return _lcd_i2c_widget_place(widget, lcd, type, col, row, digits);
+}
+
+esp_err_t lcd_i2c_widget_update_until(lcd_i2c_widget_t *widget, int32_t value, TickType_t deadline)
+{
+    esp_err_t res = ESP_ERR_INVALID_ARG;
+
+    if ((widget != NULL) && (widget->lcd != NULL)) {
+        lcd_i2c_t *lcd = widget->lcd;
+        lcd_i2c_cells_t old_cells, new_cells;
+        uint8_t cols, rows;
+
+        const uint8_t (*glyphs)[LCD_I2C_GLYPH_ROWS] = (widget->type == LCD_WIDGET_VBAR) ? 
+                                                       lcd_glyphs_vbar : lcd_glyphs_hbar;
+        if (widget->drawn && (value == widget->value) && (lcd->glyphs == glyphs))
+            return ESP_OK;
+
+        // render both values, cells that differ are the ones to send.
+        _lcd_i2c_widget_size(widget, &cols, &rows);
+        _lcd_i2c_widget_render(widget, value, new_cells);
+        if (widget->drawn)
+            _lcd_i2c_widget_render(widget, widget->value, old_cells);
+        
+        // See if we can obtain the semaphore.  If the semaphore is not available
+        // wait until the deadline to see if it becomes free.
+        if (xSemaphoreTake(lcd->pcf.bus.mutex, i2cbus_remaining(deadline)) == pdTRUE) {
+            // We were able to obtain the semaphore and can now access the
+            // shared resource.
+
+            lcd_i2c_burst_t burst = {.lcd = lcd, .deadline = deadline, .res = ESP_OK};
+            bool drawn = widget->drawn;
+
+            // glyph set goes once per display, cells follow in the same burst. 
+            // Another set changed the cells of this widget, all are sent.
+            if (lcd->glyphs != glyphs) {
+                lcd_i2c_burst_glyphs(&burst, 0, glyphs, (glyphs == lcd_glyphs_vbar) ? 
+                                     WIDGET_GLYPHS(lcd_glyphs_vbar) : WIDGET_GLYPHS(lcd_glyphs_hbar));
+                lcd->glyphs = glyphs;
+                drawn = false;
+            }
+
+            // one run per row from first to last changed cell.
+            for (int row = 0; row < rows; row++) {
+                int first = 0, last = cols - 1;
+
+                if (drawn) {
+                    while ((first < cols) && (old_cells[row][first] == new_cells[row][first]))
+                        first++;
+                    while ((last > first) && (old_cells[row][last] == new_cells[row][last]))
+                        last--;
+                    if (first == cols)
+                        continue;
+                }
+
+                uint8_t addr = widget->col + first + lcd_line[widget->row + row];
+                lcd_i2c_burst_write(&burst, LCD_DDRAM_ADDR + addr, LCD_I2C_INSTRUCTION);
+                for (int col = first; col <= last; col++)
+                    lcd_i2c_burst_write(&burst, new_cells[row][col], LCD_I2C_DATA);
+            }
+            lcd_i2c_burst_flush(&burst);
+            res = burst.res;
+
+            if (res == ESP_OK) {
+                widget->value = value;
+                widget->drawn = true;
+            } else {
+                // cells on display are unknown, and so is CGRAM.
+                widget->drawn = false;
+                lcd->glyphs = NULL;
+            }
+            
+            // We have finished accessing the shared resource.  Release the
+            // semaphore.
+            xSemaphoreGive(lcd->pcf.bus.mutex);
+        }
+        else {
+            // We could not obtain the semaphore and can therefore not access
+            // the shared resource safely.
+            res = ESP_ERR_TIMEOUT;
+        }
+    }
+    return res;
+}
+
+esp_err_t lcd_i2c_widget_update(lcd_i2c_widget_t *widget, int32_t value)
+{
+    if ((widget == NULL) || (widget->lcd == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    return lcd_i2c_widget_update_until(widget, value, i2cbus_deadline(widget->lcd->pcf.bus.time_out));
+}
+
+esp_err_t lcd_i2c_widget_invalidate(lcd_i2c_widget_t *widget)
+{
+    if (widget == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    widget->drawn = false;
+    return ESP_OK;
+}
@@ -0,0 +1,299 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pcf8574.h
+ * @defgroup pcf8574 pcf8574
+ * @{
+ *
+ * @brief PCF8574 and PCF8574A quasi-bidirectional GPIO expander.
+ * 
+ * The output latch is kept in a shadow, so pin updates never read the port 
+ * back and updates that change nothing stay off the bus. Shadow updates and 
+ * their write run under the port lock, pins changed from several tasks never 
+ * undo each other.
+ * 
+ * Pins used as inputs must have their latch bit set. With the INT line wired 
+ * and set by pcf8574_set_int_pin(), input reads come from a cache until the 
+ * expander signals a change.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "i2cbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCF8574_ADDR(a2a1a0)    (0x20 | ((a2a1a0) & 0x07))  /*!< PCF8574 address from A2..A0 pins */
+#define PCF8574A_ADDR(a2a1a0)   (0x38 | ((a2a1a0) & 0x07))  /*!< PCF8574A address from A2..A0 pins */
+#define PCF8574_PIN(pin)        (1 << (pin))                /*!< Mask of a single pin */
+
+typedef struct
+{
+    i2cbus_t bus;               /*!< Device on bus */
+    uint8_t latch;              /*!< Output latch shadow */
+    uint8_t staged;             /*!< Latch wanted, with staged pin updates */
+    bool synced;                /*!< Shadow was written to device at least once */
+    uint8_t input;              /*!< Cached port read */
+    uint8_t input_latch;        /*!< Latch when port was read */
+    bool input_valid;           /*!< Port was read at least once */
+    gpio_num_t int_pin;         /*!< INT line, GPIO_NUM_NC when not wired */
+    volatile bool int_pending;  /*!< INT fired since last port read */
+    portMUX_TYPE lock;          /*!< Guards staged latch */
+} pcf8574_t;
+
+
+/**
+ * @brief Create a new expander on bus.
+ * 
+ * @note Nothing is written, the shadow starts at the power-on latch 0xFF and 
+ *       the first write or flush always reaches the device.
+ * 
+ * @param pcf pointer to expander.
+ * @param port I2C port number lesser than I2C_NUM_MAX.
+ * @param addr device address, see PCF8574_ADDR() and PCF8574A_ADDR().
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_NOT_FOUND: a scan of port did not find device.
+ *     - ESP_FAIL: fail to start.
+ */
+esp_err_t pcf8574_init(pcf8574_t *pcf, i2c_port_t port, uint8_t addr);
+
+
+/**
+ * @brief Delete an expander.
+ * 
+ * @note An INT line set by pcf8574_set_int_pin() must be released first.
+ * 
+ * @param pcf pointer to expander.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: device is busy.
+ */
+esp_err_t pcf8574_delete(pcf8574_t *pcf);
+
+
+/**
+ * @brief Write whole output latch before a deadline.
+ * 
+ * @param pcf pointer to expander.
+ * @param value latch value, set bits for inputs and high outputs.
+ * @param deadline absolute deadline.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to write, device not found.
+ */
+esp_err_t pcf8574_write_until(pcf8574_t *pcf, uint8_t value, TickType_t deadline);
+
+
+/**
+ * @brief Write whole output latch.
+ * 
+ * @param pcf pointer to expander.
+ * @param value latch value, set bits for inputs and high outputs.
+ *
+ * @return see pcf8574_write_until().
+ */
+esp_err_t pcf8574_write(pcf8574_t *pcf, uint8_t value);
+
+
+/**
+ * @brief Stage pin updates without bus access.
+ * 
+ * @note Staged updates from any task are written together by the next 
+ *       flush or update, in one byte.
+ * 
+ * @param pcf pointer to expander.
+ * @param mask pins to change.
+ * @param value new level of pins in mask.
+ */
+void pcf8574_stage(pcf8574_t *pcf, uint8_t mask, uint8_t value);
+
+
+/**
+ * @brief Write staged pin updates before a deadline.
+ * 
+ * @param pcf pointer to expander.
+ * @param deadline absolute deadline.
+ *
+ * @return 
+ *     - ESP_OK: success, nothing written if latch is unchanged.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to write, device not found.
+ */
+esp_err_t pcf8574_flush_until(pcf8574_t *pcf, TickType_t deadline);
+
+
+/**
+ * @brief Write staged pin updates.
+ * 
+ * @param pcf pointer to expander.
+ *
+ * @return see pcf8574_flush_until().
+ */
+esp_err_t pcf8574_flush(pcf8574_t *pcf);
+
+
+/**
+ * @brief Update pins and write them with any staged update before a deadline.
+ * 
+ * @param pcf pointer to expander.
+ * @param mask pins to change.
+ * @param value new level of pins in mask.
+ * @param deadline absolute deadline.
+ *
+ * @return see pcf8574_flush_until().
+ */
+esp_err_t pcf8574_update_until(pcf8574_t *pcf, uint8_t mask, uint8_t value, TickType_t deadline);
+
+
+/**
+ * @brief Update pins and write them with any staged update.
+ * 
+ * @param pcf pointer to expander.
+ * @param mask pins to change.
+ * @param value new level of pins in mask.
+ *
+ * @return see pcf8574_flush_until().
+ */
+esp_err_t pcf8574_update(pcf8574_t *pcf, uint8_t mask, uint8_t value);
+
+
+/**
+ * @brief Set a single pin.
+ * 
+ * @param pcf pointer to expander.
+ * @param pin pin number, 0 to 7.
+ * @param level pin level, high also makes it an input.
+ *
+ * @return see pcf8574_flush_until().
+ */
+esp_err_t pcf8574_set_pin(pcf8574_t *pcf, uint8_t pin, bool level);
+
+
+/**
+ * @brief Write a sequence of latch values in one transaction before a deadline.
+ * 
+ * @note The device latches every byte it acknowledges, so each value holds 
+ *       for one byte time on the wire, 90 us at 100 kHz. It bit-bangs strobes 
+ *       such as an LCD enable line with one start, address and stop overall.
+ * 
+ * @param pcf pointer to expander.
+ * @param states latch values, in order.
+ * @param count number of values.
+ * @param deadline absolute deadline.
+ *
+ * @return 
+ *     - ESP_OK: success, the last value is the new latch.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to write, device not found.
+ */
+esp_err_t pcf8574_write_wave_until(pcf8574_t *pcf, const uint8_t *states, size_t count, TickType_t deadline);
+
+
+/**
+ * @brief Write a sequence of latch values in one transaction.
+ * 
+ * @param pcf pointer to expander.
+ * @param states latch values, in order.
+ * @param count number of values.
+ *
+ * @return see pcf8574_write_wave_until().
+ */
+esp_err_t pcf8574_write_wave(pcf8574_t *pcf, const uint8_t *states, size_t count);
+
+
+/**
+ * @brief Read port levels before a deadline.
+ * 
+ * @note With INT line set, the bus is only read after INT fires or after 
+ *       output pins are released to inputs, otherwise the cached levels are 
+ *       returned.
+ * 
+ * @param pcf pointer to expander.
+ * @param value receives levels of all pins.
+ * @param deadline absolute deadline.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_TIMEOUT: deadline expired.
+ *     - ESP_FAIL: fail to read, device not found.
+ */
+esp_err_t pcf8574_read_until(pcf8574_t *pcf, uint8_t *value, TickType_t deadline);
+
+
+/**
+ * @brief Read port levels.
+ * 
+ * @param pcf pointer to expander.
+ * @param value receives levels of all pins.
+ *
+ * @return see pcf8574_read_until().
+ */
+esp_err_t pcf8574_read(pcf8574_t *pcf, uint8_t *value);
+
+
+/**
+ * @brief Enable input cache driven by expander INT line.
+ * 
+ * @note The GPIO ISR service must be installed by gpio_install_isr_service().
+ *       Not available on host builds.
+ * 
+ * @param pcf pointer to expander.
+ * @param int_pin GPIO wired to INT, GPIO_NUM_NC to disable cache.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_FAIL: fail to set GPIO or its interrupt.
+ */
+esp_err_t pcf8574_set_int_pin(pcf8574_t *pcf, gpio_num_t int_pin);
+
+
+/**
+ * @brief Signal an INT falling edge, cached input is read again.
+ * 
+ * @note Safe from interrupts, for INT lines handled by the application.
+ * 
+ * @param pcf pointer to expander.
+ */
+void pcf8574_int_notify(pcf8574_t *pcf);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,269 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pcf8574.c
+ * 
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "pcf8574.h"
+
+static const char *TAG = "pcf8574";
+
+// caller holds port lock, shadow and device latch change together.
+static esp_err_t _pcf8574_write(pcf8574_t *pcf, const uint8_t *states, size_t count, TickType_t deadline)
+{
+    esp_err_t res = i2cbus_write_until(&pcf->bus, (uint8_t *)states, count, deadline);
+
+    // device may have latched part of sequence, next write must reach it.
+    if (res != ESP_OK) {
+        pcf->synced = false;
+        return res;
+    }
+
+    pcf->latch = states[count - 1];
+    pcf->synced = true;
+    return ESP_OK;
+}
+
+// cache holds while INT is quiet and no pin was released to input after 
+// the read, pins driven low read low anyway.
+static bool _pcf8574_cached(const pcf8574_t *pcf)
+{
+    return (pcf->int_pin != GPIO_NUM_NC) && pcf->input_valid && !pcf->int_pending && 
+           !(pcf->latch & ~pcf->input_latch);
+}
+
+esp_err_t pcf8574_init(pcf8574_t *pcf, i2c_port_t port, uint8_t addr)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(pcf, 0, sizeof(pcf8574_t));
+    portMUX_INITIALIZE(&pcf->lock);
+    pcf->latch = 0xFF;
+    pcf->staged = 0xFF;
+    pcf->int_pin = GPIO_NUM_NC;
+
+    esp_err_t res = i2cbus_create(&pcf->bus, port, addr);
+    if (res != ESP_OK)
+        return res;
+
+    ESP_LOGI(TAG, "expander 0x%02x on port %d", addr, port);
+    return ESP_OK;
+}
+
+esp_err_t pcf8574_delete(pcf8574_t *pcf)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return i2cbus_delete(&pcf->bus);
+}
+
+esp_err_t pcf8574_write_until(pcf8574_t *pcf, uint8_t value, TickType_t deadline)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    // a quota is paid before the port is taken, it may defer the write.
+    esp_err_t res = i2cbus_prepay_quota_until(&pcf->bus, 1, 0, deadline);
+    if (res == ESP_OK)
+        res = i2cbus_lock(pcf->bus.port, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    // whole latch is written, staged updates are overridden.
+    portENTER_CRITICAL(&pcf->lock);
+    pcf->staged = value;
+    portEXIT_CRITICAL(&pcf->lock);
+
+    res = _pcf8574_write(pcf, &value, 1, deadline);
+    i2cbus_unlock(pcf->bus.port);
+    return res;
+}
+
+esp_err_t pcf8574_write(pcf8574_t *pcf, uint8_t value)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_write_until(pcf, value, i2cbus_deadline(pcf->bus.time_out));
+}
+
+IRAM_ATTR void pcf8574_stage(pcf8574_t *pcf, uint8_t mask, uint8_t value)
+{
+    if (pcf == NULL)
+        return;
+
+    portENTER_CRITICAL_SAFE(&pcf->lock);
+    pcf->staged = (pcf->staged & ~mask) | (value & mask);
+    portEXIT_CRITICAL_SAFE(&pcf->lock);
+}
+
+esp_err_t pcf8574_flush_until(pcf8574_t *pcf, TickType_t deadline)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&pcf->lock);
+    uint8_t value = pcf->staged;
+    portEXIT_CRITICAL(&pcf->lock);
+
+    // a flush that writes nothing pays nothing. The latch is only looked at 
+    // here, a write found needed once the port is held goes into debt.
+    esp_err_t res = ESP_OK;
+    if (!pcf->synced || (value != pcf->latch))
+        res = i2cbus_prepay_quota_until(&pcf->bus, 1, 0, deadline);
+    if (res == ESP_OK)
+        res = i2cbus_lock(pcf->bus.port, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    portENTER_CRITICAL(&pcf->lock);
+    value = pcf->staged;
+    portEXIT_CRITICAL(&pcf->lock);
+
+    // updates that cancel out or repeat the latch cost no transaction.
+    if (!pcf->synced || (value != pcf->latch))
+        res = _pcf8574_write(pcf, &value, 1, deadline);
+
+    i2cbus_unlock(pcf->bus.port);
+    return res;
+}
+
+esp_err_t pcf8574_flush(pcf8574_t *pcf)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_flush_until(pcf, i2cbus_deadline(pcf->bus.time_out));
+}
+
+esp_err_t pcf8574_update_until(pcf8574_t *pcf, uint8_t mask, uint8_t value, TickType_t deadline)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    pcf8574_stage(pcf, mask, value);
+    return pcf8574_flush_until(pcf, deadline);
+}
+
+esp_err_t pcf8574_update(pcf8574_t *pcf, uint8_t mask, uint8_t value)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_update_until(pcf, mask, value, i2cbus_deadline(pcf->bus.time_out));
+}
+
+esp_err_t pcf8574_set_pin(pcf8574_t *pcf, uint8_t pin, bool level)
+{
+    if ((pcf == NULL) || (pin > 7))
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_update(pcf, PCF8574_PIN(pin), level ? 0xFF : 0x00);
+}
+
+esp_err_t pcf8574_write_wave_until(pcf8574_t *pcf, const uint8_t *states, size_t count, TickType_t deadline)
+{
+    if ((pcf == NULL) || (states == NULL) || !count)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = i2cbus_prepay_quota_until(&pcf->bus, count, 0, deadline);
+    if (res == ESP_OK)
+        res = i2cbus_lock(pcf->bus.port, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    // sequence ends on a full latch value, staged updates are overridden.
+    portENTER_CRITICAL(&pcf->lock);
+    pcf->staged = states[count - 1];
+    portEXIT_CRITICAL(&pcf->lock);
+
+    res = _pcf8574_write(pcf, states, count, deadline);
+    i2cbus_unlock(pcf->bus.port);
+    return res;
+}
+
+esp_err_t pcf8574_write_wave(pcf8574_t *pcf, const uint8_t *states, size_t count)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_write_wave_until(pcf, states, count, i2cbus_deadline(pcf->bus.time_out));
+}
+
+esp_err_t pcf8574_read_until(pcf8574_t *pcf, uint8_t *value, TickType_t deadline)
+{
+    if ((pcf == NULL) || (value == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = ESP_OK;
+    if (!_pcf8574_cached(pcf))
+        res = i2cbus_prepay_quota_until(&pcf->bus, 0, 1, deadline);
+    if (res == ESP_OK)
+        res = i2cbus_lock(pcf->bus.port, deadline);
+    if (res != ESP_OK)
+        return res;
+
+    if (_pcf8574_cached(pcf)) {
+        *value = pcf->input & pcf->latch;
+        i2cbus_unlock(pcf->bus.port);
+        return ESP_OK;
+    }
+
+    // clear before reading, an edge during the read is not lost.
+    pcf->int_pending = false;
+    res = i2cbus_read_until(&pcf->bus, &pcf->input, 1, deadline);
+    if (res == ESP_OK) {
+        pcf->input_latch = pcf->latch;
+        pcf->input_valid = true;
+        *value = pcf->input;
+    }
+    else {
+        pcf->input_valid = false;
+    }
+
+    i2cbus_unlock(pcf->bus.port);
+    return res;
+}
+
+esp_err_t pcf8574_read(pcf8574_t *pcf, uint8_t *value)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    return pcf8574_read_until(pcf, value, i2cbus_deadline(pcf->bus.time_out));
+}
+
+IRAM_ATTR void pcf8574_int_notify(pcf8574_t *pcf)
+{
+    if (pcf != NULL)
+        pcf->int_pending = true;
+}
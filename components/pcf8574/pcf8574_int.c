@@ -0,0 +1,69 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pcf8574_int.c
+ * 
+ */
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "driver/gpio.h"
+#include "pcf8574.h"
+
+static IRAM_ATTR void _pcf8574_int_isr(void *arg)
+{
+    pcf8574_int_notify((pcf8574_t *)arg);
+}
+
+esp_err_t pcf8574_set_int_pin(pcf8574_t *pcf, gpio_num_t int_pin)
+{
+    if (pcf == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    // release line set before.
+    if (pcf->int_pin != GPIO_NUM_NC) {
+        gpio_isr_handler_remove(pcf->int_pin);
+        pcf->int_pin = GPIO_NUM_NC;
+    }
+
+    if (int_pin == GPIO_NUM_NC)
+        return ESP_OK;
+
+    // INT is open drain and active low, it falls when an input changes.
+    gpio_config_t conf = {
+        .pin_bit_mask = 1ULL << int_pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+
+    if ((gpio_config(&conf) != ESP_OK) || (gpio_isr_handler_add(int_pin, _pcf8574_int_isr, pcf) != ESP_OK))
+        return ESP_FAIL;
+
+    // levels read before INT was watched can't be trusted.
+    pcf->int_pending = true;
+    pcf->int_pin = int_pin;
+    return ESP_OK;
+}
@@ -0,0 +1,193 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file sample_fifo.h
+ * @defgroup sample_fifo sample_fifo
+ * @{
+ *
+ * @brief Lock-free FIFO of fixed size samples with 64-bit timestamps.
+ * 
+ * One producer writes samples and never blocks: when the ring is full the 
+ * oldest samples are overwritten. Any number of readers follow the producer, 
+ * each with its own position, and drain samples in place with 
+ * sample_fifo_peek() and sample_fifo_commit(). A reader that was lapped by 
+ * the producer counts the lost samples as overruns.
+ */
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bytes taken by one sample in the ring, timestamp included.
+ */
+#define SAMPLE_FIFO_SLOT_SIZE(sample_size)  ((sizeof(int64_t) + (sample_size) + 7) & ~(size_t)7)
+
+/**
+ * @brief Size in bytes of a ring buffer holding depth samples.
+ */
+#define SAMPLE_FIFO_BUF_SIZE(sample_size, depth)  (SAMPLE_FIFO_SLOT_SIZE(sample_size) * (depth))
+
+/**
+ * @brief Sample at position i of a batch returned by sample_fifo_peek().
+ */
+#define SAMPLE_FIFO_AT(fifo, first, i)  \
+    ((const sample_fifo_sample_t *)((const uint8_t *)(first) + ((i) * (fifo)->slot_size)))
+
+typedef struct
+{
+    int64_t timestamp;          /*!< esp_timer time of sample */
+    uint8_t data[];             /*!< Sample bytes */
+} sample_fifo_sample_t;
+
+typedef struct
+{
+    uint8_t *buf;               /*!< Ring storage */
+    size_t sample_size;         /*!< Data bytes of each sample */
+    size_t slot_size;           /*!< Ring bytes of each sample */
+    uint32_t depth;             /*!< Ring depth in samples, power of two */
+    volatile uint32_t claimed;  /*!< Samples the producer started to write */
+    volatile uint32_t head;     /*!< Samples published */
+} sample_fifo_t;
+
+typedef struct
+{
+    sample_fifo_t *fifo;        /*!< FIFO followed by reader */
+    uint32_t tail;              /*!< Next sample to drain */
+    uint32_t overruns;          /*!< Samples lost before being drained */
+} sample_fifo_reader_t;
+
+
+/**
+ * @brief Initiate a FIFO on caller storage.
+ * 
+ * @param fifo pointer to FIFO.
+ * @param buf 8 byte aligned storage of SAMPLE_FIFO_BUF_SIZE(sample_size, depth) bytes.
+ * @param sample_size data bytes of each sample.
+ * @param depth number of samples, power of two.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t sample_fifo_init(sample_fifo_t *fifo, void *buf, size_t sample_size, size_t depth);
+
+
+/**
+ * @brief Get the data slot of next sample to fill in place.
+ * 
+ * @note Producer only. The sample is visible to readers after 
+ *       sample_fifo_publish(), a claim not published is dropped by next claim.
+ * 
+ * @param fifo pointer to FIFO.
+ *
+ * @return pointer to sample_size bytes of sample data.
+ */
+uint8_t *sample_fifo_claim(sample_fifo_t *fifo);
+
+
+/**
+ * @brief Publish the sample filled after sample_fifo_claim().
+ * 
+ * @param fifo pointer to FIFO.
+ * @param timestamp esp_timer time of sample.
+ */
+void sample_fifo_publish(sample_fifo_t *fifo, int64_t timestamp);
+
+
+/**
+ * @brief Copy a sample into FIFO and publish it.
+ * 
+ * @param fifo pointer to FIFO.
+ * @param timestamp esp_timer time of sample.
+ * @param data sample_size bytes of sample data.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t sample_fifo_push(sample_fifo_t *fifo, int64_t timestamp, const void *data);
+
+
+/**
+ * @brief Attach a reader to FIFO, it starts at the next published sample.
+ * 
+ * @param reader pointer to reader.
+ * @param fifo pointer to FIFO.
+ *
+ * @return 
+ *     - ESP_OK: success.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ */
+esp_err_t sample_fifo_reader_init(sample_fifo_reader_t *reader, sample_fifo_t *fifo);
+
+
+/**
+ * @brief Number of samples waiting for reader.
+ * 
+ * @param reader pointer to reader.
+ *
+ * @return samples published and not drained yet, up to FIFO depth.
+ */
+size_t sample_fifo_available(sample_fifo_reader_t *reader);
+
+
+/**
+ * @brief Get a batch of samples in place, without copying them.
+ * 
+ * @note Samples of a batch are contiguous in ring, use SAMPLE_FIFO_AT() to 
+ *       walk them and sample_fifo_commit() to release them.
+ * 
+ * @param reader pointer to reader.
+ * @param first receives the oldest sample waiting for reader.
+ * @param max maximum number of samples in batch.
+ *
+ * @return number of samples in batch.
+ */
+size_t sample_fifo_peek(sample_fifo_reader_t *reader, const sample_fifo_sample_t **first, size_t max);
+
+
+/**
+ * @brief Release samples got by sample_fifo_peek().
+ * 
+ * @param reader pointer to reader.
+ * @param count number of samples consumed from batch.
+ *
+ * @return 
+ *     - ESP_OK: success, samples were intact while they were being used.
+ *     - ESP_ERR_INVALID_ARG: invalid argument.
+ *     - ESP_ERR_INVALID_STATE: producer overwrote part of batch, the samples 
+ *       used must be discarded and they are counted as overruns.
+ */
+esp_err_t sample_fifo_commit(sample_fifo_reader_t *reader, size_t count);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
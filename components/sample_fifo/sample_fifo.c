@@ -0,0 +1,161 @@
+/* 
+ * MIT License
+ * 
+ * Copyright (c) 2022 https://github.com/MuriloAM
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file sample_fifo.c
+ * 
+ */
+#include <string.h>
+#include "esp_err.h"
+#include "sample_fifo.h"
+
+// LOCAL MACROS
+#define SAMPLE_SLOT(fifo, n)    ((sample_fifo_sample_t *)((fifo)->buf + (((n) & ((fifo)->depth - 1)) * (fifo)->slot_size)))
+
+esp_err_t sample_fifo_init(sample_fifo_t *fifo, void *buf, size_t sample_size, size_t depth)
+{
+    if (!fifo || !buf || !sample_size)
+        return ESP_ERR_INVALID_ARG;
+
+    // depth must be a power of two so positions keep mapping to the same slot 
+    // across counter overflow.
+    if (!depth || (depth & (depth - 1)) || (depth > (UINT32_MAX / 2)))
+        return ESP_ERR_INVALID_ARG;
+
+    if ((uintptr_t)buf & 7)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(fifo, 0, sizeof(sample_fifo_t));
+    fifo->buf = buf;
+    fifo->sample_size = sample_size;
+    fifo->slot_size = SAMPLE_FIFO_SLOT_SIZE(sample_size);
+    fifo->depth = depth;
+
+    return ESP_OK;
+}
+
+uint8_t *sample_fifo_claim(sample_fifo_t *fifo)
+{
+    uint32_t head = fifo->head;
+
+    // tell readers the slot of the oldest sample is about to be overwritten, 
+    // before touching it.
+    __atomic_store_n(&fifo->claimed, head + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return SAMPLE_SLOT(fifo, head)->data;
+}
+
+void sample_fifo_publish(sample_fifo_t *fifo, int64_t timestamp)
+{
+    uint32_t head = fifo->head;
+
+    SAMPLE_SLOT(fifo, head)->timestamp = timestamp;
+    // sample becomes visible only after it is completely written.
+    __atomic_store_n(&fifo->head, head + 1, __ATOMIC_RELEASE);
+}
+
+esp_err_t sample_fifo_push(sample_fifo_t *fifo, int64_t timestamp, const void *data)
+{
+    if (!fifo || !data)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(sample_fifo_claim(fifo), data, fifo->sample_size);
+    sample_fifo_publish(fifo, timestamp);
+
+    return ESP_OK;
+}
+
+esp_err_t sample_fifo_reader_init(sample_fifo_reader_t *reader, sample_fifo_t *fifo)
+{
+    if (!reader || !fifo)
+        return ESP_ERR_INVALID_ARG;
+
+    reader->fifo = fifo;
+    reader->tail = __atomic_load_n(&fifo->head, __ATOMIC_ACQUIRE);
+    reader->overruns = 0;
+
+    return ESP_OK;
+}
+
+size_t sample_fifo_available(sample_fifo_reader_t *reader)
+{
+    if (!reader || !reader->fifo)
+        return 0;
+
+    uint32_t count = __atomic_load_n(&reader->fifo->head, __ATOMIC_ACQUIRE) - reader->tail;
+
+    return (count > reader->fifo->depth) ? reader->fifo->depth : count;
+}
+
+size_t sample_fifo_peek(sample_fifo_reader_t *reader, const sample_fifo_sample_t **first, size_t max)
+{
+    if (!reader || !reader->fifo || !first)
+        return 0;
+
+    sample_fifo_t *fifo = reader->fifo;
+    uint32_t head = __atomic_load_n(&fifo->head, __ATOMIC_ACQUIRE);
+
+    // producer lapped reader, skip to the oldest sample still in ring.
+    if ((head - reader->tail) > fifo->depth) {
+        reader->overruns += (head - reader->tail) - fifo->depth;
+        reader->tail = head - fifo->depth;
+    }
+
+    // batch ends at ring wrap, so its samples are contiguous.
+    size_t count = head - reader->tail;
+    size_t contiguous = fifo->depth - (reader->tail & (fifo->depth - 1));
+
+    if (count > contiguous)
+        count = contiguous;
+    if (count > max)
+        count = max;
+
+    *first = SAMPLE_SLOT(fifo, reader->tail);
+    return count;
+}
+
+esp_err_t sample_fifo_commit(sample_fifo_reader_t *reader, size_t count)
+{
+    if (!reader || !reader->fifo)
+        return ESP_ERR_INVALID_ARG;
+
+    sample_fifo_t *fifo = reader->fifo;
+    uint32_t first = reader->tail;
+
+    // every read of the batch happens before looking at the producer.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint32_t claimed = __atomic_load_n(&fifo->claimed, __ATOMIC_RELAXED);
+
+    reader->tail = first + count;
+
+    // producer started to overwrite the oldest sample of batch while it was 
+    // in use, nothing read from batch can be trusted.
+    if ((claimed - first) > fifo->depth) {
+        reader->overruns += count;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return ESP_OK;
+}
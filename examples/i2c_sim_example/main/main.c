@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "i2cbus.h"
+#include "lcd_i2c.h"
+#include "i2c_sim.h"
+#include "i2c_sim_hd44780.h"
+#include "i2c_sim_regfile.h"
+
+#define LCD_ADDR        0x27
+#define SENSOR_ADDR     0x68
+#define ABSENT_ADDR     0x3F
+#define WIRING_MAX_FREQ 700000      /*!< Fastest clock the simulated wiring carries */
+
+static const char *TAG = "main";
+
+static i2c_sim_stats_t last_stats;
+static int64_t last_time;
+
+static void measure_begin(void)
+{
+    i2c_sim_get_stats(I2C_NUM_0, &last_stats);
+    last_time = i2c_sim_time_ns();
+}
+
+static void measure_end(const char *name, esp_err_t res)
+{
+    i2c_sim_stats_t stats;
+    i2c_sim_get_stats(I2C_NUM_0, &stats);
+
+    printf("%-28s %-8s %6u %8llu %10.1f %10.1f\n", name, res == ESP_OK ? "ok" : esp_err_to_name(res), 
+           (unsigned)(stats.transactions - last_stats.transactions), 
+           (unsigned long long)(stats.bits - last_stats.bits), 
+           (stats.wire_time_ns - last_stats.wire_time_ns) / 1000.0, 
+           (i2c_sim_time_ns() - last_time) / 1000.0);
+}
+
+#define MEASURE(name, call) do { measure_begin(); esp_err_t __res = (call); measure_end(name, __res); } while (0)
+
+void app_main(void)
+{
+    // device models on the simulated bus.
+    static i2c_sim_hd44780_t lcd_model;
+    static i2c_sim_regfile_t sensor;
+    static uint8_t sensor_regs[128];
+
+    for (int i = 0; i < sizeof(sensor_regs); i++)
+        sensor_regs[i] = i;
+
+    i2c_sim_hd44780_attach(I2C_NUM_0, &lcd_model, LCD_ADDR, 16, 2);
+    i2c_sim_regfile_attach(I2C_NUM_0, &sensor, SENSOR_ADDR, sensor_regs, sizeof(sensor_regs), 1);
+
+    // wiring of this board gives up above 700 kHz.
+    i2c_sim_set_max_freq(I2C_NUM_0, WIRING_MAX_FREQ);
+    i2cbus_init(I2C_NUM_0, I2C_MODE_MASTER, GPIO_NUM_NC, GPIO_NUM_NC);
+
+    i2cbus_t bus;
+    lcd_i2c_t lcd1602;
+    lcd_i2c_t lcd2004;
+    uint8_t reg = 0x3B;
+    uint8_t data[14];
+    memset(&lcd1602, 0, sizeof(lcd_i2c_t));
+    memset(&lcd2004, 0, sizeof(lcd_i2c_t));
+
+    printf("%-28s %-8s %6s %8s %10s %10s\n", "call", "result", "xfers", "bits", "wire_us", "total_us");
+
+    MEASURE("i2cbus_scan", i2cbus_scan(I2C_NUM_0));
+    MEASURE("i2cbus_autotune", i2cbus_autotune(I2C_NUM_0));
+    printf("%-28s %u Hz\n", "port clock", (unsigned)i2cbus_get_freq(I2C_NUM_0));
+    MEASURE("i2cbus_create", i2cbus_create(&bus, I2C_NUM_0, SENSOR_ADDR));
+    MEASURE("i2cbus_read_reg 14", i2cbus_read_reg(&bus, &reg, 1, data, sizeof(data)));
+    MEASURE("i2cbus_write_reg 1", i2cbus_write_reg(&bus, &reg, 1, data, 1));
+    MEASURE("i2cbus_read 1", i2cbus_read(&bus, data, 1));
+
+    MEASURE("lcd_i2c_init", lcd_i2c_init(&lcd1602, I2C_NUM_0, LCD_ADDR, LCD_1602));
+    MEASURE("lcd_i2c_init absent", lcd_i2c_init(&lcd2004, I2C_NUM_0, ABSENT_ADDR, LCD_2004));
+    MEASURE("lcd_i2c_clear_display", lcd_i2c_clear_display(&lcd1602));
+    MEASURE("lcd_i2c_write 5 chars", lcd_i2c_write(&lcd1602, "hello"));
+    MEASURE("lcd_i2c_set_cursor", lcd_i2c_set_cursor(&lcd1602, 0, 1));
+    MEASURE("lcd_i2c_write 16 chars", lcd_i2c_write(&lcd1602, "0123456789ABCDEF"));
+    MEASURE("lcd_i2c_set_backlight", lcd_i2c_set_backlight(&lcd1602, true));
+    MEASURE("lcd_i2c_shift_display", lcd_i2c_shift_display(&lcd1602, LCD_SHIFT_LEFT));
+
+    // what the display shows, and if the driver respected controller timing.
+    char screen[2 * 17 + 1];
+    i2c_sim_hd44780_render(&lcd_model, screen, sizeof(screen));
+    printf("\n+----------------+\n");
+    for (char *line = strtok(screen, "\n"); line; line = strtok(NULL, "\n"))
+        printf("|%s|\n", line);
+    printf("+----------------+\n");
+    printf("%u instructions, %u chars, %u timing violations\n", (unsigned)lcd_model.stats.instructions, 
+           (unsigned)lcd_model.stats.chars, (unsigned)lcd_model.stats.violations);
+
+    i2c_sim_stats_t stats;
+    i2c_sim_get_stats(I2C_NUM_0, &stats);
+    ESP_LOGI(TAG, "%u transactions, %u nacks, %u overlaps, %llu us on the wire", (unsigned)stats.transactions, 
+             (unsigned)stats.nacks, (unsigned)stats.overlaps, (unsigned long long)(stats.wire_time_ns / 1000));
+
+    exit(0);
+}
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp32/rom/ets_sys.h"
+#include "i2cbus.h"
+#include "lcd_i2c.h"
+#include "lcd_i2c_widget.h"
+#include "eeprom24c.h"
+#include "i2c_sim.h"
+#include "i2c_sim_eeprom.h"
+#include "i2c_sim_hd44780.h"
+#include "i2c_sim_regfile.h"
+
+#define BENCH_PORT          I2C_NUM_0
+#define BENCH_LCD1602_ADDR  0x27
+#define BENCH_LCD2004_ADDR  0x3F
+#define BENCH_SENSOR_ADDR   0x68
+#define BENCH_EEPROM_ADDR   0x50
+#define BENCH_EEPROM_SIZE   32768       /*!< 24C256 */
+#define BENCH_EEPROM_PAGE   64
+#define BENCH_EEPROM_BYTES  4096        /*!< Configuration block written and read */
+#define BENCH_EEPROM_SLOW   256         /*!< Bytes of byte by byte write, it takes 5 ms each */
+#define BENCH_EEPROM_DELAY  5000        /*!< Fixed wait of byte by byte write */
+#define BENCH_MICRO_ITER    20000
+#define BENCH_LCD_ITER      1000
+#define BENCH_POST_BUF      128         /*!< Posted write staging of display */
+#define BENCH_POST_DELAY    2000        /*!< Longest a display write stays staged, us */
+#define BENCH_TASKS         4
+#define BENCH_TASK_ITER     5000
+#define BENCH_CPU_TOLERANCE 25          /*!< Default CPU time regression allowed, percent */
+
+static const char *TAG = "bench";
+
+typedef struct {
+    const char *name;
+    uint32_t (*run)(void);              /*!< Run scenario, return operations done */
+} bench_t;
+
+typedef struct {
+    char name[64];
+    uint32_t ops;
+    double cpu_ns;                      /*!< Host CPU time per operation */
+    double bus_ns;                      /*!< Wire time per operation */
+    double sim_ns;                      /*!< Simulated time per operation, delays included */
+    double xfers;                       /*!< Transactions per operation */
+    double bytes;                       /*!< Bytes on the wire per operation */
+} bench_result_t;
+
+static i2c_sim_hd44780_t lcd1602_model, lcd2004_model;
+static i2c_sim_regfile_t sensor_model;
+static uint8_t sensor_regs[256];
+
+static i2c_sim_eeprom_t eeprom_model;
+static uint8_t eeprom_mem[BENCH_EEPROM_SIZE];
+static uint8_t eeprom_data[BENCH_EEPROM_BYTES];
+
+static i2cbus_t sensor;
+static lcd_i2c_t lcd1602, lcd2004;
+static i2cbus_t eeprom_raw;
+static eeprom24c_t eeprom;
+
+static int64_t cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/* microbenchmarks, fixed overhead of i2cbus split in its parts */
+
+static uint32_t bench_mutex(void)
+{
+    SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+
+    for (int i = 0; i < BENCH_MICRO_ITER; i++) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        xSemaphoreGiveRecursive(mutex);
+    }
+    vSemaphoreDelete(mutex);
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_cmd_link(void)
+{
+    uint8_t data = 0;
+
+    for (int i = 0; i < BENCH_MICRO_ITER; i++) {
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, BENCH_SENSOR_ADDR << 1, true);
+        i2c_master_write(cmd, &data, 1, true);
+        i2c_master_stop(cmd);
+        i2c_cmd_link_delete(cmd);
+    }
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_driver(void)
+{
+    uint8_t data = 0;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, BENCH_SENSOR_ADDR << 1, true);
+    i2c_master_write(cmd, &data, 1, true);
+    i2c_master_stop(cmd);
+    for (int i = 0; i < BENCH_MICRO_ITER; i++)
+        i2c_master_cmd_begin(BENCH_PORT, cmd, portMAX_DELAY);
+    i2c_cmd_link_delete(cmd);
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_write(void)
+{
+    uint8_t data = 0;
+
+    for (int i = 0; i < BENCH_MICRO_ITER; i++)
+        i2cbus_write(&sensor, &data, 1);
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_read_reg_1(void)
+{
+    uint8_t reg = 0x3B, data;
+
+    for (int i = 0; i < BENCH_MICRO_ITER; i++)
+        i2cbus_read_reg(&sensor, &reg, 1, &data, 1);
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_read_reg_14(void)
+{
+    uint8_t reg = 0x3B, data[14];
+
+    for (int i = 0; i < BENCH_MICRO_ITER; i++)
+        i2cbus_read_reg(&sensor, &reg, 1, data, sizeof(data));
+    return BENCH_MICRO_ITER;
+}
+
+static uint32_t bench_lcd_char(void)
+{
+    uint32_t chars = 0;
+
+    for (int i = 0; i < BENCH_LCD_ITER; i++) {
+        lcd_i2c_set_cursor(&lcd2004, 0, 0);
+        lcd_i2c_write(&lcd2004, "01234567890123456789");
+        chars += 20;
+    }
+    return chars;
+}
+
+/* macro scenarios */
+
+static uint32_t bench_lcd2004_redraw(void)
+{
+    static const char *lines[] = {
+        "Temperature  23.5 C ", 
+        "Humidity     41.0 % ", 
+        "Pressure   1013 hPa ", 
+        "Uptime     00:12:34 "
+    };
+
+    for (int i = 0; i < BENCH_LCD_ITER; i++) {
+        for (int row = 0; row < 4; row++) {
+            lcd_i2c_set_cursor(&lcd2004, 0, row);
+            lcd_i2c_write(&lcd2004, lines[row]);
+        }
+    }
+    return BENCH_LCD_ITER;
+}
+
+static uint32_t bench_lcd2004_redraw_posted(void)
+{
+    static i2cbus_post_t post;
+    static uint8_t post_buf[BENCH_POST_BUF];
+
+    // same redraw with display writes posted, a row goes in few transactions.
+    i2cbus_set_post(&lcd2004.pcf.bus, &post, post_buf, sizeof(post_buf), BENCH_POST_DELAY);
+    uint32_t ops = bench_lcd2004_redraw();
+    i2cbus_set_post(&lcd2004.pcf.bus, NULL, NULL, 0, 0);
+
+    return ops;
+}
+
+static uint32_t bench_lcd_counter(void)
+{
+    // main loop body of examples/lcd_example.
+    for (unsigned int value = 0; value < BENCH_LCD_ITER; value++) {
+        lcd_i2c_set_cursor(&lcd1602, 0, 0);
+        lcd_i2c_write_int(&lcd1602, value, 8, LCD_ALIGN_ZERO);
+        lcd_i2c_shift_display(&lcd2004, LCD_SHIFT_LEFT);
+    }
+    return BENCH_LCD_ITER;
+}
+
+static uint32_t bench_lcd_level(bool redraw)
+{
+    lcd_i2c_widget_t bar, digits;
+
+    // live level sweeping up and down, a bar step per frame, with its value 
+    // in big digits below.
+    lcd_i2c_bar_init(&bar, &lcd2004, LCD_WIDGET_HBAR, 0, 0, 20, 0, 100);
+    lcd_i2c_big_init(&digits, &lcd2004, LCD_WIDGET_BIG2, 0, 1, 3);
+    for (int i = 0; i < BENCH_LCD_ITER; i++) {
+        int32_t level = i % 200;
+        if (level > 100)
+            level = 200 - level;
+        if (redraw) {
+            lcd_i2c_widget_invalidate(&bar);
+            lcd_i2c_widget_invalidate(&digits);
+        }
+        lcd_i2c_widget_update(&bar, level);
+        lcd_i2c_widget_update(&digits, level);
+    }
+    return BENCH_LCD_ITER;
+}
+
+static uint32_t bench_lcd_level_redraw(void)
+{
+    return bench_lcd_level(true);
+}
+
+static uint32_t bench_lcd_level_widget(void)
+{
+    return bench_lcd_level(false);
+}
+
+static uint32_t bench_eeprom_bytewise(void)
+{
+    // what configuration storage did before eeprom24c: a transaction and a
+    // fixed write cycle wait per byte.
+    for (int i = 0; i < BENCH_EEPROM_SLOW; i++) {
+        uint8_t addr[2] = {i >> 8, i & 0xFF};
+        i2cbus_write_reg(&eeprom_raw, addr, sizeof(addr), &eeprom_data[i], 1);
+        ets_delay_us(BENCH_EEPROM_DELAY);
+    }
+    return BENCH_EEPROM_SLOW;
+}
+
+static uint32_t bench_eeprom_write(void)
+{
+    // odd offset, first and last bursts are partial pages.
+    eeprom24c_write(&eeprom, 100, eeprom_data, sizeof(eeprom_data));
+    return sizeof(eeprom_data);
+}
+
+static uint32_t bench_eeprom_read(void)
+{
+    static uint8_t data[BENCH_EEPROM_BYTES];
+
+    eeprom24c_read(&eeprom, 100, data, sizeof(data));
+    if (memcmp(data, eeprom_data, sizeof(data)))
+        ESP_LOGE(TAG, "eeprom read back differs from data written");
+    return sizeof(data);
+}
+
+static SemaphoreHandle_t contention_done;
+
+static void vTaskContention(void *pvParameters)
+{
+    i2cbus_t *dev = (i2cbus_t *)pvParameters;
+    uint8_t reg = (uint8_t)(uintptr_t)dev, data[6];
+
+    for (int i = 0; i < BENCH_TASK_ITER; i++)
+        i2cbus_read_reg(dev, &reg, 1, data, sizeof(data));
+
+    xSemaphoreGive(contention_done);
+    vTaskDelete(NULL);
+}
+
+static uint32_t bench_contention(void)
+{
+    static i2cbus_t devs[BENCH_TASKS];
+
+    contention_done = xSemaphoreCreateCounting(BENCH_TASKS, 0);
+    for (int i = 0; i < BENCH_TASKS; i++) {
+        i2cbus_create(&devs[i], BENCH_PORT, BENCH_SENSOR_ADDR);
+        xTaskCreate(vTaskContention, "vTaskContention", 1024*2, &devs[i], 5, NULL);
+    }
+    for (int i = 0; i < BENCH_TASKS; i++)
+        xSemaphoreTake(contention_done, portMAX_DELAY);
+    for (int i = 0; i < BENCH_TASKS; i++)
+        i2cbus_delete(&devs[i]);
+    vSemaphoreDelete(contention_done);
+
+    return BENCH_TASKS * BENCH_TASK_ITER;
+}
+
+static const bench_t benches[] = {
+    {"mutex_take_give", bench_mutex},
+    {"cmd_link_build", bench_cmd_link},
+    {"driver_cmd_begin", bench_driver},
+    {"i2cbus_write_1", bench_write},
+    {"i2cbus_read_reg_1_1", bench_read_reg_1},
+    {"i2cbus_read_reg_1_14", bench_read_reg_14},
+    {"lcd_i2c_write_per_char", bench_lcd_char},
+    {"lcd2004_redraw", bench_lcd2004_redraw},
+    {"lcd2004_redraw_posted", bench_lcd2004_redraw_posted},
+    {"lcd1602_counter_update", bench_lcd_counter},
+    {"lcd2004_level_redraw", bench_lcd_level_redraw},
+    {"lcd2004_level_widget", bench_lcd_level_widget},
+    {"contention_4_tasks", bench_contention},
+    {"eeprom_bytewise_write", bench_eeprom_bytewise},
+    {"eeprom24c_write", bench_eeprom_write},
+    {"eeprom24c_read", bench_eeprom_read},
+};
+
+static void bench_run(const bench_t *bench, bench_result_t *res)
+{
+    i2c_sim_stats_t stats;
+
+    i2c_sim_reset_stats(BENCH_PORT);
+    int64_t sim_start = i2c_sim_time_ns();
+    int64_t cpu_start = cpu_ns();
+
+    uint32_t ops = bench->run();
+
+    int64_t cpu = cpu_ns() - cpu_start;
+    int64_t sim = i2c_sim_time_ns() - sim_start;
+    i2c_sim_get_stats(BENCH_PORT, &stats);
+
+    snprintf(res->name, sizeof(res->name), "%s", bench->name);
+    res->ops = ops;
+    res->cpu_ns = (double)cpu / ops;
+    res->bus_ns = (double)stats.wire_time_ns / ops;
+    res->sim_ns = (double)sim / ops;
+    res->xfers = (double)stats.transactions / ops;
+    res->bytes = (double)(stats.bytes_written + stats.bytes_read) / ops;
+}
+
+static int bench_load_baseline(const char *path, bench_result_t *base, int max)
+{
+    char line[256];
+    int count = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        ESP_LOGE(TAG, "can't open baseline %s", path);
+        return 0;
+    }
+
+    while ((count < max) && fgets(line, sizeof(line), file)) {
+        bench_result_t *res = &base[count];
+        if ((line[0] == '#') || (strncmp(line, "scenario,", 9) == 0))
+            continue;
+        if (sscanf(line, "%63[^,],%u,%lf,%lf,%lf,%lf,%lf", res->name, &res->ops, &res->cpu_ns, &res->bus_ns, 
+                   &res->sim_ns, &res->xfers, &res->bytes) == 7)
+            count++;
+    }
+    fclose(file);
+
+    return count;
+}
+
+static int bench_compare(const bench_result_t *res, const bench_result_t *base, int base_count, int cpu_tolerance)
+{
+    for (int i = 0; i < base_count; i++) {
+        if (strcmp(res->name, base[i].name))
+            continue;
+
+        double cpu = ((res->cpu_ns - base[i].cpu_ns) * 100) / base[i].cpu_ns;
+        double bus = base[i].bus_ns ? ((res->bus_ns - base[i].bus_ns) * 100) / base[i].bus_ns : 0;
+        double sim = base[i].sim_ns ? ((res->sim_ns - base[i].sim_ns) * 100) / base[i].sim_ns : 0;
+        // bus and simulated time are exact, any growth is a regression.
+        bool regression = (cpu > cpu_tolerance) || (res->bus_ns > base[i].bus_ns) || (res->sim_ns > base[i].sim_ns);
+
+        printf("# %-24s cpu %+7.1f%%  bus %+7.1f%%  sim %+7.1f%%  %s\n", res->name, cpu, bus, sim, 
+               regression ? "REGRESSION" : "ok");
+        return regression;
+    }
+
+    printf("# %-24s no baseline\n", res->name);
+    return 0;
+}
+
+void app_main(void)
+{
+    static bench_result_t base[sizeof(benches) / sizeof(benches[0])];
+    bench_result_t res[sizeof(benches) / sizeof(benches[0])];
+    const char *baseline = getenv("I2CBUS_BENCH_BASELINE");
+    const char *tolerance = getenv("I2CBUS_BENCH_CPU_TOLERANCE");
+    int cpu_tolerance = tolerance ? atoi(tolerance) : BENCH_CPU_TOLERANCE;
+    int regressions = 0;
+
+    for (int i = 0; i < sizeof(sensor_regs); i++)
+        sensor_regs[i] = i;
+    for (int i = 0; i < sizeof(eeprom_data); i++)
+        eeprom_data[i] = (i * 7) ^ (i >> 8);
+
+    i2c_sim_hd44780_attach(BENCH_PORT, &lcd1602_model, BENCH_LCD1602_ADDR, 16, 2);
+    i2c_sim_hd44780_attach(BENCH_PORT, &lcd2004_model, BENCH_LCD2004_ADDR, 20, 4);
+    i2c_sim_regfile_attach(BENCH_PORT, &sensor_model, BENCH_SENSOR_ADDR, sensor_regs, sizeof(sensor_regs), 1);
+    i2c_sim_eeprom_attach(BENCH_PORT, &eeprom_model, BENCH_EEPROM_ADDR, eeprom_mem, sizeof(eeprom_mem), 
+                          BENCH_EEPROM_PAGE, 2);
+
+    i2cbus_init(BENCH_PORT, I2C_MODE_MASTER, GPIO_NUM_NC, GPIO_NUM_NC);
+    i2cbus_create(&sensor, BENCH_PORT, BENCH_SENSOR_ADDR);
+    memset(&lcd1602, 0, sizeof(lcd_i2c_t));
+    memset(&lcd2004, 0, sizeof(lcd_i2c_t));
+    lcd_i2c_init(&lcd1602, BENCH_PORT, BENCH_LCD1602_ADDR, LCD_1602);
+    lcd_i2c_init(&lcd2004, BENCH_PORT, BENCH_LCD2004_ADDR, LCD_2004);
+    i2cbus_create(&eeprom_raw, BENCH_PORT, BENCH_EEPROM_ADDR);
+    eeprom24c_init(&eeprom, BENCH_PORT, BENCH_EEPROM_ADDR, EEPROM_24C256);
+
+    printf("scenario,ops,cpu_ns,bus_ns,sim_ns,xfers,bytes\n");
+    for (int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        bench_run(&benches[i], &res[i]);
+        printf("%s,%u,%.1f,%.1f,%.1f,%.2f,%.2f\n", res[i].name, (unsigned)res[i].ops, res[i].cpu_ns, res[i].bus_ns, 
+               res[i].sim_ns, res[i].xfers, res[i].bytes);
+        fflush(stdout);
+    }
+
+    // throughput of configuration storage, simulated time is per byte.
+    for (int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (strncmp(res[i].name, "eeprom", 6) == 0)
+            printf("# %-24s %8.2f KB/s\n", res[i].name, 1e9 / (res[i].sim_ns * 1024));
+    }
+
+    if (baseline) {
+        int base_count = bench_load_baseline(baseline, base, sizeof(base) / sizeof(base[0]));
+        for (int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+            regressions += bench_compare(&res[i], base, base_count, cpu_tolerance);
+        printf("# %d regression(s), cpu tolerance %d%%\n", regressions, cpu_tolerance);
+    }
+
+    if (lcd1602_model.stats.violations || lcd2004_model.stats.violations)
+        ESP_LOGW(TAG, "lcd timing violations: 1602 %u, 2004 %u", (unsigned)lcd1602_model.stats.violations, 
+                 (unsigned)lcd2004_model.stats.violations);
+
+    exit(regressions ? EXIT_FAILURE : EXIT_SUCCESS);
+}
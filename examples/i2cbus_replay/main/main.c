@@ -0,0 +1,718 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "i2cbus.h"
+#include "i2cbus_queue.h"
+#include "lcd_i2c.h"
+#include "i2c_sim.h"
+#include "i2c_sim_hd44780.h"
+#include "i2c_sim_regfile.h"
+
+#define REPLAY_MAX_TASKS        16
+#define REPLAY_MAX_DEVICES      32          /*!< Distinct port and address pairs */
+#define REPLAY_MAX_CONFIGS      8
+#define REPLAY_MAX_EVENTS       32768       /*!< Calls kept by the built-in recording */
+#define REPLAY_REG_MAX          8           /*!< Widest register replayed, traces keep its last four bytes */
+#define REPLAY_NAME_SIZE        16
+#define REPLAY_POST_BUF         64          /*!< Staging buffer of posted writes */
+#define REPLAY_POST_US          200         /*!< Longest time a posted write stays staged */
+#define REPLAY_LEAD_US          20000       /*!< Time tasks get to start before the first call */
+#define REPLAY_TASK_PRIORITY    5
+#define REPLAY_RECORD_MS        1000        /*!< Default length of the built-in recording */
+#define REPLAY_CONFIGS          "base,base+post,base+queue,400k,400k+post,1m+post"
+
+#define WORK_PORT               I2C_NUM_0
+#define WORK_SENSOR_ADDR        0x68        /*!< Register file polled like an IMU */
+#define WORK_SENSOR_PERIOD_US   2000
+#define WORK_LOG_ADDR           0x50        /*!< Register file written like an EEPROM log */
+#define WORK_LOG_PERIOD_US      20000
+#define WORK_LOG_SIZE           16
+#define WORK_LCD_ADDR           0x27
+#define WORK_LCD_PERIOD_US      50000
+
+static const char *TAG = "replay";
+
+typedef enum {
+    REPLAY_PACE_THINK = 0,              /*!< Recorded gap after the previous call returned */
+    REPLAY_PACE_TIME                    /*!< Recorded start, or at once when late */
+} replay_pace_t;
+
+typedef struct {
+    int64_t start_us;                   /*!< Call entry, from start of trace */
+    int64_t end_us;                     /*!< Call return, from start of trace */
+    int dev;                            /*!< Index in devices */
+    i2cbus_trace_op_t op;
+    uint32_t reg;
+    size_t reg_size;
+    size_t data_size;
+    esp_err_t res;                      /*!< Recorded result */
+} replay_event_t;
+
+typedef struct {
+    int id;
+    char name[REPLAY_NAME_SIZE];
+    replay_event_t *events;
+    size_t count;
+    size_t size;                        /*!< Events allocated */
+    uint8_t *data;                      /*!< Transfer buffer, fits largest call of task */
+    size_t data_size;
+    int64_t *latency;                   /*!< Replayed latency of each call, microseconds */
+    int64_t end_us;                     /*!< Return of last replayed call */
+    uint32_t errors;                    /*!< Replayed calls that failed */
+    bool used[REPLAY_MAX_DEVICES];      /*!< Devices task calls */
+    i2cbus_t bus[REPLAY_MAX_DEVICES];   /*!< Own handle of each device, as drivers have */
+    i2cbus_post_t post[REPLAY_MAX_DEVICES];
+    uint8_t post_buf[REPLAY_MAX_DEVICES][REPLAY_POST_BUF];
+    i2cbus_xfer_t xfer;
+} replay_task_t;
+
+typedef struct {
+    i2c_port_t port;
+    uint8_t addr;
+    i2c_sim_device_t sim;               /*!< Sink standing for the device */
+} replay_device_t;
+
+typedef struct {
+    char name[REPLAY_NAME_SIZE];        /*!< Column heading */
+    uint32_t freq;                      /*!< Bus clock */
+    bool post;                          /*!< Posted writes on every device */
+    bool queue;                         /*!< Transfers through the port submission worker */
+} replay_config_t;
+
+typedef struct {
+    bool bus;                           /*!< Bus statistics known */
+    int64_t elapsed_us;
+    uint64_t wire_time_ns;
+    uint32_t transactions;
+    uint64_t bytes;
+    uint32_t handoffs;
+    uint32_t calls;
+    uint32_t errors;
+    int64_t latency[REPLAY_MAX_TASKS][4];   /*!< p50, p95, p99 and max of each task, microseconds */
+} replay_result_t;
+
+typedef struct {
+    i2cbus_trace_t event;
+    char task[REPLAY_NAME_SIZE];
+} replay_record_t;
+
+static const char *replay_ops[] = {"write", "read", "ping", "flush"};
+
+static replay_task_t tasks[REPLAY_MAX_TASKS];
+static int task_count;
+static replay_device_t devices[REPLAY_MAX_DEVICES];
+static int device_count;
+static replay_config_t configs[REPLAY_MAX_CONFIGS];
+static int config_count;
+static replay_result_t results[1 + REPLAY_MAX_CONFIGS];
+static const replay_config_t *config;   /*!< Configuration being replayed */
+static replay_pace_t pace;
+static int64_t replay_start;
+static SemaphoreHandle_t done;
+
+static replay_record_t *records;
+static uint32_t record_count;
+static volatile bool running;
+static i2c_sim_regfile_t sensor_model, log_model;
+static uint8_t sensor_mem[128], log_mem[256];
+static i2c_sim_hd44780_t lcd_model;
+static lcd_i2c_t lcd;
+
+static void replay_wait_until(int64_t at_us)
+{
+    int64_t left = at_us - esp_timer_get_time();
+
+    // sleep whole ticks, spin the rest so short gaps keep their length.
+    if (left > 2 * portTICK_PERIOD_MS * 1000)
+        vTaskDelay(pdMS_TO_TICKS(left / 1000) - 1);
+    while (esp_timer_get_time() < at_us)
+        taskYIELD();
+}
+
+/* sink device model, stands for any device: acks everything, reads 0xFF */
+
+static bool _sink_start(void *ctx, bool read)
+{
+    return true;
+}
+
+static bool _sink_write(void *ctx, uint8_t data)
+{
+    return true;
+}
+
+static uint8_t _sink_read(void *ctx, bool ack)
+{
+    return 0xFF;
+}
+
+static const i2c_sim_ops_t sink_ops = {
+    .start = _sink_start,
+    .write = _sink_write,
+    .read = _sink_read,
+};
+
+static bool replay_add(const char *name, int64_t start_us, int64_t end_us, i2c_port_t port, uint8_t addr,
+                       i2cbus_trace_op_t op, uint32_t reg, size_t reg_size, size_t data_size, esp_err_t res)
+{
+    if ((port >= I2C_NUM_MAX) || (addr > 0x7F) || (op > I2CBUS_TRACE_FLUSH) || (reg_size > REPLAY_REG_MAX) ||
+        (end_us < start_us))
+        return false;
+
+    int t = 0, d = 0;
+    while ((t < task_count) && strcmp(tasks[t].name, name))
+        t++;
+    while ((d < device_count) && ((devices[d].port != port) || (devices[d].addr != addr)))
+        d++;
+    if ((t == REPLAY_MAX_TASKS) || (d == REPLAY_MAX_DEVICES))
+        return false;
+
+    replay_task_t *task = &tasks[t];
+    if (t == task_count) {
+        task->id = task_count++;
+        snprintf(task->name, sizeof(task->name), "%s", name);
+    }
+    if (d == device_count) {
+        devices[d].port = port;
+        devices[d].addr = addr;
+        device_count++;
+    }
+
+    if (task->count == task->size) {
+        task->size = task->size ? task->size * 2 : 1024;
+        task->events = realloc(task->events, task->size * sizeof(replay_event_t));
+    }
+    if (data_size > task->data_size) {
+        task->data_size = data_size;
+        task->data = realloc(task->data, data_size);
+        memset(task->data, 0, data_size);
+    }
+
+    task->events[task->count++] = (replay_event_t) {
+        .start_us = start_us,
+        .end_us = end_us,
+        .dev = d,
+        .op = op,
+        .reg = reg,
+        .reg_size = reg_size,
+        .data_size = data_size,
+        .res = res,
+    };
+    task->used[d] = true;
+
+    return true;
+}
+
+static void replay_rebase(void)
+{
+    int64_t first = INT64_MAX;
+
+    // trace time starts at its first call.
+    for (int t = 0; t < task_count; t++) {
+        if (tasks[t].count && (tasks[t].events[0].start_us < first))
+            first = tasks[t].events[0].start_us;
+    }
+    for (int t = 0; t < task_count; t++) {
+        for (size_t i = 0; i < tasks[t].count; i++) {
+            tasks[t].events[i].start_us -= first;
+            tasks[t].events[i].end_us -= first;
+        }
+        tasks[t].latency = malloc((tasks[t].count ? tasks[t].count : 1) * sizeof(int64_t));
+    }
+}
+
+static esp_err_t replay_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return ESP_ERR_NOT_FOUND;
+
+    char line[160];
+    unsigned int n = 0;
+    esp_err_t res = ESP_OK;
+    while ((res == ESP_OK) && fgets(line, sizeof(line), f)) {
+        long long start_us, end_us;
+        char name[REPLAY_NAME_SIZE], op_name[8];
+        int port, err;
+        unsigned int addr, reg, reg_size, data_size, op = 0;
+
+        n++;
+        if ((line[0] == '#') || (line[0] == '\n') || !strncmp(line, "start_us", 8))
+            continue;
+
+        int fields = sscanf(line, "%lld,%lld,%15[^,],%d,%x,%7[^,],%x,%u,%u,%d", &start_us, &end_us, name, &port, &addr,
+                            op_name, &reg, &reg_size, &data_size, &err);
+        while ((op <= I2CBUS_TRACE_FLUSH) && (fields == 10) && strcmp(op_name, replay_ops[op]))
+            op++;
+        if ((fields != 10) ||
+            !replay_add(name, start_us, end_us, port, addr, op, reg, reg_size, data_size, err)) {
+            ESP_LOGE(TAG, "%s:%u: not a valid call", path, n);
+            res = ESP_ERR_INVALID_ARG;
+        }
+    }
+    fclose(f);
+
+    return res;
+}
+
+static esp_err_t replay_save(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return ESP_FAIL;
+
+    fprintf(f, "start_us,end_us,task,port,addr,op,reg,reg_size,data_size,res\n");
+    for (int t = 0; t < task_count; t++) {
+        for (size_t i = 0; i < tasks[t].count; i++) {
+            replay_event_t *ev = &tasks[t].events[i];
+            fprintf(f, "%lld,%lld,%s,%d,0x%02x,%s,0x%x,%u,%u,%d\n", (long long)ev->start_us, (long long)ev->end_us,
+                    tasks[t].name, devices[ev->dev].port, devices[ev->dev].addr, replay_ops[ev->op],
+                    (unsigned)ev->reg, (unsigned)ev->reg_size, (unsigned)ev->data_size, ev->res);
+        }
+    }
+
+    return fclose(f) ? ESP_FAIL : ESP_OK;
+}
+
+/* built-in workload, recorded through the i2cbus trace hook */
+
+static void _replay_record(const i2cbus_trace_t *event, void *arg)
+{
+    uint32_t i = __atomic_fetch_add(&record_count, 1, __ATOMIC_RELAXED);
+
+    if (i < REPLAY_MAX_EVENTS) {
+        records[i].event = *event;
+        snprintf(records[i].task, REPLAY_NAME_SIZE, "%s", pcTaskGetName(NULL));
+    }
+}
+
+static void vTaskSensor(void *pvParameters)
+{
+    static i2cbus_t imu;
+    int64_t next = esp_timer_get_time();
+
+    i2cbus_create(&imu, WORK_PORT, WORK_SENSOR_ADDR);
+    while (running) {
+        uint8_t reg = 0x3B, data[6];
+        i2cbus_read_reg(&imu, &reg, 1, data, sizeof(data));
+        next += WORK_SENSOR_PERIOD_US;
+        replay_wait_until(next);
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static void vTaskLog(void *pvParameters)
+{
+    static i2cbus_t log;
+    uint8_t data[WORK_LOG_SIZE] = {0};
+    uint16_t addr = 0;
+    int64_t next = esp_timer_get_time();
+
+    i2cbus_create(&log, WORK_PORT, WORK_LOG_ADDR);
+    while (running) {
+        uint8_t reg[2] = {addr >> 8, addr & 0xFF};
+        data[0]++;
+        i2cbus_write_reg(&log, reg, sizeof(reg), data, sizeof(data));
+        addr = (addr + WORK_LOG_SIZE) % sizeof(log_mem);
+        next += WORK_LOG_PERIOD_US;
+        replay_wait_until(next);
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static void vTaskLcd(void *pvParameters)
+{
+    int64_t next = esp_timer_get_time();
+    uint32_t count = 0;
+
+    while (running) {
+        lcd_i2c_set_cursor(&lcd, 0, 0);
+        lcd_i2c_printf(&lcd, "up %5u ms", (unsigned)(count * (WORK_LCD_PERIOD_US / 1000)));
+        lcd_i2c_set_cursor(&lcd, 0, 1);
+        lcd_i2c_write_int(&lcd, count++, 8, LCD_ALIGN_ZERO);
+        next += WORK_LCD_PERIOD_US;
+        replay_wait_until(next);
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static void replay_record(int duration_ms, replay_result_t *result)
+{
+    i2c_sim_stats_t stats;
+
+    records = calloc(REPLAY_MAX_EVENTS, sizeof(replay_record_t));
+    i2c_sim_regfile_attach(WORK_PORT, &sensor_model, WORK_SENSOR_ADDR, sensor_mem, sizeof(sensor_mem), 1);
+    i2c_sim_regfile_attach(WORK_PORT, &log_model, WORK_LOG_ADDR, log_mem, sizeof(log_mem), 2);
+    i2c_sim_hd44780_attach(WORK_PORT, &lcd_model, WORK_LCD_ADDR, 16, 2);
+    i2cbus_init(WORK_PORT, I2C_MODE_MASTER, GPIO_NUM_NC, GPIO_NUM_NC);
+    lcd_i2c_init(&lcd, WORK_PORT, WORK_LCD_ADDR, LCD_1602);
+
+    if (i2cbus_set_trace(_replay_record, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "i2cbus built without CONFIG_I2CBUS_TRACE, give a trace in I2CBUS_REPLAY_TRACE");
+        exit(EXIT_FAILURE);
+    }
+
+    i2c_sim_reset_stats(WORK_PORT);
+    running = true;
+    xTaskCreate(vTaskSensor, "sensor", 1024*3, NULL, 6, NULL);
+    xTaskCreate(vTaskLog, "log", 1024*3, NULL, 5, NULL);
+    xTaskCreate(vTaskLcd, "lcd", 1024*3, NULL, 4, NULL);
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    running = false;
+    for (int i = 0; i < 3; i++)
+        xSemaphoreTake(done, portMAX_DELAY);
+    i2cbus_set_trace(NULL, NULL);
+    i2c_sim_get_stats(WORK_PORT, &stats);
+
+    // sinks stand for the devices from now on.
+    i2c_sim_detach(WORK_PORT, &sensor_model.dev);
+    i2c_sim_detach(WORK_PORT, &log_model.dev);
+    i2c_sim_detach(WORK_PORT, &lcd_model.io.dev);
+
+    if (record_count > REPLAY_MAX_EVENTS) {
+        ESP_LOGW(TAG, "recording keeps the first %d of %u calls", REPLAY_MAX_EVENTS, (unsigned)record_count);
+        record_count = REPLAY_MAX_EVENTS;
+    }
+    for (uint32_t i = 0; i < record_count; i++) {
+        i2cbus_trace_t *ev = &records[i].event;
+        if (!replay_add(records[i].task, ev->start_us, ev->end_us, ev->port, ev->addr, ev->op, ev->reg, ev->reg_size,
+                        ev->data_size, ev->res))
+            ESP_LOGW(TAG, "call of %s to 0x%02x dropped, too many tasks or devices", records[i].task, ev->addr);
+    }
+    free(records);
+
+    result->bus = true;
+    result->wire_time_ns = stats.wire_time_ns;
+    result->transactions = stats.transactions;
+    result->bytes = stats.bytes_written + stats.bytes_read;
+    result->handoffs = stats.handoffs;
+}
+
+/* replay */
+
+static esp_err_t replay_call(replay_task_t *task, replay_event_t *ev)
+{
+    i2cbus_t *dev = &task->bus[ev->dev];
+    TickType_t deadline = i2cbus_deadline(dev->time_out);
+    uint8_t reg[REPLAY_REG_MAX];
+
+    for (size_t i = 0; i < ev->reg_size; i++) {
+        size_t shift = 8 * (ev->reg_size - 1 - i);
+        reg[i] = (shift < 32) ? (ev->reg >> shift) : 0;
+    }
+
+    if (config->queue && ((ev->op == I2CBUS_TRACE_WRITE) || (ev->op == I2CBUS_TRACE_READ))) {
+        i2cbus_xfer_t *xfer = &task->xfer;
+        memset(xfer, 0, sizeof(i2cbus_xfer_t));
+        xfer->dev = dev;
+        xfer->op = (ev->op == I2CBUS_TRACE_WRITE) ? I2CBUS_XFER_WRITE : I2CBUS_XFER_READ;
+        xfer->reg = ev->reg_size ? reg : NULL;
+        xfer->reg_size = ev->reg_size;
+        xfer->data = task->data;
+        xfer->data_size = ev->data_size;
+        xfer->notify = xTaskGetCurrentTaskHandle();
+
+        // a full ring drains quickly, the worker runs above every task.
+        esp_err_t res;
+        while ((res = i2cbus_submit(xfer)) == ESP_ERR_NO_MEM)
+            taskYIELD();
+        return (res == ESP_OK) ? i2cbus_xfer_wait(xfer, deadline) : res;
+    }
+
+    switch (ev->op) {
+        case I2CBUS_TRACE_WRITE:
+            return i2cbus_write_reg_until(dev, ev->reg_size ? reg : NULL, ev->reg_size, task->data, ev->data_size,
+                                          deadline);
+        case I2CBUS_TRACE_READ:
+            return i2cbus_read_reg_until(dev, ev->reg_size ? reg : NULL, ev->reg_size, task->data, ev->data_size,
+                                         deadline);
+        case I2CBUS_TRACE_PING:
+            return i2cbus_ping_until(dev, deadline);
+        case I2CBUS_TRACE_FLUSH:
+            return i2cbus_flush_until(dev, deadline);
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void vTaskReplay(void *pvParameters)
+{
+    replay_task_t *task = (replay_task_t *)pvParameters;
+    int64_t end = replay_start;
+
+    for (size_t i = 0; i < task->count; i++) {
+        replay_event_t *ev = &task->events[i];
+        int64_t at = replay_start + ev->start_us;
+
+        // a closed loop task starts its next call a think time after the last returned.
+        if ((pace == REPLAY_PACE_THINK) && i)
+            at = end + (ev->start_us - task->events[i - 1].end_us);
+        replay_wait_until(at);
+
+        int64_t start = esp_timer_get_time();
+        if (replay_call(task, ev) != ESP_OK)
+            task->errors++;
+        end = esp_timer_get_time();
+        task->latency[i] = end - start;
+    }
+    task->end_us = end;
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static int replay_cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void replay_percentiles(int64_t *latency, size_t n, int64_t p[4])
+{
+    if (!n) {
+        memset(p, 0, 4 * sizeof(int64_t));
+        return;
+    }
+
+    qsort(latency, n, sizeof(int64_t), replay_cmp);
+    p[0] = latency[(n * 50) / 100];
+    p[1] = latency[(n * 95) / 100];
+    p[2] = latency[(n * 99) / 100];
+    p[3] = latency[n - 1];
+}
+
+static void replay_trace_result(replay_result_t *result)
+{
+    // the trace column shows what was recorded.
+    for (int t = 0; t < task_count; t++) {
+        replay_task_t *task = &tasks[t];
+        for (size_t i = 0; i < task->count; i++) {
+            task->latency[i] = task->events[i].end_us - task->events[i].start_us;
+            if (task->events[i].res != ESP_OK)
+                result->errors++;
+            if (task->events[i].end_us > result->elapsed_us)
+                result->elapsed_us = task->events[i].end_us;
+        }
+        result->calls += task->count;
+        replay_percentiles(task->latency, task->count, result->latency[t]);
+    }
+}
+
+static void replay_run(const replay_config_t *run, replay_result_t *result)
+{
+    bool ports[I2C_NUM_MAX] = {false};
+
+    config = run;
+    for (int d = 0; d < device_count; d++)
+        ports[devices[d].port] = true;
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX; port++) {
+        if (!ports[port])
+            continue;
+        i2cbus_set_freq(port, run->freq);
+        if (run->queue)
+            i2cbus_queue_start(port);
+        i2c_sim_reset_stats(port);
+    }
+    for (int t = 0; t < task_count; t++) {
+        tasks[t].errors = 0;
+        for (int d = 0; d < device_count; d++) {
+            if (tasks[t].used[d])
+                i2cbus_set_post(&tasks[t].bus[d], run->post ? &tasks[t].post[d] : NULL, tasks[t].post_buf[d],
+                                REPLAY_POST_BUF, REPLAY_POST_US);
+        }
+    }
+
+    replay_start = esp_timer_get_time() + REPLAY_LEAD_US;
+    for (int t = 0; t < task_count; t++)
+        xTaskCreate(vTaskReplay, tasks[t].name, 1024*3, &tasks[t], REPLAY_TASK_PRIORITY, NULL);
+    for (int t = 0; t < task_count; t++)
+        xSemaphoreTake(done, portMAX_DELAY);
+
+    // writes still staged go out before the bus is accounted.
+    for (int t = 0; t < task_count; t++) {
+        for (int d = 0; d < device_count; d++) {
+            if (tasks[t].used[d])
+                i2cbus_set_post(&tasks[t].bus[d], NULL, NULL, 0, 0);
+        }
+    }
+
+    result->bus = true;
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX; port++) {
+        i2c_sim_stats_t stats;
+        if (!ports[port])
+            continue;
+        i2c_sim_get_stats(port, &stats);
+        result->wire_time_ns += stats.wire_time_ns;
+        result->transactions += stats.transactions;
+        result->bytes += stats.bytes_written + stats.bytes_read;
+        result->handoffs += stats.handoffs;
+    }
+    for (int t = 0; t < task_count; t++) {
+        if (tasks[t].end_us - replay_start > result->elapsed_us)
+            result->elapsed_us = tasks[t].end_us - replay_start;
+        result->calls += tasks[t].count;
+        result->errors += tasks[t].errors;
+        replay_percentiles(tasks[t].latency, tasks[t].count, result->latency[t]);
+    }
+}
+
+static bool replay_parse_configs(const char *spec)
+{
+    char buf[256];
+    char *save = NULL;
+
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *token = strtok_r(buf, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        if (config_count == REPLAY_MAX_CONFIGS)
+            return false;
+
+        replay_config_t *run = &configs[config_count++];
+        snprintf(run->name, sizeof(run->name), "%s", token);
+
+        // clock first, then options: 400k+post+queue.
+        char *opts = NULL;
+        char *freq = strtok_r(token, "+", &opts);
+        if (!strcmp(freq, "base")) {
+            run->freq = I2C_MASTER_FREQ;
+        }
+        else {
+            char *unit;
+            run->freq = strtoul(freq, &unit, 10);
+            if (!strcmp(unit, "k"))
+                run->freq *= 1000;
+            else if (!strcmp(unit, "m"))
+                run->freq *= 1000000;
+            else if (*unit)
+                return false;
+        }
+        if (!run->freq)
+            return false;
+
+        for (char *opt = strtok_r(NULL, "+", &opts); opt; opt = strtok_r(NULL, "+", &opts)) {
+            if (!strcmp(opt, "post"))
+                run->post = true;
+            else if (!strcmp(opt, "queue"))
+                run->queue = true;
+            else
+                return false;
+        }
+    }
+
+    return config_count > 0;
+}
+
+static void replay_print(void)
+{
+    static const char *rows[] = {"elapsed_ms", "bus_time_ms", "bus_util_pct", "transactions", "bytes",
+                                 "handoffs", "calls", "errors"};
+    static const char *percentiles[] = {"p50_us", "p95_us", "p99_us", "max_us"};
+
+    printf("metric,trace");
+    for (int c = 0; c < config_count; c++)
+        printf(",%s", configs[c].name);
+    printf("\n");
+
+    for (int r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+        printf("%s", rows[r]);
+        for (int c = 0; c <= config_count; c++) {
+            replay_result_t *res = &results[c];
+            // bus columns of a trace loaded from file are unknown.
+            if (!res->bus && (r >= 1) && (r <= 5)) {
+                printf(",-");
+                continue;
+            }
+            switch (r) {
+                case 0: printf(",%.1f", res->elapsed_us / 1000.0); break;
+                case 1: printf(",%.1f", res->wire_time_ns / 1e6); break;
+                case 2: printf(",%.1f", res->elapsed_us ? (res->wire_time_ns / 10.0) / res->elapsed_us : 0); break;
+                case 3: printf(",%u", (unsigned)res->transactions); break;
+                case 4: printf(",%llu", (unsigned long long)res->bytes); break;
+                case 5: printf(",%u", (unsigned)res->handoffs); break;
+                case 6: printf(",%u", (unsigned)res->calls); break;
+                default: printf(",%u", (unsigned)res->errors); break;
+            }
+        }
+        printf("\n");
+    }
+
+    for (int t = 0; t < task_count; t++) {
+        for (int p = 0; p < 4; p++) {
+            printf("%s.%s", tasks[t].name, percentiles[p]);
+            for (int c = 0; c <= config_count; c++)
+                printf(",%lld", (long long)results[c].latency[t][p]);
+            printf("\n");
+        }
+    }
+    fflush(stdout);
+}
+
+void app_main(void)
+{
+    const char *env_trace = getenv("I2CBUS_REPLAY_TRACE");
+    const char *env_save = getenv("I2CBUS_REPLAY_SAVE");
+    const char *env_configs = getenv("I2CBUS_REPLAY_CONFIGS");
+    const char *env_pace = getenv("I2CBUS_REPLAY_PACE");
+    const char *env_duration = getenv("I2CBUS_REPLAY_MS");
+    int duration_ms = env_duration ? atoi(env_duration) : REPLAY_RECORD_MS;
+
+    if (!replay_parse_configs(env_configs ? env_configs : REPLAY_CONFIGS)) {
+        ESP_LOGE(TAG, "I2CBUS_REPLAY_CONFIGS must be up to %d clocks like base, 400k or 1m, each with +post or "
+                 "+queue options", REPLAY_MAX_CONFIGS);
+        exit(EXIT_FAILURE);
+    }
+    if (env_pace && strcmp(env_pace, "think") && strcmp(env_pace, "time")) {
+        ESP_LOGE(TAG, "I2CBUS_REPLAY_PACE must be think or time");
+        exit(EXIT_FAILURE);
+    }
+    pace = (env_pace && !strcmp(env_pace, "time")) ? REPLAY_PACE_TIME : REPLAY_PACE_THINK;
+
+    // bus and delays take target time, so host latencies are the target ones.
+    esp_log_level_set("i2cbus", ESP_LOG_WARN);
+    i2c_sim_set_realtime(true);
+    done = xSemaphoreCreateCounting(REPLAY_MAX_TASKS, 0);
+
+    if (env_trace) {
+        esp_err_t res = replay_load(env_trace);
+        if (res != ESP_OK) {
+            ESP_LOGE(TAG, "trace %s not loaded: %s", env_trace, esp_err_to_name(res));
+            exit(EXIT_FAILURE);
+        }
+    }
+    else {
+        replay_record(duration_ms, &results[0]);
+    }
+    replay_rebase();
+
+    if (env_save && (replay_save(env_save) != ESP_OK))
+        ESP_LOGW(TAG, "trace not saved to %s", env_save);
+
+    for (int d = 0; d < device_count; d++) {
+        if (!i2cbus_get_freq(devices[d].port))
+            i2cbus_init(devices[d].port, I2C_MODE_MASTER, GPIO_NUM_NC, GPIO_NUM_NC);
+        i2c_sim_attach(devices[d].port, &devices[d].sim, devices[d].addr, &sink_ops, NULL);
+    }
+    for (int t = 0; t < task_count; t++) {
+        for (int d = 0; d < device_count; d++) {
+            if (tasks[t].used[d])
+                i2cbus_create(&tasks[t].bus[d], devices[d].port, devices[d].addr);
+        }
+    }
+
+    replay_trace_result(&results[0]);
+    for (int c = 0; c < config_count; c++)
+        replay_run(&configs[c], &results[1 + c]);
+    replay_print();
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "i2cbus.h"
+#include "lcd_i2c.h"
+#include "i2c_sim.h"
+#include "i2c_sim_hd44780.h"
+#include "i2c_sim_regfile.h"
+
+#define STRESS_PORT         I2C_NUM_0
+#define STRESS_MAX_TASKS    32
+#define STRESS_MAX_LCDS     8
+#define STRESS_LCD_ADDR     0x20        /*!< First LCD, one per task for the first 8 tasks */
+#define STRESS_CHECK_ADDR   0x48        /*!< Device shared by all tasks, checks transactions */
+#define STRESS_REGS_ADDR    0x50        /*!< First register file, one per task */
+#define STRESS_REGS_SIZE    16
+#define STRESS_READ_SIZE    4
+#define STRESS_RECORD_SIZE  8           /*!< Data bytes of a checked write */
+#define STRESS_DURATION_MS  1000        /*!< Default run time of each step */
+
+static const char *TAG = "stress";
+
+typedef enum {
+    STRESS_OP_WRITE = 0,
+    STRESS_OP_READ,
+    STRESS_OP_LCD,
+    STRESS_OP_MAX
+} stress_op_t;
+
+typedef struct {
+    int id;
+    i2cbus_t regs;                      /*!< Own register file */
+    i2cbus_t check;                     /*!< Shared checking device */
+    lcd_i2c_t *lcd;                     /*!< Own LCD, NULL if none */
+    uint32_t seed;                      /*!< Operation mix random state */
+    uint32_t seq;                       /*!< Operations done */
+    uint32_t errors;                    /*!< Calls that failed */
+    uint32_t corrupted;                 /*!< Reads that returned unexpected data */
+    int32_t lcd_value;                  /*!< Last counter on LCD, -1 if none, -2 if last write failed */
+    int64_t *latency;                   /*!< Latency of each operation, nanoseconds */
+    size_t latency_size;
+} stress_task_t;
+
+typedef struct {
+    uint8_t buf[1 + STRESS_RECORD_SIZE + 1];
+    size_t len;
+    uint32_t records;                   /*!< Transactions checked */
+    uint32_t interleaved;               /*!< Transactions with bytes of more than one record */
+} stress_check_t;
+
+static stress_task_t tasks[STRESS_MAX_TASKS];
+static lcd_i2c_t lcds[STRESS_MAX_LCDS];
+static i2c_sim_hd44780_t lcd_models[STRESS_MAX_LCDS];
+static i2c_sim_regfile_t regs_models[STRESS_MAX_TASKS];
+static uint8_t regs_mem[STRESS_MAX_TASKS][STRESS_REGS_SIZE];
+static stress_check_t check;
+static i2c_sim_device_t check_dev;
+static unsigned int mix[STRESS_OP_MAX] = {4, 4, 2};
+static uint32_t failures;               /*!< Interleaved, corrupted or overlapping transactions of all steps */
+static volatile bool running;
+static SemaphoreHandle_t done;
+
+static int64_t host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static uint8_t record_byte(uint8_t task, uint8_t seq, int i)
+{
+    return (task + seq + i) & 0xFF;
+}
+
+/* checking device model, each write transaction must carry one whole record */
+
+static bool _check_start(void *ctx, bool read)
+{
+    check.len = 0;
+    return !read;
+}
+
+static bool _check_write(void *ctx, uint8_t data)
+{
+    if (check.len < sizeof(check.buf))
+        check.buf[check.len++] = data;
+    return true;
+}
+
+static uint8_t _check_read(void *ctx, bool ack)
+{
+    return 0xFF;
+}
+
+static void _check_stop(void *ctx)
+{
+    // register byte is the task id, record is task, seq and derived bytes.
+    bool valid = (check.len == (1 + STRESS_RECORD_SIZE)) && (check.buf[0] == check.buf[1]);
+    for (int i = 3; valid && (i < check.len); i++)
+        valid = check.buf[i] == record_byte(check.buf[1], check.buf[2], i);
+
+    check.records++;
+    if (!valid)
+        check.interleaved++;
+}
+
+static const i2c_sim_ops_t check_ops = {
+    .start = _check_start,
+    .write = _check_write,
+    .read = _check_read,
+    .stop = _check_stop,
+};
+
+static stress_op_t stress_pick(stress_task_t *task)
+{
+    unsigned int total = mix[STRESS_OP_WRITE] + mix[STRESS_OP_READ] + mix[STRESS_OP_LCD];
+
+    // xorshift32.
+    task->seed ^= task->seed << 13;
+    task->seed ^= task->seed >> 17;
+    task->seed ^= task->seed << 5;
+
+    unsigned int pick = task->seed % total;
+    for (stress_op_t op = STRESS_OP_WRITE; op < STRESS_OP_MAX; op++) {
+        if (pick < mix[op])
+            return ((op == STRESS_OP_LCD) && !task->lcd) ? STRESS_OP_WRITE : op;
+        pick -= mix[op];
+    }
+    return STRESS_OP_WRITE;
+}
+
+static esp_err_t stress_op(stress_task_t *task, stress_op_t op)
+{
+    esp_err_t res = ESP_OK;
+
+    switch (op) {
+        case STRESS_OP_WRITE: {
+            uint8_t reg = task->id;
+            uint8_t record[STRESS_RECORD_SIZE];
+            record[0] = task->id;
+            record[1] = task->seq & 0xFF;
+            for (int i = 2; i < STRESS_RECORD_SIZE; i++)
+                record[i] = record_byte(task->id, record[1], i + 1);
+            res = i2cbus_write_reg(&task->check, &reg, 1, record, sizeof(record));
+        }
+        break;
+        case STRESS_OP_READ: {
+            uint8_t reg = task->seq % (STRESS_REGS_SIZE - STRESS_READ_SIZE);
+            uint8_t data[STRESS_READ_SIZE];
+            res = i2cbus_read_reg(&task->regs, &reg, 1, data, sizeof(data));
+            if ((res == ESP_OK) && memcmp(data, &regs_mem[task->id][reg], sizeof(data)))
+                task->corrupted++;
+        }
+        break;
+        case STRESS_OP_LCD: {
+            char str_value[8];
+            sprintf(str_value, "%.4u", (unsigned)(task->seq % 10000));
+            res = lcd_i2c_set_cursor(task->lcd, 0, 0);
+            if (res == ESP_OK)
+                res = lcd_i2c_write(task->lcd, str_value);
+            task->lcd_value = (res == ESP_OK) ? (task->seq % 10000) : -2;
+        }
+        break;
+        default:
+        break;
+    }
+
+    return res;
+}
+
+static void vTaskStress(void *pvParameters)
+{
+    stress_task_t *task = (stress_task_t *)pvParameters;
+
+    while (running) {
+        stress_op_t op = stress_pick(task);
+        int64_t start = host_ns();
+
+        if (stress_op(task, op) != ESP_OK)
+            task->errors++;
+
+        if (task->seq == task->latency_size) {
+            task->latency_size = task->latency_size ? task->latency_size * 2 : 1024;
+            task->latency = realloc(task->latency, task->latency_size * sizeof(int64_t));
+        }
+        task->latency[task->seq++] = host_ns() - start;
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static int stress_cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void stress_step(int count, int duration_ms)
+{
+    i2c_sim_stats_t stats;
+    uint32_t records = check.records, interleaved = check.interleaved;
+
+    for (int i = 0; i < count; i++) {
+        tasks[i].seq = 0;
+        tasks[i].errors = 0;
+        tasks[i].corrupted = 0;
+    }
+
+    i2c_sim_reset_stats(STRESS_PORT);
+    int64_t start = host_ns();
+    running = true;
+    for (int i = 0; i < count; i++)
+        xTaskCreate(vTaskStress, "vTaskStress", 1024*3, &tasks[i], 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    running = false;
+    for (int i = 0; i < count; i++)
+        xSemaphoreTake(done, portMAX_DELAY);
+    int64_t elapsed = host_ns() - start;
+    i2c_sim_get_stats(STRESS_PORT, &stats);
+
+    // merge latencies of all tasks, fairness from operations per task.
+    size_t ops = 0, n = 0;
+    double sum = 0, sum_sq = 0;
+    uint32_t errors = 0, corrupted = 0;
+    for (int i = 0; i < count; i++) {
+        ops += tasks[i].seq;
+        sum += tasks[i].seq;
+        sum_sq += (double)tasks[i].seq * tasks[i].seq;
+        errors += tasks[i].errors;
+        corrupted += tasks[i].corrupted;
+    }
+
+    int64_t *latency = malloc((ops ? ops : 1) * sizeof(int64_t));
+    for (int i = 0; i < count; i++) {
+        memcpy(&latency[n], tasks[i].latency, tasks[i].seq * sizeof(int64_t));
+        n += tasks[i].seq;
+    }
+    qsort(latency, n, sizeof(int64_t), stress_cmp);
+
+    double jain = sum_sq ? (sum * sum) / (count * sum_sq) : 0;
+    printf("%d,%zu,%.0f,%.1f,%.1f,%.1f,%.1f,%.2f,%.3f,%u,%u,%u,%u\n", count, ops, ops * 1e9 / elapsed, 
+           (stats.wire_time_ns * 100.0) / elapsed, 
+           n ? latency[n / 2] / 1000.0 : 0, n ? latency[(n * 99) / 100] / 1000.0 : 0, n ? latency[n - 1] / 1000.0 : 0, 
+           stats.transactions ? (double)stats.handoffs / stats.transactions : 0, jain, (unsigned)errors, 
+           (unsigned)(corrupted + (check.interleaved - interleaved)), (unsigned)(check.records - records), 
+           (unsigned)stats.overlaps);
+    fflush(stdout);
+
+    failures += corrupted + (check.interleaved - interleaved) + stats.overlaps;
+    free(latency);
+}
+
+static int stress_lcd_check(void)
+{
+    int bad = 0;
+
+    // each LCD must show the last counter its task wrote, whole.
+    for (int i = 0; i < STRESS_MAX_LCDS; i++) {
+        char screen[2 * 17 + 1], expect[8];
+        i2c_sim_hd44780_render(&lcd_models[i], screen, sizeof(screen));
+        sprintf(expect, "%.4d", (int)tasks[i].lcd_value);
+        if ((tasks[i].lcd_value == -2) || ((tasks[i].lcd_value >= 0) && strncmp(screen, expect, 4)))
+            bad++;
+        else
+            bad += lcd_models[i].stats.violations ? 1 : 0;
+    }
+
+    return bad;
+}
+
+void app_main(void)
+{
+    static const int steps[] = {1, 2, 4, 8, 16, 32};
+    const char *env_mix = getenv("I2CBUS_STRESS_MIX");
+    const char *env_duration = getenv("I2CBUS_STRESS_MS");
+    const char *env_tasks = getenv("I2CBUS_STRESS_TASKS");
+    int duration_ms = env_duration ? atoi(env_duration) : STRESS_DURATION_MS;
+    int max_tasks = env_tasks ? atoi(env_tasks) : STRESS_MAX_TASKS;
+
+    if (env_mix && (sscanf(env_mix, "%u:%u:%u", &mix[0], &mix[1], &mix[2]) != 3 || !(mix[0] + mix[1] + mix[2]))) {
+        ESP_LOGE(TAG, "I2CBUS_STRESS_MIX must be write:read:lcd weights");
+        exit(EXIT_FAILURE);
+    }
+
+    // bus and delays take target time, so host latencies are the target ones.
+    i2c_sim_set_realtime(true);
+    i2c_sim_attach(STRESS_PORT, &check_dev, STRESS_CHECK_ADDR, &check_ops, NULL);
+    for (int i = 0; i < STRESS_MAX_TASKS; i++) {
+        for (int j = 0; j < STRESS_REGS_SIZE; j++)
+            regs_mem[i][j] = (i * STRESS_REGS_SIZE) + j;
+        i2c_sim_regfile_attach(STRESS_PORT, &regs_models[i], STRESS_REGS_ADDR + i, regs_mem[i], STRESS_REGS_SIZE, 1);
+    }
+    for (int i = 0; i < STRESS_MAX_LCDS; i++)
+        i2c_sim_hd44780_attach(STRESS_PORT, &lcd_models[i], STRESS_LCD_ADDR + i, 16, 2);
+
+    i2cbus_init(STRESS_PORT, I2C_MODE_MASTER, GPIO_NUM_NC, GPIO_NUM_NC);
+    for (int i = 0; i < STRESS_MAX_TASKS; i++) {
+        tasks[i].id = i;
+        tasks[i].lcd_value = -1;
+        tasks[i].seed = 0x9E3779B9 * (i + 1);
+        i2cbus_create(&tasks[i].regs, STRESS_PORT, STRESS_REGS_ADDR + i);
+        i2cbus_create(&tasks[i].check, STRESS_PORT, STRESS_CHECK_ADDR);
+        if (i < STRESS_MAX_LCDS) {
+            memset(&lcds[i], 0, sizeof(lcd_i2c_t));
+            lcd_i2c_init(&lcds[i], STRESS_PORT, STRESS_LCD_ADDR + i, LCD_1602);
+            tasks[i].lcd = &lcds[i];
+        }
+    }
+    done = xSemaphoreCreateCounting(STRESS_MAX_TASKS, 0);
+
+    printf("tasks,ops,ops_per_s,bus_util_pct,p50_us,p99_us,max_us,handoffs_per_xfer,jain,errors,integrity,"
+           "checked,overlaps\n");
+    for (int i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        if (steps[i] <= max_tasks)
+            stress_step(steps[i], duration_ms);
+    }
+
+    // a call that times out between the two nibbles of a character leaves a 
+    // 4-bit LCD out of step, that is a timeout effect and not a locking one.
+    int lcd_bad = stress_lcd_check();
+    if (lcd_bad)
+        ESP_LOGW(TAG, "%d LCDs out of step or with timing violations", lcd_bad);
+    if (failures)
+        ESP_LOGE(TAG, "%u transactions interleaved, corrupted or overlapping", (unsigned)failures);
+
+    exit(failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
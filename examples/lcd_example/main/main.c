@@ -39,10 +39,8 @@ void vTaskMain(void *pvParameters)
     // inicializacoes.
     while (true) {
         /* main loop */
-        char str_value[10];
-        sprintf(str_value, "%.8d", value);
         lcd_i2c_set_cursor(&lcd1602, 0, 0);
-        lcd_i2c_write(&lcd1602, str_value);
+        lcd_i2c_write_int(&lcd1602, value, 8, LCD_ALIGN_ZERO);
         lcd_i2c_shift_display(&lcd2004, LCD_SHIFT_LEFT);
         value ++;
         vTaskDelay(pdMS_TO_TICKS(1000));